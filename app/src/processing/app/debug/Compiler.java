@@ -1092,6 +1092,10 @@ public class Compiler implements MessageConsumer {
         baseCommandCompiler.add("-DARDUINO=" + Base.REVISION);
         baseCommandCompiler.add("-DENERGIA=" + Base.EREVISION);
 
+        // board specific defines, e.g. -DLWIP_PROFILE=3
+        if(arch == "lm4f")
+        	baseCommandCompiler.addAll(getExtraFlags(boardPreferences));
+
         if(Preferences.getBoolean("build.debug")) {
         	baseCommandCompiler.add("-g");
         	baseCommandCompiler.add("-gdwarf-2");
@@ -1204,6 +1208,10 @@ public class Compiler implements MessageConsumer {
         baseCommandCompiler.add("-DARDUINO=" + Base.REVISION);
         baseCommandCompiler.add("-DENERGIA=" + Base.EREVISION);
 
+        // board specific defines, e.g. -DLWIP_PROFILE=3
+        if(arch == "lm4f")
+        	baseCommandCompiler.addAll(getExtraFlags(boardPreferences));
+
         if(Preferences.getBoolean("build.debug")) {
         	baseCommandCompiler.add("-g");
         	baseCommandCompiler.add("-gdwarf-2");
@@ -1324,6 +1332,10 @@ public class Compiler implements MessageConsumer {
         baseCommandCompilerCPP.add("-DARDUINO=" + Base.REVISION);
         baseCommandCompilerCPP.add("-DENERGIA=" + Base.EREVISION);
 
+        // board specific defines, e.g. -DLWIP_PROFILE=3
+        if(arch == "lm4f")
+        	baseCommandCompilerCPP.addAll(getExtraFlags(boardPreferences));
+
         if(Preferences.getBoolean("build.debug")) {
         	baseCommandCompilerCPP.add("-g");
         	baseCommandCompilerCPP.add("-gdwarf-2");
@@ -1393,6 +1405,23 @@ public class Compiler implements MessageConsumer {
 
 
 
+  /**
+   * The board's build.extra_flags from boards.txt as compiler arguments,
+   * none when it is not set or blank.
+   */
+  static private List<String> getExtraFlags(Map<String, String> boardPreferences) {
+    List<String> flags = new ArrayList<String>();
+    String extra = boardPreferences.get("build.extra_flags");
+
+    if (extra != null) {
+      for (String flag : extra.trim().split("\\s+")) {
+        if (flag.length() > 0)
+          flags.add(flag);
+      }
+    }
+    return flags;
+  }
+
   /////////////////////////////////////////////////////////////////////////////
 
   static private void createFolder(File folder) throws RunnerException {
@@ -153,6 +153,13 @@ void loop(void);
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
+uint8_t pulseInStart(uint8_t pin, uint8_t state);
+uint8_t pulseInAvailable(uint8_t pin);
+unsigned long pulseInResult(uint8_t pin);
+uint8_t pulseMeasureBegin(uint8_t pin, void (*callback)(uint8_t pin, unsigned long high, unsigned long period));
+unsigned long pulseMeasureHigh(uint8_t pin);
+unsigned long pulseMeasurePeriod(uint8_t pin);
+void pulseCaptureEnd(uint8_t pin);
 void pinMode(uint8_t, uint8_t);
 void pinMode_int(uint8_t, uint8_t);
 void digitalWrite(uint8_t, uint8_t);
@@ -32,12 +32,212 @@
 #include "wiring_private.h"
 #include "pins_energia.h"
 
+/*
+ * Hardware pulse capture on the eCAP inputs. The eCAP modules run in
+ * delta mode from SYSCLKOUT and are polled, no interrupt is taken.
+ * The 2837x routes eCAP through the input X-BAR and is not supported.
+ */
+#ifndef TMS320F28377S
+
+typedef struct {
+	uint16_t gpio;
+	uint8_t ecap;
+	uint8_t mux;
+} ecapPin_t;
+
+static const ecapPin_t ecap_pins[] = {
+	{ 5, 0, 3},
+	{19, 0, 3},
+#ifdef TMS320F28069
+	{24, 0, 1},
+	{ 7, 1, 3},
+	{25, 1, 1},
+	{ 9, 2, 3},
+	{26, 2, 1},
+#endif
+};
+
+#ifdef TMS320F28069
+#define ECAP_MODULES 3
+#else
+#define ECAP_MODULES 1
+#endif
+
+static uint8_t ecap_owner[ECAP_MODULES];	// pin using the module, 0 if free
+
+static volatile struct ECAP_REGS *ecapRegs(uint8_t ecap)
+{
+#ifdef TMS320F28069
+	if (ecap == 1) return &ECap2Regs;
+	if (ecap == 2) return &ECap3Regs;
+#endif
+	return &ECap1Regs;
+}
+
+static volatile struct ECAP_REGS *ecapFind(uint8_t pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < ECAP_MODULES; i++) {
+		if (pin != 0 && ecap_owner[i] == pin)
+			return ecapRegs(i);
+	}
+	return 0;
+}
+
+static volatile struct ECAP_REGS *ecapStart(uint8_t pin, uint8_t continuous, uint8_t state)
+{
+	uint16_t gpio = pin_mapping[pin];
+	volatile struct ECAP_REGS *ecap;
+	uint8_t i;
+
+	for (i = 0; i < sizeof(ecap_pins) / sizeof(ecap_pins[0]); i++) {
+		if (ecap_pins[i].gpio == gpio)
+			break;
+	}
+	if (pin == 0 || i == sizeof(ecap_pins) / sizeof(ecap_pins[0]))
+		return 0;
+	if (ecap_owner[ecap_pins[i].ecap] != 0 && ecap_owner[ecap_pins[i].ecap] != pin)
+		return 0;
+
+	ecap = ecapRegs(ecap_pins[i].ecap);
+
+	EALLOW;
+	if (ecap_pins[i].ecap == 0) SysCtrlRegs.PCLKCR1.bit.ECAP1ENCLK = 1;
+#ifdef TMS320F28069
+	if (ecap_pins[i].ecap == 1) SysCtrlRegs.PCLKCR1.bit.ECAP2ENCLK = 1;
+	if (ecap_pins[i].ecap == 2) SysCtrlRegs.PCLKCR1.bit.ECAP3ENCLK = 1;
+#endif
+	GpioCtrlRegs.GPADIR.all &= ~(1UL << gpio);
+	if (gpio < 16) {
+		GpioCtrlRegs.GPAMUX1.all &= ~(3UL << (gpio * 2));
+		GpioCtrlRegs.GPAMUX1.all |= (uint32_t)ecap_pins[i].mux << (gpio * 2);
+	} else {
+		GpioCtrlRegs.GPAMUX2.all &= ~(3UL << ((gpio - 16) * 2));
+		GpioCtrlRegs.GPAMUX2.all |= (uint32_t)ecap_pins[i].mux << ((gpio - 16) * 2);
+	}
+	EDIS;
+
+	ecap->ECEINT.all = 0;
+	ecap->ECCTL2.bit.TSCTRSTOP = 0;
+	ecap->ECCLR.all = 0xFFFF;
+
+	// Every event resets the counter so CAPn holds the time since the previous edge
+	ecap->ECCTL1.all = 0;
+	ecap->ECCTL1.bit.CAP1POL = (state == HIGH) ? 0 : 1;
+	ecap->ECCTL1.bit.CAP2POL = (state == HIGH) ? 1 : 0;
+	ecap->ECCTL1.bit.CAP3POL = ecap->ECCTL1.bit.CAP1POL;
+	ecap->ECCTL1.bit.CAP4POL = ecap->ECCTL1.bit.CAP2POL;
+	ecap->ECCTL1.bit.CTRRST1 = 1;
+	ecap->ECCTL1.bit.CTRRST2 = 1;
+	ecap->ECCTL1.bit.CTRRST3 = 1;
+	ecap->ECCTL1.bit.CTRRST4 = 1;
+	ecap->ECCTL1.bit.CAPLDEN = 1;
+
+	ecap->ECCTL2.all = 0;
+	ecap->ECCTL2.bit.CONT_ONESHT = continuous ? 0 : 1;
+	ecap->ECCTL2.bit.STOP_WRAP = continuous ? 3 : 1;
+	ecap->ECCTL2.bit.SYNCO_SEL = 2;			// sync out disabled
+	ecap->TSCTR = 0;
+	ecap->ECCTL2.bit.TSCTRSTOP = 1;
+	if (!continuous)
+		ecap->ECCTL2.bit.REARM = 1;
+
+	ecap_owner[ecap_pins[i].ecap] = pin;
+	return ecap;
+}
+
+uint8_t pulseInStart(uint8_t pin, uint8_t state)
+{
+	return ecapStart(pin, 0, state) != 0;
+}
+
+uint8_t pulseInAvailable(uint8_t pin)
+{
+	volatile struct ECAP_REGS *ecap = ecapFind(pin);
+	return ecap ? ecap->ECFLG.bit.CEVT2 : 0;
+}
+
+unsigned long pulseInResult(uint8_t pin)
+{
+	volatile struct ECAP_REGS *ecap = ecapFind(pin);
+	if (ecap == 0 || !ecap->ECFLG.bit.CEVT2) return 0;
+	return clockCyclesToMicroseconds(ecap->CAP2);
+}
+
+/* The eCAP is polled, measurements are read with pulseMeasureHigh() and
+ * pulseMeasurePeriod() and a callback can not be delivered */
+uint8_t pulseMeasureBegin(uint8_t pin,
+	void (*callback)(uint8_t pin, unsigned long high, unsigned long period))
+{
+	if (callback != 0)
+		return 0;
+	return ecapStart(pin, 1, HIGH) != 0;
+}
+
+unsigned long pulseMeasureHigh(uint8_t pin)
+{
+	volatile struct ECAP_REGS *ecap = ecapFind(pin);
+	if (ecap == 0 || !ecap->ECFLG.bit.CEVT4) return 0;
+	return clockCyclesToMicroseconds(ecap->CAP4);
+}
+
+unsigned long pulseMeasurePeriod(uint8_t pin)
+{
+	volatile struct ECAP_REGS *ecap = ecapFind(pin);
+	if (ecap == 0 || !ecap->ECFLG.bit.CEVT4) return 0;
+	// CAP3 holds the low time before the high time in CAP4
+	return clockCyclesToMicroseconds(ecap->CAP3 + ecap->CAP4);
+}
+
+void pulseCaptureEnd(uint8_t pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < ECAP_MODULES; i++) {
+		if (pin != 0 && ecap_owner[i] == pin) {
+			ecapRegs(i)->ECCTL2.bit.TSCTRSTOP = 0;
+			ecapRegs(i)->ECCTL1.bit.CAPLDEN = 0;
+			ecap_owner[i] = 0;
+		}
+	}
+}
+
+#else
+
+uint8_t pulseInStart(uint8_t pin, uint8_t state) { return 0; }
+uint8_t pulseInAvailable(uint8_t pin) { return 0; }
+unsigned long pulseInResult(uint8_t pin) { return 0; }
+uint8_t pulseMeasureBegin(uint8_t pin,
+	void (*callback)(uint8_t pin, unsigned long high, unsigned long period)) { return 0; }
+unsigned long pulseMeasureHigh(uint8_t pin) { return 0; }
+unsigned long pulseMeasurePeriod(uint8_t pin) { return 0; }
+void pulseCaptureEnd(uint8_t pin) { }
+
+#endif
+
 /* Measures the length (in microseconds) of a pulse on the pin; state is HIGH
  * or LOW, the type of pulse to measure.  Works on pulses from 2-3 microseconds
  * to 3 minutes in length, but must be called at least a few dozen microseconds
- * before the start of the pulse. */
+ * before the start of the pulse. Pins on an eCAP input are timed in hardware,
+ * see pulseInStart(). */
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
 {
+	if (pulseInStart(pin, state)) {
+		unsigned long start = micros();
+		unsigned long result;
+
+		while (!pulseInAvailable(pin)) {
+			if (micros() - start >= timeout) {
+				pulseCaptureEnd(pin);
+				return 0;
+			}
+		}
+		result = pulseInResult(pin);
+		pulseCaptureEnd(pin);
+		return result;
+	}
+
 	// cache the port and bit of the pin in order to speed up the
 	// pulse width measuring loop and achieve finer resolution.  calling
 	// digitalRead() instead yields much coarser resolution.
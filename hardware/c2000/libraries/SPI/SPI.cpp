@@ -17,6 +17,29 @@
 
 SPIClass SPI;
 
+uint8_t SPIClass::interruptMode = 0;
+uint8_t SPIClass::interruptSave;
+
+/* GPIO interrupts go through the PIE, all interrupts are held off */
+void SPIClass::usingInterrupt(uint8_t pin)
+{
+    interruptMode = 1;
+}
+
+void SPIClass::beginTransaction(const SPISettings &settings)
+{
+    if (interruptMode) {
+        interruptSave = __disable_interrupts() & 0x0001;    // INTM was set
+    }
+    spi_apply_settings(&settings.image);
+}
+
+void SPIClass::endTransaction(void)
+{
+    if (interruptMode && !interruptSave)
+        EINT;
+}
+
 void SPIClass::begin()
 {
     spi_initialize();
@@ -26,7 +26,24 @@
 #define SPI_MODE2 2
 #define SPI_MODE3 4
 
+#define SPI_HAS_TRANSACTION 1
+
+class SPISettings {
+public:
+  SPISettings() { spi_settings_init(&image, 4000000, MSBFIRST, SPI_MODE0); }
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    spi_settings_init(&image, clock, bitOrder, dataMode);
+  }
+private:
+  spi_settings_t image;
+  friend class SPIClass;
+};
+
 class SPIClass {
+private:
+  static uint8_t interruptMode;     // 0 none, 1 all interrupts
+  static uint8_t interruptSave;
+
 public:
   inline static uint8_t transfer(uint8_t _data);
 
@@ -41,6 +58,12 @@ public:
 
   inline static void attachInterrupt();
   inline static void detachInterrupt();
+
+  // Transactions, once usingInterrupt() was called interrupts are held
+  // off until endTransaction()
+  static void usingInterrupt(uint8_t pin);
+  static void beginTransaction(const SPISettings &settings);
+  static void endTransaction(void);
 };
 
 extern SPIClass SPI;
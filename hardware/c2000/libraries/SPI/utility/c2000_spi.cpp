@@ -17,6 +17,7 @@
 //#include <stdbool.h>
 typedef unsigned char _Bool;
 #include "F2802x_Device.h"     // Device Headerfile and Examples Include File
+#include "c2000_spi.h"
 
 //#include "spi_430.h"
 
@@ -156,3 +157,42 @@ void spi_set_datamode(const uint8_t mode)
 
 }
 
+/**
+ * spi_settings_init() - precompute SPICCR, SPICTL and SPIBRR
+ *
+ * The bit rate is LSPCLK / (SPIBRR + 1), the slowest divider that still
+ * reaches the requested clock is used. The SPI only shifts MSB first.
+ */
+void spi_settings_init(spi_settings_t *settings, const uint32_t clock, const uint8_t order, const uint8_t mode)
+{
+    uint16_t lospcp = SysCtrlRegs.LOSPCP.bit.LSPCLK;
+    uint32_t lspclk = lospcp ? F_CPU / (2 * lospcp) : F_CPU;
+    uint32_t div = (lspclk + clock - 1) / clock;
+
+    settings->ccr = 0x0007;                             // 8-bit chars
+    settings->ctl = 0x0006;                             // master, talk
+    if (mode == 2 || mode == 4)                         // CPOL=1
+        settings->ccr |= 0x0040;
+    if (mode == 1 || mode == 4)                         // CPHA=1
+        settings->ctl |= 0x0008;
+
+    if (div < 4) div = 4;                               // SPIBRR 3 is the fastest
+    if (div > 128) div = 128;
+    settings->brr = div - 1;
+}
+
+/**
+ * spi_apply_settings() - reprogram SPI-A if it is set up differently
+ */
+void spi_apply_settings(const spi_settings_t *settings)
+{
+    if ((SpiaRegs.SPICCR.all & ~0x0080) == settings->ccr
+            && SpiaRegs.SPICTL.all == settings->ctl
+            && SpiaRegs.SPIBRR == settings->brr)
+        return;
+
+    SpiaRegs.SPICCR.all = settings->ccr;                // hold in reset
+    SpiaRegs.SPICTL.all = settings->ctl;
+    SpiaRegs.SPIBRR = settings->brr;
+    SpiaRegs.SPICCR.all = settings->ccr | 0x0080;       // release
+}
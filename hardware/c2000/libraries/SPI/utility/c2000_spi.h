@@ -14,11 +14,24 @@
 #ifndef _C2000_SPI_H_
 #define _C2000_SPI_H_
 
+/*
+ * Register image of one device's SPI settings, computed once by
+ * spi_settings_init() and written by spi_apply_settings() only when the
+ * peripheral is programmed differently.
+ */
+typedef struct {
+    uint16_t ccr;       /* SPICCR without SPISWRESET */
+    uint16_t ctl;       /* SPICTL */
+    uint16_t brr;       /* SPIBRR */
+} spi_settings_t;
+
 void spi_initialize(void);
 void spi_disable(void);
 uint8_t spi_send(const uint8_t);
 void spi_set_bitorder(const uint8_t);
 void spi_set_datamode(const uint8_t);
 void spi_set_divisor(const uint16_t clkdivider);
+void spi_settings_init(spi_settings_t *settings, const uint32_t clock, const uint8_t order, const uint8_t mode);
+void spi_apply_settings(const spi_settings_t *settings);
 
 #endif /*_C2000_SPI_H_*/
@@ -15,13 +15,19 @@
 #include "inc/hw_mcspi.h"
 #include "inc/hw_gpio.h"
 #include "driverlib/rom_map.h"
+#include "driverlib/cpu.h"
 #include "driverlib/spi.h"
 #include "driverlib/gpio.h"
 #include "driverlib/prcm.h"
 #include "driverlib/pin.h"
+#include "driverlib/udma.h"
+#include "driverlib/interrupt.h"
+#include "inc/hw_ints.h"
+#include "udma_if.h"
 
 #define SSIBASE g_ulSSIBase[SSIModule]
 #define NOT_ACTIVE 0xA
+#define UDMA_MAX_ITEMS 1024
 
 static const unsigned long g_ulSSIBase[] = {
 	GSPI_BASE
@@ -52,11 +58,15 @@ static const unsigned long g_ulSSIPinModes[][4] = {
 SPIClass::SPIClass(void) {
 	SSIModule = BOOST_PACK_SPI;
 	SSIBitOrder = MSBFIRST;
+	interruptMode = 0;
+	interruptCount = 0;
 }
 
 SPIClass::SPIClass(uint8_t module) {
 	SSIModule = module;
 	SSIBitOrder = MSBFIRST;
+	interruptMode = 0;
+	interruptCount = 0;
 }
   
 void SPIClass::begin() {
@@ -154,6 +164,310 @@ uint8_t SPIClass::transfer(uint8_t data)
 	return (uint8_t) rxData;
 }
 
+/*
+ * uDMA transfers. Pending transfers are queued and worked through from
+ * the GSPI interrupt, which is raised when the RX channel completes.
+ * Both channels always run: a missing TX buffer sends 0xFF and a missing
+ * RX buffer is received into a dummy byte. Transfers larger than the
+ * uDMA limit are sent in 1024 byte chunks.
+ */
+typedef struct {
+	const uint8_t *tx;
+	uint8_t *rx;
+	size_t count;
+	SPIAsyncCallback callback;
+	void *context;
+	uint8_t csPin;
+} spiAsyncTransfer_t;
+
+static struct {
+	spiAsyncTransfer_t queue[SPI_ASYNC_QUEUE];
+	volatile uint8_t head;
+	volatile uint8_t count;
+	volatile uint8_t busy;
+	uint8_t ready;
+	size_t done;
+	size_t chunk;
+} spiAsync;
+
+static const uint8_t spiFill = 0xFF;
+static uint8_t spiDummy;
+
+#define SPI_RX_CH (UDMA_CH30_GSPI_RX & 0xff)
+#define SPI_TX_CH (UDMA_CH31_GSPI_TX & 0xff)
+
+static void spiAsyncChunk(void) {
+	spiAsyncTransfer_t *t = &spiAsync.queue[spiAsync.head];
+	size_t chunk = t->count - spiAsync.done;
+
+	if(chunk > UDMA_MAX_ITEMS) chunk = UDMA_MAX_ITEMS;
+	spiAsync.chunk = chunk;
+
+	MAP_uDMAChannelControlSet(SPI_RX_CH | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_NONE |
+		(t->rx ? UDMA_DST_INC_8 : UDMA_DST_INC_NONE) | UDMA_ARB_1);
+	MAP_uDMAChannelTransferSet(SPI_RX_CH | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+		(void *)(GSPI_BASE + MCSPI_O_RX0), t->rx ? t->rx + spiAsync.done : &spiDummy, chunk);
+
+	MAP_uDMAChannelControlSet(SPI_TX_CH | UDMA_PRI_SELECT, UDMA_SIZE_8 |
+		(t->tx ? UDMA_SRC_INC_8 : UDMA_SRC_INC_NONE) | UDMA_DST_INC_NONE | UDMA_ARB_1);
+	MAP_uDMAChannelTransferSet(SPI_TX_CH | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+		t->tx ? (void *)(t->tx + spiAsync.done) : (void *)&spiFill,
+		(void *)(GSPI_BASE + MCSPI_O_TX0), chunk);
+
+	MAP_uDMAChannelEnable(SPI_RX_CH);
+	MAP_uDMAChannelEnable(SPI_TX_CH);
+}
+
+static void spiAsyncStart(void) {
+	unsigned long dummy;
+
+	while(MAP_SPIDataGetNonBlocking(GSPI_BASE, &dummy));
+
+	spiAsync.busy = 1;
+	spiAsync.done = 0;
+	if(spiAsync.queue[spiAsync.head].csPin != SPI_NO_CS)
+		digitalWrite(spiAsync.queue[spiAsync.head].csPin, LOW);
+
+	// Arm both channels before the SPI starts raising requests
+	spiAsyncChunk();
+	HWREG(GSPI_BASE + MCSPI_O_CH0CONF) |= SPI_RX_DMA | SPI_TX_DMA;
+}
+
+static void SPIAsyncIntHandler(void) {
+	spiAsyncTransfer_t *t = &spiAsync.queue[spiAsync.head];
+	SPIAsyncCallback callback;
+	void *context;
+
+	MAP_SPIIntClear(GSPI_BASE, MAP_SPIIntStatus(GSPI_BASE, true));
+
+	// The TX channel finishes first, wait for the last byte to come in
+	if(!spiAsync.busy || MAP_uDMAChannelIsEnabled(SPI_RX_CH))
+		return;
+
+	spiAsync.done += spiAsync.chunk;
+	if(spiAsync.done < t->count) {
+		spiAsyncChunk();
+		return;
+	}
+
+	/* SPIDmaDisable() clears every other CH0CONF bit, do it here */
+	HWREG(GSPI_BASE + MCSPI_O_CH0CONF) &= ~(SPI_RX_DMA | SPI_TX_DMA);
+
+	if(t->csPin != SPI_NO_CS)
+		digitalWrite(t->csPin, HIGH);
+	callback = t->callback;
+	context = t->context;
+	spiAsync.head = (spiAsync.head + 1) % SPI_ASYNC_QUEUE;
+	spiAsync.count--;
+	spiAsync.busy = 0;
+
+	if(callback)
+		callback(context);
+
+	// The callback may have queued and started another transfer
+	if(!spiAsync.busy && spiAsync.count)
+		spiAsyncStart();
+}
+
+/*
+ * With interrupts masked by PRIMASK, or by BASEPRI at or above the GSPI
+ * interrupt's priority, the completion interrupt never runs. The blocking
+ * calls then run the handler themselves.
+ */
+static void spiAsyncPoll(void) {
+	unsigned long basepri = CPUbasepriGet();
+
+	if(CPUprimask() || (basepri && basepri <= (unsigned long) MAP_IntPriorityGet(INT_GSPI)))
+		SPIAsyncIntHandler();
+}
+
+static void spiAsyncBegin(void) {
+	// WiFi.begin() sets up the same control table, reuse it when present
+	if(MAP_uDMAControlBaseGet() == 0)
+		UDMAInit();
+
+	MAP_uDMAChannelAssign(UDMA_CH30_GSPI_RX);
+	MAP_uDMAChannelAssign(UDMA_CH31_GSPI_TX);
+	MAP_uDMAChannelAttributeDisable(SPI_RX_CH, UDMA_ATTR_ALL);
+	MAP_uDMAChannelAttributeDisable(SPI_TX_CH, UDMA_ATTR_ALL);
+	MAP_uDMAChannelAttributeEnable(SPI_RX_CH, UDMA_ATTR_HIGH_PRIORITY);
+
+	MAP_SPIIntRegister(GSPI_BASE, SPIAsyncIntHandler);
+	MAP_SPIIntEnable(GSPI_BASE, SPI_INT_DMARX);
+	spiAsync.ready = 1;
+}
+
+bool SPIClass::transferAsync(const void *txBuf, void *rxBuf, size_t count,
+		SPIAsyncCallback callback, void *context, uint8_t csPin) {
+	spiAsyncTransfer_t *t;
+
+	// The uDMA cannot reverse bits, LSBFIRST stays with transfer()
+	if(count == 0 || SSIBitOrder == LSBFIRST || spiAsync.count == SPI_ASYNC_QUEUE)
+		return false;
+
+	if(!spiAsync.ready)
+		spiAsyncBegin();
+
+	MAP_IntDisable(INT_GSPI);
+	t = &spiAsync.queue[(spiAsync.head + spiAsync.count) % SPI_ASYNC_QUEUE];
+	t->tx = (const uint8_t *) txBuf;
+	t->rx = (uint8_t *) rxBuf;
+	t->count = count;
+	t->callback = callback;
+	t->context = context;
+	t->csPin = csPin;
+	spiAsync.count++;
+	if(!spiAsync.busy)
+		spiAsyncStart();
+	MAP_IntEnable(INT_GSPI);
+
+	return true;
+}
+
+static void spiAsyncDone(void *context) {
+	*(volatile bool *) context = true;
+}
+
+/*
+ * Blocking uDMA transfer. It queues behind any pending transfers and
+ * falls back to byte transfers for LSBFIRST.
+ */
+void SPIClass::transfer(const void *txBuf, void *rxBuf, size_t count, uint8_t csPin) {
+	volatile bool done = false;
+
+	if(count == 0) return;
+
+	if(SSIBitOrder == LSBFIRST) {
+		const uint8_t *tx = (const uint8_t *) txBuf;
+		uint8_t *rx = (uint8_t *) rxBuf;
+
+		asyncFlush();
+		if(csPin != SPI_NO_CS) digitalWrite(csPin, LOW);
+		for(size_t i = 0; i < count; i++) {
+			uint8_t data = transfer(tx ? tx[i] : 0xFF);
+			if(rx) rx[i] = data;
+		}
+		if(csPin != SPI_NO_CS) digitalWrite(csPin, HIGH);
+		return;
+	}
+
+	while(!transferAsync(txBuf, rxBuf, count, spiAsyncDone, (void *) &done, csPin))
+		spiAsyncPoll();
+	while(!done)
+		spiAsyncPoll();
+}
+
+uint8_t SPIClass::asyncPending() {
+	return spiAsync.count;
+}
+
+// Wait for the queued transfers, required before using transfer(uint8_t)
+void SPIClass::asyncFlush() {
+	while(spiAsync.count)
+		spiAsyncPoll();
+}
+
+SPISettings::SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+{
+	init(clock, bitOrder, dataMode);
+}
+
+SPISettings::SPISettings()
+{
+	init(4000000, MSBFIRST, SPI_MODE0);
+}
+
+/* With one clock cycle granularity the bit rate is the GSPI clock divided
+ * by the 12 bit divider + 1, split over CLKD and EXTCLK */
+void SPISettings::init(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+{
+	unsigned long spiClk = MAP_PRCMPeripheralClockGet(PRCM_GSPI);
+	uint32_t div = clock ? (spiClk + clock - 1) / clock : 4096;
+
+	div = div ? div - 1 : 0;
+	if(div > 0xFFF) div = 0xFFF;
+
+	conf = ((div & 0x0000000F) << 2) | (dataMode & SPI_MODE_MASK);
+	ctrl = (div & 0x00000FF0) << 4;
+	order = bitOrder;
+}
+
+/*
+ * A pin's interrupt is held off by clearing its GPIO_IM bit, the edge is
+ * still latched and serviced once the mask is restored. Any other
+ * source, or more pins than fit, holds off all interrupts.
+ */
+void SPIClass::usingInterrupt(uint8_t pin)
+{
+	uint8_t i;
+
+	if(digitalPinToPort(pin) == NOT_A_PORT) {
+		interruptMode = 2;
+		return;
+	}
+
+	for(i = 0; i < interruptCount; i++)
+		if(interruptPins[i] == pin) return;
+
+	if(interruptCount == SPI_INTERRUPT_PINS) {
+		interruptMode = 2;
+		return;
+	}
+
+	interruptPins[interruptCount++] = pin;
+	if(interruptMode == 0)
+		interruptMode = 1;
+}
+
+void SPIClass::beginTransaction(const SPISettings &settings)
+{
+	uint8_t i;
+
+	// The settings must not change under a running uDMA transfer. Wait
+	// for it before masking interrupts, its completion is counted by the
+	// SSI interrupt handler
+	asyncFlush();
+
+	if(interruptMode == 2) {
+		interruptState = MAP_IntMasterDisable();
+	} else if(interruptMode == 1) {
+		for(i = 0; i < interruptCount; i++) {
+			uint8_t pin = interruptPins[i];
+			uint32_t im = (uint32_t) portBASERegister(digitalPinToPort(pin)) + GPIO_O_GPIO_IM;
+			uint8_t bit = digitalPinToBitMask(pin);
+
+			interruptSave[i] = HWREG(im) & bit;
+			HWREG(im) &= ~bit;
+		}
+	}
+
+	SSIBitOrder = settings.order;
+	if((HWREG(SSIBASE + MCSPI_O_CH0CONF) & (SPI_CLKD_MASK | SPI_MODE_MASK)) != settings.conf ||
+			(HWREG(SSIBASE + MCSPI_O_CH0CTRL) & SPI_EXTCLK_MASK) != settings.ctrl) {
+		HWREG(SSIBASE + MCSPI_O_CH0CTRL) = settings.ctrl;	// also disables the channel
+		HWREG(SSIBASE + MCSPI_O_CH0CONF) = (HWREG(SSIBASE + MCSPI_O_CH0CONF)
+			& ~(SPI_CLKD_MASK | SPI_MODE_MASK)) | settings.conf;
+		HWREG(SSIBASE + MCSPI_O_CH0CTRL) = settings.ctrl | MCSPI_CH0CTRL_EN;
+	}
+}
+
+void SPIClass::endTransaction(void)
+{
+	uint8_t i;
+
+	if(interruptMode == 2) {
+		if(!interruptState)
+			MAP_IntMasterEnable();
+	} else if(interruptMode == 1) {
+		for(i = 0; i < interruptCount; i++) {
+			uint8_t pin = interruptPins[i];
+			uint32_t im = (uint32_t) portBASERegister(digitalPinToPort(pin)) + GPIO_O_GPIO_IM;
+
+			HWREG(im) |= interruptSave[i];
+		}
+	}
+}
+
 /* Only one module available in the CC3200
  * But we leave it in here in case there will
  * be variants with more modules in the future */
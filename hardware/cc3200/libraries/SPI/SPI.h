@@ -36,12 +36,47 @@
 #define MSBFIRST 1
 #define LSBFIRST 0
 
+// Pending uDMA transfers
+#define SPI_ASYNC_QUEUE 4
+#define SPI_NO_CS 0xFF
+
+typedef void (*SPIAsyncCallback)(void *context);
+
+#define SPI_HAS_TRANSACTION 1
+// Pins whose GPIO interrupt can be held off during a transaction
+#define SPI_INTERRUPT_PINS 4
+
+/*
+ * Settings of one SPI device as the CH0CONF clock divider and mode bits
+ * and the CH0CTRL extended divider, computed from the GSPI clock.
+ */
+class SPISettings
+{
+	public:
+		SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode);
+		SPISettings();
+
+	private:
+		void init(uint32_t clock, uint8_t bitOrder, uint8_t dataMode);
+
+		uint32_t conf;
+		uint32_t ctrl;
+		uint8_t order;
+		friend class SPIClass;
+};
+
 class SPIClass
 {
 	private:
 		uint8_t SSIModule;
 		uint8_t SSIBitOrder;
 
+		uint8_t interruptMode;	// 0 none, 1 pin masks, 2 all interrupts
+		uint8_t interruptCount;
+		uint8_t interruptPins[SPI_INTERRUPT_PINS];
+		uint8_t interruptSave[SPI_INTERRUPT_PINS];
+		bool interruptState;
+
 	public:
 		SPIClass(void);
 		SPIClass(uint8_t);
@@ -56,6 +91,22 @@ class SPIClass
 		void setClockDivider(uint8_t);
 
 		uint8_t transfer(uint8_t);
+
+		// uDMA transfers, either buffer may be NULL for TX or RX only
+		bool transferAsync(const void *txBuf, void *rxBuf, size_t count,
+				SPIAsyncCallback callback = 0, void *context = 0,
+				uint8_t csPin = SPI_NO_CS);
+		void transfer(const void *txBuf, void *rxBuf, size_t count,
+				uint8_t csPin = SPI_NO_CS);
+		uint8_t asyncPending();
+		void asyncFlush();
+
+		// Transactions, interrupts registered with usingInterrupt() are
+		// held off until endTransaction()
+		void usingInterrupt(uint8_t pin);
+		void beginTransaction(const SPISettings &settings);
+		void endTransaction(void);
+
 		void setModule(uint8_t module);
 };
 
@@ -35,6 +35,9 @@
 #include <Energia.h>
 #include "WiFi.h"
 #include "utility/wl_definitions.h"
+#include "inc/hw_types.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/udma.h"
 
 extern "C" {
     #include "utility/simplelink.h"
@@ -80,6 +83,8 @@ int16_t WiFiClass::_handleArray[MAX_SOCK_NUM];
 int16_t WiFiClass::_portArray[MAX_SOCK_NUM];
 int16_t WiFiClass::_typeArray[MAX_SOCK_NUM];
 int16_t WiFiClass::_serverPortArray[MAX_SOCK_NUM];
+uint8_t *WiFiClass::_rxBufferArray[MAX_SOCK_NUM];
+uint16_t WiFiClass::_rxSizeArray[MAX_SOCK_NUM];
 WiFiClient WiFiClass::clients[MAX_SOCK_NUM];
 //
 //These "buffers" are used to "return" strings and IpAddress objects
@@ -111,9 +116,12 @@ bool WiFiClass::init()
     }
 
     //
-    //Initialize the UDMA
+    //Initialize the UDMA, unless SPI.transferAsync() already did: a second
+    //UDMAInit() resets the controller under its queued transfers
     //
-    UDMAInit();
+    if (MAP_uDMAControlBaseGet() == 0) {
+        UDMAInit();
+    }
 
     //
     //start the SimpleLink driver (no callback)
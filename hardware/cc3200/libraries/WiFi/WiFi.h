@@ -56,6 +56,11 @@ public:
     static int16_t _portArray[MAX_SOCK_NUM];
     static int16_t _serverPortArray[MAX_SOCK_NUM];
     static int16_t _typeArray[MAX_SOCK_NUM];
+    //
+    //TCP receive buffer of each socket, shared by all copies of its WiFiClient
+    //
+    static uint8_t *_rxBufferArray[MAX_SOCK_NUM];
+    static uint16_t _rxSizeArray[MAX_SOCK_NUM];
     
     static bool _initialized;
     static bool _connecting;
@@ -35,12 +35,23 @@
 extern "C" {
   #include "utility/wl_definitions.h"
   #include "utility/socket.h"
+  #include "utility/simplelink.h"
+  #include "utility/protocol.h"
+  #include "utility/driver.h"
+  #include "utility/flowcont.h"
+
+  _u16 _sl_TruncatePayloadByProtocol(const _i16 sd, const _u16 length);
 }
 
 #include "WiFi.h"
 #include "WiFiClient.h"
 #include "WiFiServer.h"
 
+//
+//sl_Recv() takes at most 16000 bytes at a time
+//
+#define SL_RECV_MAX_SIZE 16000
+
 //--tested, working--//
 //--client side--//
 WiFiClient::WiFiClient()
@@ -50,6 +61,7 @@ WiFiClient::WiFiClient()
     //
     rx_currentIndex = 0;
     rx_fillLevel = 0;
+    rx_size = TCP_RX_BUFF_DEFAULT_SIZE;
     _socketIndex = NO_SOCKET_AVAIL;
     hasRootCA = false;
     sslVerifyStrict = false;
@@ -65,6 +77,7 @@ WiFiClient::WiFiClient(uint8_t socketIndex)
     //
     rx_currentIndex = 0;
     rx_fillLevel = 0;
+    rx_size = TCP_RX_BUFF_DEFAULT_SIZE;
     _socketIndex = socketIndex;
 }
 
@@ -352,30 +365,119 @@ size_t WiFiClient::write(const uint8_t *buffer, size_t size)
     }
 
     //
-    //write the buffer to the socket
+    //write the buffer to the socket. Whenever the network processor runs out
+    //of room (flow control), wait for it to report room again and go on
+    //with the rest
     //
-    int iRet = sl_Send(WiFiClass::_handleArray[_socketIndex], buffer, size, 0);
+    size_t sent = tryWrite(buffer, size);
+    while (sent < size && _socketIndex != NO_SOCKET_AVAIL) {
+        if (!waitForTxPool(TCP_TX_TIMEOUT)) {
+            break;
+        }
+        sent += tryWrite(buffer + sent, size - sent);
+    }
 
-    // Flow control signal; perform a paced-retry.
-    while (iRet == SL_EAGAIN) {
-        delay(10);
-#ifndef SL_PLATFORM_MULTI_THREADED$
-        /* HACK: required in nonos builds, otherwise we hang in this loop */
-        sl_Task();
-#endif
-        iRet = sl_Send(WiFiClass::_handleArray[_socketIndex], buffer, size, 0);
+    return sent;
+}
+
+size_t WiFiClient::tryWrite(const uint8_t *buffer, size_t size)
+{
+    //
+    //don't do anything if not properly set up
+    //
+    if (_socketIndex == NO_SOCKET_AVAIL) {
+        return 0;
     }
 
-    if ((iRet < 0) || (iRet != size)) {
+    //
+    //send one chunk per sl_Send(). sl_Send() splits a larger buffer itself,
+    //but then reports SL_EAGAIN without saying how much of it went out
+    //
+    size_t chunk = txChunkSize();
+    size_t sent = 0;
+    while (sent < size) {
+        size_t len = (size - sent < chunk) ? size - sent : chunk;
+        int iRet = sl_Send(WiFiClass::_handleArray[_socketIndex], buffer + sent, len, 0);
+
         //
-        //if an error occured or the socket has died, call stop()
-        //to make the object aware that it's dead
+        //flow control signal: no room, nothing of this chunk was sent
         //
-        stop();
+        if (iRet == SL_EAGAIN) {
+            break;
+        }
+
+        if (iRet < 0) {
+            //
+            //if an error occured or the socket has died, call stop()
+            //to make the object aware that it's dead
+            //
+            stop();
+            break;
+        }
+        sent += iRet;
+    }
+
+    return sent;
+}
+
+//
+//Free send buffers in the network processor's transmit pool. Each sl_Send()
+//of up to txChunkSize() bytes takes one, and the driver keeps
+//FLOW_CONT_MIN + 1 for commands. Every message from the network processor
+//carries the current count, including the ones it sends when buffers free up
+//
+static int txPoolFree()
+{
+    if (g_pCB == NULL) {
         return 0;
-    } else {
-        return iRet;
     }
+
+#ifndef SL_PLATFORM_MULTI_THREADED
+    //
+    //read the pending messages from the network processor to update the count
+    //
+    sl_Task();
+#endif
+
+    int count = g_pCB->FlowContCB.TxPoolCnt - (FLOW_CONT_MIN + 1);
+    return (count > 0) ? count : 0;
+}
+
+//
+//Largest payload of a single sl_Send() on this socket, less for SSL
+//
+int WiFiClient::txChunkSize()
+{
+    return _sl_TruncatePayloadByProtocol(WiFiClass::_handleArray[_socketIndex], 0xFFFF);
+}
+
+int WiFiClient::availableForWrite()
+{
+    if (_socketIndex == NO_SOCKET_AVAIL) {
+        return 0;
+    }
+    return txPoolFree() * txChunkSize();
+}
+
+//
+//Wait until the network processor has room for another chunk, checking
+//again after a pause that doubles from TCP_TX_MIN_BACKOFF up to
+//TCP_TX_MAX_BACKOFF. Returns false on timeout
+//
+boolean WiFiClient::waitForTxPool(unsigned long timeout)
+{
+    unsigned long start = millis();
+    unsigned int pause = TCP_TX_MIN_BACKOFF;
+
+    while (txPoolFree() == 0) {
+        if (millis() - start >= timeout) {
+            return false;
+        }
+        delayMicroseconds(pause);
+        pause = (pause * 2 < TCP_TX_MAX_BACKOFF) ? pause * 2 : TCP_TX_MAX_BACKOFF;
+    }
+
+    return true;
 }
 
 //--tested, working--//
@@ -392,45 +494,21 @@ int WiFiClient::available()
     //
     //if the buffer doesn't have any data in it or we've read everything
     //then receive some data
+    //(another copy of this client may have closed the socket and freed
+    //the buffer)
     //
     int bytesLeft = rx_fillLevel - rx_currentIndex;
-    if (bytesLeft <= 0) {
-        SlTimeval_t timeout;
-        memset(&timeout, 0, sizeof(SlTimeval_t));
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 500;
-        SlFdSet_t readsds, errorsds;
-        SL_FD_ZERO(&readsds);
-        SL_FD_ZERO(&errorsds);
-        SL_FD_SET(WiFiClass::_handleArray[_socketIndex], &readsds);
-        SL_FD_SET(WiFiClass::_handleArray[_socketIndex], &errorsds);
-
-//        sl_Select(WiFiClass::_handleArray[_socketIndex] + 1, &readsds, NULL, &errorsds, &timeout);
-//        if(!SL_FD_ISSET(WiFiClass::_handleArray[_socketIndex], &readsds)) return 0;
-
-        //
-        //Receive any pending information into the buffer
-        //if the connection has died, call stop() to make the object aware it's dead
-        //
-        int iRet = sl_Recv(WiFiClass::_handleArray[_socketIndex], rx_buffer, TCP_RX_BUFF_MAX_SIZE, 0);
-        if ((iRet <= 0)  &&  (iRet != SL_EAGAIN)) {
-            sl_Close(WiFiClass::_handleArray[_socketIndex]);
-
-            WiFiClass::_portArray[_socketIndex] = -1;
-            WiFiClass::_handleArray[_socketIndex] = -1;
-            WiFiClass::_typeArray[_socketIndex] = -1;
-            _socketIndex = NO_SOCKET_AVAIL;
-
-            memset(rx_buffer, 0, TCP_RX_BUFF_MAX_SIZE);
+    if (bytesLeft <= 0 || WiFiClass::_rxBufferArray[_socketIndex] == NULL) {
+        uint8_t *buffer = rxBuffer();
+        if (buffer == NULL) {
             return 0;
         }
-        
+
         //
         //receive successful. Reset rx index pointer and set buffer fill level indicator
-        //(if SL_EAGAIN was received, the actual number of bytes received was zero, not -11)
         //
         rx_currentIndex = 0;
-        rx_fillLevel = (iRet != SL_EAGAIN) ? iRet : 0;
+        rx_fillLevel = receive(buffer, WiFiClass::_rxSizeArray[_socketIndex]);
         bytesLeft = rx_fillLevel - rx_currentIndex;
     }
     
@@ -443,6 +521,60 @@ int WiFiClient::available()
     return bytesLeft;
 }
 
+//
+//Receive pending data into buf. Returns the number of bytes received, 0 if
+//there are none. If the connection has died, the socket is closed
+//to make the object aware it's dead
+//
+int WiFiClient::receive(uint8_t *buf, int len)
+{
+    int iRet = sl_Recv(WiFiClass::_handleArray[_socketIndex], buf, len, 0);
+    if ((iRet <= 0)  &&  (iRet != SL_EAGAIN)) {
+        sl_Close(WiFiClass::_handleArray[_socketIndex]);
+        releaseSocket();
+        return 0;
+    }
+
+    //
+    //if SL_EAGAIN was received, the actual number of bytes received was zero, not -11
+    //
+    return (iRet != SL_EAGAIN) ? iRet : 0;
+}
+
+//
+//The receive buffer of the socket, sized to rx_size. It is only resized
+//while empty, so no received data is lost. NULL if there is no memory
+//
+uint8_t *WiFiClient::rxBuffer()
+{
+    uint8_t *buffer = WiFiClass::_rxBufferArray[_socketIndex];
+    if (buffer != NULL && (WiFiClass::_rxSizeArray[_socketIndex] == rx_size || rx_currentIndex < rx_fillLevel)) {
+        return buffer;
+    }
+
+    uint8_t *resized = (uint8_t *)realloc(buffer, rx_size);
+    if (resized == NULL) {
+        //
+        //keep the buffer we have
+        //
+        return buffer;
+    }
+
+    WiFiClass::_rxBufferArray[_socketIndex] = resized;
+    WiFiClass::_rxSizeArray[_socketIndex] = rx_size;
+    return resized;
+}
+
+void WiFiClient::setRxBufferSize(uint16_t size)
+{
+    if (size == 0) {
+        size = 1;
+    } else if (size > TCP_RX_BUFF_MAX_SIZE) {
+        size = TCP_RX_BUFF_MAX_SIZE;
+    }
+    rx_size = size;
+}
+
 //--tested, working--//
 int WiFiClient::read()
 {
@@ -451,7 +583,7 @@ int WiFiClient::read()
     //if there are no more bytes left in the buffer. Returns 0 if nothing more
     //
     if ( available() ) {
-        return rx_buffer[rx_currentIndex++];
+        return WiFiClass::_rxBufferArray[_socketIndex][rx_currentIndex++];
     } else {
         return -1;
     }
@@ -463,6 +595,19 @@ int WiFiClient::read(uint8_t* buf, size_t size)
     //
     // read up to the requested number of bytes into the buffer
     // uses direct buffer copies to speed things up
+    if (_socketIndex == NO_SOCKET_AVAIL) {
+        return 0;
+    }
+
+    //
+    //with nothing buffered, a read at least as large as the receive buffer
+    //goes straight into the caller's buffer, saving a copy and the extra
+    //round trips to the network processor of refilling the smaller one
+    //
+    if (rx_currentIndex >= rx_fillLevel && size >= rx_size) {
+        return receive(buf, size < SL_RECV_MAX_SIZE ? size : SL_RECV_MAX_SIZE);
+    }
+
     if (!available()) {
         return 0;
     }
@@ -471,7 +616,7 @@ int WiFiClient::read(uint8_t* buf, size_t size)
     if (len > size) {
         len = size;
     }
-    memcpy(buf, &rx_buffer[rx_currentIndex], len);
+    memcpy(buf, &WiFiClass::_rxBufferArray[_socketIndex][rx_currentIndex], len);
     rx_currentIndex += len;
 
     return len;
@@ -483,8 +628,8 @@ int WiFiClient::peek()
     //
     //return the next byte in the buffer or zero if we're past the end of the data
     //
-    if (rx_currentIndex < rx_fillLevel) {
-        return rx_buffer[rx_currentIndex];
+    if (_socketIndex != NO_SOCKET_AVAIL && rx_currentIndex < rx_fillLevel && WiFiClass::_rxBufferArray[_socketIndex] != NULL) {
+        return WiFiClass::_rxBufferArray[_socketIndex][rx_currentIndex];
     } else {
         return -1;
     }
@@ -494,9 +639,8 @@ int WiFiClient::peek()
 void WiFiClient::flush()
 {
     //
-    //clear out the buffer and reset all the buffer indicators
+    //discard the buffered data by resetting the buffer indicators
     //
-    memset(rx_buffer, 0, TCP_RX_BUFF_MAX_SIZE);
     rx_fillLevel = 0;
     rx_currentIndex = 0;
 }
@@ -513,7 +657,7 @@ void WiFiClient::stop()
     
     //
     //disconnect, destroy the socket, and reset the socket tracking variables
-    //in WiFiClass, but don't destroy any of the received data
+    //in WiFiClass. Data still buffered is discarded with the receive buffer
     //
     int iRet = sl_Close(WiFiClass::_handleArray[_socketIndex]);
     if (iRet < 0) {
@@ -523,11 +667,23 @@ void WiFiClient::stop()
     //
     //since no error occurred while closing the socket, reset WiFiClass variables
     //
+    releaseSocket();
+}
+
+//
+//Reset the WiFiClass variables of the closed socket and free its receive buffer
+//
+void WiFiClient::releaseSocket()
+{
     WiFiClass::_portArray[_socketIndex] = -1;
     WiFiClass::_handleArray[_socketIndex] = -1;
     WiFiClass::_typeArray[_socketIndex] = -1;
+    free(WiFiClass::_rxBufferArray[_socketIndex]);
+    WiFiClass::_rxBufferArray[_socketIndex] = NULL;
+    WiFiClass::_rxSizeArray[_socketIndex] = 0;
     _socketIndex = NO_SOCKET_AVAIL;
-    
+    rx_fillLevel = 0;
+    rx_currentIndex = 0;
 }
 
 //!! works, sort of, dependent on status(), which needs work !!//
@@ -24,7 +24,20 @@
 #include <Stream.h>
 #include <Client.h>
 
-#define TCP_RX_BUFF_MAX_SIZE 255
+//
+//Default and largest size of the receive buffer. The largest holds one
+//full TCP segment
+//
+#define TCP_RX_BUFF_DEFAULT_SIZE 255
+#define TCP_RX_BUFF_MAX_SIZE 1460
+
+//
+//How long write() waits for the network processor to take more data (ms),
+//and the range of the pause between checks while it waits (us)
+//
+#define TCP_TX_TIMEOUT 10000
+#define TCP_TX_MIN_BACKOFF 100
+#define TCP_TX_MAX_BACKOFF 10000
 
 //
 //Inhereting from stream (which inherits from print)
@@ -50,9 +63,23 @@ public:
     //virtual const char *sslGetReason(void);
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *buffer, size_t size);
+    //
+    //Non-blocking write: sends as much as the network processor has room
+    //for and returns the number of bytes sent, 0 while the link is congested
+    //
+    size_t tryWrite(const uint8_t *buffer, size_t size);
+    //
+    //Bytes tryWrite() can send right now
+    //
+    int availableForWrite();
     virtual int available();
     virtual int read();
     virtual int read(uint8_t* buf, size_t size);
+    //
+    //Bytes received from the network processor at a time, up to
+    //TCP_RX_BUFF_MAX_SIZE. Takes effect once the buffer has been read empty
+    //
+    void setRxBufferSize(uint16_t size);
     virtual int peek();
     virtual void flush();
     virtual void stop();
@@ -65,12 +92,18 @@ public:
     
 protected:
     int _socketIndex;
-    uint8_t rx_buffer[TCP_RX_BUFF_MAX_SIZE];
+    uint16_t rx_size;
     int rx_fillLevel;
     int rx_currentIndex;
     boolean sslVerifyStrict;
     boolean hasRootCA;
     int32_t sslLastError;
+
+    uint8_t *rxBuffer();
+    int txChunkSize();
+    boolean waitForTxPool(unsigned long timeout);
+    int receive(uint8_t *buf, int len);
+    void releaseSocket();
 };
 
 #endif
@@ -202,10 +202,10 @@ size_t WiFiServer::write(const uint8_t *buffer, size_t size)
         if (WiFiClass::_typeArray[i] == TYPE_TCP_CONNECTED_CLIENT) {
             //
             //Write the data to the connected client and increment
-            //the number of bytes send
+            //the number of bytes send. WiFiClient::write() waits out
+            //flow control
             //
-            int handle = WiFiClass::_handleArray[i];
-            sentBytes += sl_Send(handle, buffer, size, 0);
+            sentBytes += WiFiClass::clients[i].write(buffer, size);
         }
     }
     return sentBytes;
@@ -216,7 +216,19 @@ void loop(void);
 
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, uint32_t len);
+void shiftInBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, uint32_t len);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
+
+#define PULSE_CAPTURE_MAX 8
+uint8_t pulseInStart(uint8_t pin, uint8_t state);
+uint8_t pulseInAvailable(uint8_t pin);
+unsigned long pulseInResult(uint8_t pin);
+uint8_t pulseMeasureBegin(uint8_t pin, void (*callback)(uint8_t pin, unsigned long high, unsigned long period));
+unsigned long pulseMeasureHigh(uint8_t pin);
+unsigned long pulseMeasurePeriod(uint8_t pin);
+void pulseCaptureEnd(uint8_t pin);
+
 void pinMode(uint8_t, uint8_t);
 void digitalWrite(uint8_t, uint8_t);
 int digitalRead(uint8_t);
@@ -227,6 +239,27 @@ void analogReference(uint16_t);
 void analogFrequency(uint32_t);
 void analogResolution(uint16_t);
 
+#define PWM_EDGE_ALIGNED 0
+#define PWM_CENTER_ALIGNED 1
+uint8_t PWMGenBegin(uint8_t pin, uint32_t freq, uint8_t mode, uint32_t deadBand);
+void PWMGenWrite(uint8_t pin, uint32_t analog_res, uint32_t duty);
+
+//
+// Multi-channel scan: all channels of a group are converted back to back
+// from a single trigger using ADC0 sequencer 0 (up to 8 steps) or
+// sequencer 1 (up to 4 steps).
+//
+#define ANALOG_SCAN_MAX 8
+typedef struct {
+    uint8_t count;
+    uint8_t sequencer;
+    uint32_t steps[ANALOG_SCAN_MAX];
+} analogScan_t;
+
+uint8_t analogScanBegin(analogScan_t *scan, const uint8_t pins[], uint8_t count);
+void analogScanRead(analogScan_t *scan, uint16_t values[]);
+uint8_t analogReadMulti(const uint8_t pins[], uint8_t count, uint16_t values[]);
+
 void delay(uint32_t milliseconds);
 void sleep(uint32_t milliseconds);
 void sleepSeconds(uint32_t seconds);
@@ -236,6 +269,17 @@ extern volatile boolean stay_asleep;
 
 void attachInterrupt(uint8_t, void (*)(void), int mode);
 void detachInterrupt(uint8_t);
+void attachInterruptFast(uint8_t, void (*)(uint8_t pin, void *context), void *context, int mode);
+
+#define INTERRUPT_STATS_MAX 8
+typedef struct {
+    uint32_t count;         // handler calls
+    uint32_t latency;       // cycles from port handler entry to the last call
+    uint32_t maxLatency;
+} interruptStats_t;
+uint8_t interruptStatsBegin(uint8_t);
+void interruptStatsEnd(uint8_t);
+uint8_t interruptStats(uint8_t, interruptStats_t *stats);
 
 extern const uint8_t digital_pin_to_timer[];
 extern const uint8_t digital_pin_to_port[];
@@ -316,6 +360,12 @@ void tone(uint8_t _pin, unsigned int frequency);
 void tone(uint8_t _pin, unsigned int frequency, unsigned long duration);
 void noTone(uint8_t _pin);
 
+typedef struct {
+    uint16_t frequency;     // Hz, 0 for a rest
+    uint16_t duration;      // milliseconds
+} toneNote_t;
+void toneSequence(uint8_t _pin, const toneNote_t *notes, uint16_t count);
+
 // WMath prototypes
 long random(long);
 long random(long, long);
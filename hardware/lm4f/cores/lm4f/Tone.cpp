@@ -46,29 +46,154 @@ Version Modified By Date     Comments
 #include "driverlib/timer.h"
 #include "driverlib/sysctl.h"
 
-// tone_duration:
-//  > 0 - duration specified
-//  = 0 - stopped
-//  < 0 - infinitely (until stop() method called, or new play() called)
+//
+// Every voice runs on the timer behind its own pin, so several pins can
+// sound at once and no interrupt is taken per period. Durations and
+// sequence steps are timed by Timer 4A in one-shot mode, reloaded for the
+// next voice that is due, so it only interrupts when a note ends.
+//
+#define TONE_MAX_VOICES 4
+
+typedef struct {
+    uint8_t pin;                // 0 when the voice is free
+    uint8_t timer;
+    uint8_t timed;              // end is valid
+    unsigned long end;          // millis() at which the current note ends
+    const toneNote_t *notes;
+    uint16_t count;
+    uint16_t index;
+} toneVoice_t;
+
+static toneVoice_t voices[TONE_MAX_VOICES];
+static uint8_t tone_timer_init = 0;
+
+//
+// Longest one-shot load in milliseconds that fits the 32 bit timer
+//
+#define TONE_MAX_WAIT (0xFFFFFFFFUL / (F_CPU / 1000))
+
+//
+// NOT_ON_TIMER aliases the first timer half on some parts, so check that
+// the timer's CCP really lands on the pin
+//
+static uint8_t toneOnTimer(uint8_t _pin, uint8_t timer)
+{
+    return pinConfigToPort(timerToPinConfig(timer)) == digitalPinToPort(_pin)
+        && pinConfigToBitMask(timerToPinConfig(timer)) == digitalPinToBitMask(_pin);
+}
+
+static void toneOutput(toneVoice_t *v, unsigned int frequency)
+{
+    if (frequency == 0) {
+        if (toneOnTimer(v->pin, v->timer)) {
+            uint32_t timerBase = getTimerBase(timerToOffset(v->timer));
+            ROM_TimerDisable(timerBase, TIMER_A << timerToAB(v->timer));
+        }
+        pinMode(v->pin, OUTPUT);
+        digitalWrite(v->pin, LOW);
+    } else {
+        PWMWrite(v->pin, 256, 128, frequency);
+    }
+}
 
-static uint8_t tone_state = 0; // 0==not initialized, 1==timer running
-static uint8_t current_pin = 0;
-static long g_duration = 0;
-static uint8_t tone_timer = 0;
+static void toneRelease(toneVoice_t *v)
+{
+    toneOutput(v, 0);
+    v->pin = 0;
+    v->timed = 0;
+    v->notes = 0;
+}
+
+//
+// Stop or advance every voice that is due and arm Timer 4A for the next one.
+// Runs with the Timer 4A interrupt masked or from its handler.
+//
+static void toneSchedule(void)
+{
+    unsigned long now = millis();
+    unsigned long wait = TONE_MAX_WAIT;
+    uint8_t i, pending = 0;
+    toneVoice_t *v;
+
+    for (i = 0; i < TONE_MAX_VOICES; i++) {
+        v = &voices[i];
+        if (v->pin == 0 || !v->timed)
+            continue;
+
+        while (v->timed && (long)(now - v->end) >= 0) {
+            if (v->notes && ++v->index < v->count) {
+                toneOutput(v, v->notes[v->index].frequency);
+                v->end += v->notes[v->index].duration;
+            } else {
+                toneRelease(v);
+            }
+        }
+
+        if (v->timed) {
+            pending = 1;
+            if (v->end - now < wait)
+                wait = v->end - now;
+        }
+    }
+
+    ROM_TimerDisable(TIMER4_BASE, TIMER_A);
+    ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
+    if (pending) {
+        ROM_TimerLoadSet(TIMER4_BASE, TIMER_A, wait * (F_CPU / 1000));
+        ROM_TimerEnable(TIMER4_BASE, TIMER_A);
+    }
+}
 
 void
 ToneIntHandler(void)
 {
-    ROM_TimerIntClear(TIMER4_BASE, TIMER_A);
-
-    //End of tone duration
-    if(--g_duration <= 0) {
-        	noTone(current_pin);
-    		ROM_TimerIntDisable(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
-    		ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
-    		ROM_TimerDisable(TIMER4_BASE, TIMER_A);
+    ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
+    toneSchedule();
+}
+
+static toneVoice_t *toneVoice(uint8_t _pin)
+{
+    uint8_t timer = digitalPinToTimer(_pin);
+    toneVoice_t *free = 0;
+    uint8_t i;
+
+    if (_pin == 0 || digitalPinToPort(_pin) == NOT_A_PORT) return 0;
+
+    for (i = 0; i < TONE_MAX_VOICES; i++) {
+        if (voices[i].pin == _pin)
+            return &voices[i];
+        // a timer half can only produce one frequency
+        if (voices[i].pin != 0 && voices[i].timer == timer
+                && toneOnTimer(voices[i].pin, timer) && toneOnTimer(_pin, timer))
+            return 0;
+        if (voices[i].pin == 0 && free == 0)
+            free = &voices[i];
+    }
+
+    if (free) {
+        free->pin = _pin;
+        free->timer = timer;
+        free->timed = 0;
+        free->notes = 0;
+    }
+    return free;
+}
+
+static void toneStart(toneVoice_t *v, unsigned int frequency, unsigned long duration)
+{
+    if (!tone_timer_init) {
+        ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER4);
+        ROM_TimerConfigure(TIMER4_BASE, TIMER_CFG_ONE_SHOT);
+        ROM_TimerIntEnable(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
+        tone_timer_init = 1;
     }
 
+    ROM_IntDisable(INT_TIMER4A);
+    toneOutput(v, frequency);
+    v->timed = (duration > 0);
+    v->end = millis() + duration;
+    toneSchedule();
+    ROM_IntEnable(INT_TIMER4A);
 }
 
 /**
@@ -81,41 +206,32 @@ ToneIntHandler(void)
 
 void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
 {
-    uint8_t port = digitalPinToPort(_pin);
-    if (port == NOT_A_PORT) return;
-    if (tone_state == 0 || _pin == current_pin) {
-
-    	//Setup PWM
-    	current_pin = _pin;
-        tone_timer = digitalPinToTimer(_pin);
-        tone_state = 1;
-        g_duration = duration;
-        PWMWrite(_pin, 256, 128, frequency);
-
-        //Setup interrupts for duration, interrupting at 1kHz
-        ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER4);
-        ROM_IntMasterEnable();
-        ROM_TimerConfigure(TIMER4_BASE, TIMER_CFG_PERIODIC);
-        ROM_TimerLoadSet(TIMER4_BASE, TIMER_A, F_CPU/1000);
-        ROM_IntEnable(INT_TIMER4A);
-        ROM_TimerIntEnable(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
-        ROM_TimerEnable(TIMER4_BASE, TIMER_A);
-    }
+    toneVoice_t *v = toneVoice(_pin);
+
+    if (v == 0) return;
+    v->notes = 0;
+    toneStart(v, frequency, duration);
 }
 
 void tone(uint8_t _pin, unsigned int frequency)
 {
+    tone(_pin, frequency, 0);
+}
 
-    uint8_t port = digitalPinToPort(_pin);
-
-    if (port == NOT_A_PORT) return;
-
-    if(tone_state == 0 || _pin == current_pin) {
-        tone_timer = digitalPinToTimer(_pin);
-        PWMWrite(_pin, 256, 128, frequency);
-        tone_state = 1;
-    }
+/**
+ *** toneSequence() -- Play count notes on a pin one after the other. The
+ ***  notes array must stay valid until the sequence ends. A frequency of
+ ***  0 is a rest.
+ **/
+void toneSequence(uint8_t _pin, const toneNote_t *notes, uint16_t count)
+{
+    toneVoice_t *v;
 
+    if (count == 0 || (v = toneVoice(_pin)) == 0) return;
+    v->notes = notes;
+    v->count = count;
+    v->index = 0;
+    toneStart(v, notes[0].frequency, notes[0].duration ? notes[0].duration : 1);
 }
 
 /*
@@ -123,21 +239,14 @@ void tone(uint8_t _pin, unsigned int frequency)
  */
 void noTone(uint8_t _pin)
 {
-
-	uint8_t timer = digitalPinToTimer(_pin);
-
-    if(timer == tone_timer) {
-		uint32_t timerBase = getTimerBase(timerToOffset(timer));
-		uint32_t timerAB = TIMER_A << timerToAB(timer);
-		ROM_TimerIntDisable(timerBase, TIMER_TIMA_TIMEOUT << timerToAB(tone_timer));
-		ROM_TimerIntClear(timerBase, TIMER_TIMA_TIMEOUT << timerToAB(tone_timer));
-		ROM_TimerDisable(timerBase, timerAB);
-		tone_state = 0;
-		g_duration = 0;
-		pinMode(_pin, OUTPUT);
-		digitalWrite(_pin, LOW);
+    uint8_t i;
+
+    for (i = 0; i < TONE_MAX_VOICES; i++) {
+        if (voices[i].pin != 0 && voices[i].pin == _pin) {
+            ROM_IntDisable(INT_TIMER4A);
+            toneRelease(&voices[i]);
+            toneSchedule();
+            ROM_IntEnable(INT_TIMER4A);
+        }
     }
-
 }
-
-
@@ -38,145 +38,132 @@
 #include "inc/hw_types.h"
 #include "inc/hw_nvic.h"
 #include "inc/hw_ints.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_memmap.h"
 #include "driverlib/gpio.h"
 #include "wiring_private.h"
 #include "driverlib/rom.h"
 
-static void (*cbFuncsA[8])(void);
-static void (*cbFuncsB[8])(void);
-static void (*cbFuncsC[8])(void);
-static void (*cbFuncsD[8])(void);
-static void (*cbFuncsE[8])(void);
-static void (*cbFuncsF[8])(void);
-static void (*cbFuncsG[8])(void);
-static void (*cbFuncsH[8])(void);
-static void (*cbFuncsJ[8])(void);
-static void (*cbFuncsK[8])(void);
-static void (*cbFuncsL[8])(void);
-static void (*cbFuncsM[8])(void);
-static void (*cbFuncsN[8])(void);
-static void (*cbFuncsP[8])(void);
-static void (*cbFuncsQ[8])(void);
-#ifdef TARGET_IS_SNOWFLAKE_RA0
-static void (*cbFuncsR[8])(void);
-static void (*cbFuncsS[8])(void);
-static void (*cbFuncsT[8])(void);
-#endif
-
-void GPIOXIntHandler(uint32_t base, void (**funcs)(void))
-{
-	uint32_t i;
-	uint32_t isr = GPIOIntStatus(base, true);
+//
+// DWT cycle counter, used for the dispatch latency statistics
+//
+#define DWT_O_CTRL              0x00000000
+#define DWT_O_CYCCNT            0x00000004
+#define DWT_CTRL_CYCCNTENA      0x00000001
+#define NVIC_DBG_INT_TRCENA     0x01000000
 
-	GPIOIntClear(base, isr);
+typedef struct {
+	void (*func)(void);	// a gpioIntFastFunc_t when fast is set
+	void *context;
+	uint8_t pin;
+	uint8_t fast;
+	uint8_t stats;		// 1 + index into intStats[], 0 when not tracked
+} gpioIntSlot_t;
 
-	for (i=0; i<8; i++, isr>>=1) {
-		if ((isr & 0x1) == 0)
-			continue;
-		if (funcs[i])
-			funcs[i]();
-	}
-}
-
-void GPIOAIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTA_BASE, cbFuncsA);
-}
-
-void GPIOBIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTB_BASE, cbFuncsB);
-}
-
-void GPIOCIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTC_BASE, cbFuncsC);
-}
+typedef void (*gpioIntFastFunc_t)(uint8_t pin, void *context);
 
-void GPIODIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTD_BASE, cbFuncsD);
-}
-
-void GPIOEIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTE_BASE, cbFuncsE);
-}
-
-void GPIOFIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTF_BASE, cbFuncsF);
-}
-
-void GPIOGIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTG_BASE, cbFuncsG);
-}
-
-void GPIOHIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTH_BASE, cbFuncsH);
-}
-
-void GPIOJIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTJ_BASE, cbFuncsJ);
-}
-
-void GPIOKIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTK_BASE, cbFuncsK);
-}
-
-void GPIOLIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTL_BASE, cbFuncsL);
-}
+#ifdef TARGET_IS_SNOWFLAKE_RA0
+#define GPIO_INT_PORTS (PT - PA + 1)
+#else
+#define GPIO_INT_PORTS (PQ - PA + 1)
+#endif
 
-void GPIOMIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTM_BASE, cbFuncsM);
-}
-void GPIONIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTN_BASE, cbFuncsN);
-}
+static gpioIntSlot_t intSlots[GPIO_INT_PORTS][8];
+static interruptStats_t intStats[INTERRUPT_STATS_MAX];
+static uint8_t intStatsPin[INTERRUPT_STATS_MAX];
 
-void GPIOPIntHandler(void)
+static const uint8_t gpio_int[] = {
+	INT_GPIOA, INT_GPIOB, INT_GPIOC, INT_GPIOD, INT_GPIOE, INT_GPIOF,
+	INT_GPIOG, INT_GPIOH, INT_GPIOJ, INT_GPIOK, INT_GPIOL, INT_GPIOM,
+	INT_GPION, INT_GPIOP0, INT_GPIOQ0,
+#ifdef TARGET_IS_SNOWFLAKE_RA0
+	INT_GPIOR, INT_GPIOS, INT_GPIOT,
+#endif
+};
+
+//
+// Dispatch every pending pin, highest pin first, by counting leading zeros
+// of the masked status. Status is read and acknowledged through the
+// registers directly to keep the path short.
+//
+static inline void GPIOXIntHandler(uint32_t base, gpioIntSlot_t *slots)
 {
-	GPIOXIntHandler(GPIO_PORTP_BASE, cbFuncsP);
+	uint32_t start = HWREG(DWT_BASE + DWT_O_CYCCNT);
+	uint32_t isr = HWREG(base + GPIO_O_MIS) & 0xFF;
+	uint32_t i, cycles;
+	gpioIntSlot_t *slot;
+	interruptStats_t *stats;
+
+	HWREG(base + GPIO_O_ICR) = isr;
+
+	while (isr) {
+		i = 31 - __builtin_clz(isr);
+		isr &= ~(1 << i);
+		slot = &slots[i];
+
+		if (slot->stats) {
+			cycles = HWREG(DWT_BASE + DWT_O_CYCCNT) - start;
+			stats = &intStats[slot->stats - 1];
+			stats->latency = cycles;
+			if (cycles > stats->maxLatency)
+				stats->maxLatency = cycles;
+			stats->count++;
+		}
+
+		if (slot->fast)
+			((gpioIntFastFunc_t) slot->func)(slot->pin, slot->context);
+		else if (slot->func)
+			slot->func();
+	}
 }
 
-void GPIOQIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTQ_BASE, cbFuncsQ);
-}
+#define GPIO_INT_HANDLER(p) \
+	void GPIO##p##IntHandler(void) \
+	{ \
+		GPIOXIntHandler(GPIO_PORT##p##_BASE, intSlots[P##p - PA]); \
+	}
 
+GPIO_INT_HANDLER(A)
+GPIO_INT_HANDLER(B)
+GPIO_INT_HANDLER(C)
+GPIO_INT_HANDLER(D)
+GPIO_INT_HANDLER(E)
+GPIO_INT_HANDLER(F)
+GPIO_INT_HANDLER(G)
+GPIO_INT_HANDLER(H)
+GPIO_INT_HANDLER(J)
+GPIO_INT_HANDLER(K)
+GPIO_INT_HANDLER(L)
+GPIO_INT_HANDLER(M)
+GPIO_INT_HANDLER(N)
+GPIO_INT_HANDLER(P)
+GPIO_INT_HANDLER(Q)
 #ifdef TARGET_IS_SNOWFLAKE_RA0
-void GPIORIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTR_BASE, cbFuncsR);
-}
+GPIO_INT_HANDLER(R)
+GPIO_INT_HANDLER(S)
+GPIO_INT_HANDLER(T)
+#endif
 
-void GPIOSIntHandler(void)
+static gpioIntSlot_t *gpioIntSlot(uint8_t pin)
 {
-	GPIOXIntHandler(GPIO_PORTS_BASE, cbFuncsS);
-}
+	uint8_t port = digitalPinToPort(pin);
 
-void GPIOTIntHandler(void)
-{
-	GPIOXIntHandler(GPIO_PORTT_BASE, cbFuncsT);
+	if (port == NOT_A_PORT || port - PA >= GPIO_INT_PORTS) return 0;
+	return &intSlots[port - PA][31 - __builtin_clz(digitalPinToBitMask(pin))];
 }
-#endif
 
-void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+static void attachInterruptSlot(uint8_t interruptNum, void (*func)(void),
+		void *context, uint8_t fast, int mode)
 {
 	uint32_t lm4fMode, i;
+	gpioIntSlot_t *slot = gpioIntSlot(interruptNum);
 
 	uint8_t bit = digitalPinToBitMask(interruptNum);
 	uint8_t port = digitalPinToPort(interruptNum);
 	uint32_t portBase = (uint32_t) portBASERegister(port);
 
+	if (slot == 0) return;
+
 	switch(mode) {
 	case LOW:
 		lm4fMode = GPIO_LOW_LEVEL;
@@ -195,163 +182,109 @@ void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
 	}
 
 	ROM_IntMasterDisable();
-	GPIOIntClear(portBase, bit);
+	HWREG(portBase + GPIO_O_ICR) = bit;
 	ROM_GPIOIntTypeSet(portBase, bit, lm4fMode);
-	GPIOIntEnable(portBase, bit);
-
-	for (i=0; i<8; i++, bit>>=1) {
-		if ((bit & 0x1) == 1)
-			break;
-	}
-
-	switch(portBase) {
-	case GPIO_PORTA_BASE:
-		cbFuncsA[i] = userFunc;
-		ROM_IntEnable(INT_GPIOA);
-		break;
-	case GPIO_PORTB_BASE:
-		cbFuncsB[i] = userFunc;
-		ROM_IntEnable(INT_GPIOB);
-		break;
-	case GPIO_PORTC_BASE:
-		cbFuncsC[i] = userFunc;
-		ROM_IntEnable(INT_GPIOC);
-		break;
-	case GPIO_PORTD_BASE:
-		cbFuncsD[i] = userFunc;
-		ROM_IntEnable(INT_GPIOD);
-		break;
-	case GPIO_PORTE_BASE:
-		cbFuncsE[i] = userFunc;
-		ROM_IntEnable(INT_GPIOE);
-		break;
-	case GPIO_PORTF_BASE:
-		cbFuncsF[i] = userFunc;
-		ROM_IntEnable(INT_GPIOF);
-		break;
-	case GPIO_PORTG_BASE:
-		cbFuncsG[i] = userFunc;
-		ROM_IntEnable(INT_GPIOG);
-		break;
-	case GPIO_PORTH_BASE:
-		cbFuncsH[i] = userFunc;
-		ROM_IntEnable(INT_GPIOH);
-		break;
-	case GPIO_PORTJ_BASE:
-		cbFuncsJ[i] = userFunc;
-		ROM_IntEnable(INT_GPIOJ);
-		break;
-	case GPIO_PORTK_BASE:
-		cbFuncsK[i] = userFunc;
-		ROM_IntEnable(INT_GPIOK);
-		break;
-	case GPIO_PORTL_BASE:
-		cbFuncsL[i] = userFunc;
-		ROM_IntEnable(INT_GPIOL);
-		break;
-	case GPIO_PORTM_BASE:
-		cbFuncsM[i] = userFunc;
-		ROM_IntEnable(INT_GPIOM);
-		break;
-	case GPIO_PORTN_BASE:
-		cbFuncsN[i] = userFunc;
-		ROM_IntEnable(INT_GPION);
-		break;
-	case GPIO_PORTP_BASE:
-		cbFuncsP[i] = userFunc;
-		ROM_IntEnable(INT_GPIOP0);
-		ROM_IntEnable(INT_GPIOP1);
-		ROM_IntEnable(INT_GPIOP2);
-		ROM_IntEnable(INT_GPIOP3);
-		ROM_IntEnable(INT_GPIOP4);
-		ROM_IntEnable(INT_GPIOP5);
-		ROM_IntEnable(INT_GPIOP6);
-		ROM_IntEnable(INT_GPIOP7);
-		break;
-	case GPIO_PORTQ_BASE:
-		cbFuncsQ[i] = userFunc;
-		ROM_IntEnable(INT_GPIOQ0);
-		ROM_IntEnable(INT_GPIOQ1);
-		ROM_IntEnable(INT_GPIOQ2);
-		ROM_IntEnable(INT_GPIOQ3);
-		ROM_IntEnable(INT_GPIOQ4);
-		ROM_IntEnable(INT_GPIOQ5);
-		ROM_IntEnable(INT_GPIOQ6);
-		ROM_IntEnable(INT_GPIOQ7);
-		break;
-#ifdef TARGET_IS_SNOWFLAKE_RA0
-	case GPIO_PORTR_BASE:
-		cbFuncsR[i] = userFunc;
-		ROM_IntEnable(INT_GPIOR);
-		break;
-	case GPIO_PORTS_BASE:
-		cbFuncsS[i] = userFunc;
-		ROM_IntEnable(INT_GPIOS);
-		break;
-	case GPIO_PORTT_BASE:
-		cbFuncsT[i] = userFunc;
-		ROM_IntEnable(INT_GPIOT);
-		break;
-#endif
+	HWREG(portBase + GPIO_O_IM) |= bit;
+
+	slot->func = func;
+	slot->context = context;
+	slot->pin = interruptNum;
+	slot->fast = fast;
+
+	//
+	// Ports P and Q have a vector per pin
+	//
+	if (port == PP || port == PQ) {
+		for (i = 0; i < 8; i++)
+			ROM_IntEnable(gpio_int[port - PA] + i);
+	} else {
+		ROM_IntEnable(gpio_int[port - PA]);
 	}
 	ROM_IntMasterEnable();
 }
 
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+	attachInterruptSlot(interruptNum, userFunc, 0, 0, mode);
+}
+
+void attachInterruptFast(uint8_t interruptNum,
+		void (*userFunc)(uint8_t pin, void *context), void *context, int mode)
+{
+	attachInterruptSlot(interruptNum, (void (*)(void)) userFunc, context, 1, mode);
+}
+
 void detachInterrupt(uint8_t interruptNum)
 {
-	uint32_t i;
+	gpioIntSlot_t *slot = gpioIntSlot(interruptNum);
 
 	uint8_t bit = digitalPinToBitMask(interruptNum);
 	uint8_t port = digitalPinToPort(interruptNum);
 	uint32_t portBase = (uint32_t) portBASERegister(port);
 
-	if (port == NOT_A_PIN) return;
+	if (slot == 0) return;
+
+	HWREG(portBase + GPIO_O_IM) &= ~bit;
+	slot->func = 0;
+	slot->fast = 0;
+}
+
+//
+// Dispatch statistics are kept for up to INTERRUPT_STATS_MAX pins. The
+// latency is counted in CPU cycles from entry of the port handler to the
+// call of the pin's handler, so it includes the dispatch of any higher
+// pin on the same port that fired at the same time.
+//
+uint8_t interruptStatsBegin(uint8_t interruptNum)
+{
+	gpioIntSlot_t *slot = gpioIntSlot(interruptNum);
+	uint8_t i, free = INTERRUPT_STATS_MAX;
 
-	GPIOIntDisable(portBase, bit);
+	if (slot == 0) return 0;
 
-	for (i=0; i<8; i++, bit>>=1) {
-		if ((bit & 0x1) == 1)
+	for (i = 0; i < INTERRUPT_STATS_MAX; i++) {
+		if (intStatsPin[i] == interruptNum) {
+			free = i;
 			break;
+		}
+		if (intStatsPin[i] == 0 && free == INTERRUPT_STATS_MAX)
+			free = i;
 	}
+	if (free == INTERRUPT_STATS_MAX) return 0;
 
-	switch(portBase) {
-	case GPIO_PORTA_BASE:
-		cbFuncsA[i] = 0;
-	case GPIO_PORTB_BASE:
-		cbFuncsB[i] = 0;
-	case GPIO_PORTC_BASE:
-		cbFuncsC[i] = 0;
-	case GPIO_PORTD_BASE:
-		cbFuncsD[i] = 0;
-	case GPIO_PORTE_BASE:
-		cbFuncsE[i] = 0;
-	case GPIO_PORTF_BASE:
-		cbFuncsF[i] = 0;
-	case GPIO_PORTG_BASE:
-		cbFuncsG[i] = 0;
-	case GPIO_PORTH_BASE:
-		cbFuncsH[i] = 0;
-	case GPIO_PORTJ_BASE:
-		cbFuncsJ[i] = 0;
-	case GPIO_PORTK_BASE:
-		cbFuncsK[i] = 0;
-	case GPIO_PORTL_BASE:
-		cbFuncsL[i] = 0;
-	case GPIO_PORTM_BASE:
-		cbFuncsM[i] = 0;
-	case GPIO_PORTN_BASE:
-		cbFuncsN[i] = 0;
-	case GPIO_PORTP_BASE:
-		cbFuncsP[i] = 0;
-	case GPIO_PORTQ_BASE:
-		cbFuncsQ[i] = 0;
-#ifdef TARGET_IS_SNOWFLAKE_RA0
-	case GPIO_PORTR_BASE:
-		cbFuncsR[i] = 0;
-	case GPIO_PORTS_BASE:
-		cbFuncsS[i] = 0;
-	case GPIO_PORTT_BASE:
-		cbFuncsT[i] = 0;
-#endif
-	}
+	HWREG(NVIC_DBG_INT) |= NVIC_DBG_INT_TRCENA;
+	HWREG(DWT_BASE + DWT_O_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+	ROM_IntMasterDisable();
+	intStats[free].count = 0;
+	intStats[free].latency = 0;
+	intStats[free].maxLatency = 0;
+	intStatsPin[free] = interruptNum;
+	slot->stats = free + 1;
+	ROM_IntMasterEnable();
+
+	return 1;
+}
+
+void interruptStatsEnd(uint8_t interruptNum)
+{
+	gpioIntSlot_t *slot = gpioIntSlot(interruptNum);
+
+	if (slot == 0 || slot->stats == 0) return;
+
+	intStatsPin[slot->stats - 1] = 0;
+	slot->stats = 0;
+}
+
+uint8_t interruptStats(uint8_t interruptNum, interruptStats_t *stats)
+{
+	gpioIntSlot_t *slot = gpioIntSlot(interruptNum);
+
+	if (slot == 0 || slot->stats == 0) return 0;
+
+	ROM_IntMasterDisable();
+	*stats = intStats[slot->stats - 1];
+	ROM_IntMasterEnable();
+
+	return 1;
 }
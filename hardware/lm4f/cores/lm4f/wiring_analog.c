@@ -33,11 +33,14 @@
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/hw_timer.h"
+#include "inc/hw_gpio.h"
 #include "inc/hw_ints.h"
+#include "inc/hw_pwm.h"
 #include "driverlib/adc.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/pin_map.h"
+#include "driverlib/pwm.h"
 #include "driverlib/rom.h"
 #include "driverlib/timer.h"
 
@@ -106,6 +109,18 @@ void enableTimerPeriph(uint32_t offset) {
 void analogReference(uint16_t mode) {
 }
 
+//
+// Per timer half state of the last PWMWrite() so that duty updates on an
+// already running output only store the new match value.
+//
+#define PWM_TIMER_HALVES 24
+typedef struct {
+    uint8_t pin;
+    unsigned int freq;
+    uint32_t period;
+} pwmTimerState_t;
+static pwmTimerState_t _pwmTimer[PWM_TIMER_HALVES];
+
 void PWMWrite(uint8_t pin, uint32_t analog_res, uint32_t duty, unsigned int freq) {
     if (duty == 0) {
     	pinMode(pin, OUTPUT);
@@ -123,15 +138,36 @@ void PWMWrite(uint8_t pin, uint32_t analog_res, uint32_t duty, unsigned int freq
         uint32_t offset = timerToOffset(timer);
         uint32_t timerBase = getTimerBase(offset);
         uint32_t timerAB = TIMER_A << timerToAB(timer);
+        pwmTimerState_t *state = &_pwmTimer[(offset << 1) | (timerToAB(timer) ? 1 : 0)];
+        uint32_t periodPWM, match;
 
         if (port == NOT_A_PORT) return; 	// pin on timer?
 
+        //
+        // Fast path: output still muxed to this timer, timer running with
+        // the same period. Match register updates are deferred to the next
+        // timeout (TnMRSU) so the new duty starts on a period boundary.
+        //
+        if (state->pin == pin && state->freq == freq
+                && (HWREG(portBase + GPIO_O_AFSEL) & bit)
+                && (HWREG(timerBase + TIMER_O_CTL) &
+                    (timerAB == TIMER_A ? TIMER_CTL_TAEN : TIMER_CTL_TBEN))) {
+            periodPWM = state->period;
+            match = (analog_res-duty)*periodPWM/analog_res;
+            if((offset < WTIMER0) && (periodPWM > 0xFFFF)) {
+                HWREG(timerBase + (timerAB == TIMER_A ? TIMER_O_TAPMR : TIMER_O_TBPMR)) =
+                    (match & 0xFFFF0000) >> 16;
+            }
+            HWREG(timerBase + (timerAB == TIMER_A ? TIMER_O_TAMATCHR : TIMER_O_TBMATCHR)) = match;
+            return;
+        }
+
 #ifdef __TM4C1294NCPDT__
-        uint32_t periodPWM = F_CPU/freq;
+        periodPWM = F_CPU/freq;
 #else
-        uint32_t periodPWM = SysCtlClockGet()/freq;
+        periodPWM = SysCtlClockGet()/freq;
 #endif
-
+        match = (analog_res-duty)*periodPWM/analog_res;
 
         enableTimerPeriph(offset);
         ROM_GPIOPinConfigure(timerToPinConfig(timer));
@@ -145,15 +181,14 @@ void PWMWrite(uint8_t pin, uint32_t analog_res, uint32_t duty, unsigned int freq
 
         if(timerAB == TIMER_A) {
         	HWREG(timerBase + TIMER_O_CTL) &= ~TIMER_CTL_TAEN;
-        	HWREG(timerBase + TIMER_O_TAMR) = PWM_MODE;
+        	HWREG(timerBase + TIMER_O_TAMR) = PWM_MODE | TIMER_TAMR_TAMRSU;
         }
         else {
         	HWREG(timerBase + TIMER_O_CTL) &= ~TIMER_CTL_TBEN;
-        	HWREG(timerBase + TIMER_O_TBMR) = PWM_MODE;
+        	HWREG(timerBase + TIMER_O_TBMR) = PWM_MODE | TIMER_TBMR_TBMRSU;
         }
         ROM_TimerLoadSet(timerBase, timerAB, periodPWM);
-        ROM_TimerMatchSet(timerBase, timerAB,
-                (analog_res-duty)*periodPWM/analog_res);
+        ROM_TimerMatchSet(timerBase, timerAB, match);
 
         //
         // If using a 16-bit timer, with a periodPWM > 0xFFFF,
@@ -163,9 +198,13 @@ void PWMWrite(uint8_t pin, uint32_t analog_res, uint32_t duty, unsigned int freq
             ROM_TimerPrescaleSet(timerBase, timerAB,
                 (periodPWM & 0xFFFF0000) >> 16);
             ROM_TimerPrescaleMatchSet(timerBase, timerAB,
-                (((analog_res-duty)*periodPWM/analog_res) & 0xFFFF0000) >> 16);
+                (match & 0xFFFF0000) >> 16);
         }
         ROM_TimerEnable(timerBase, timerAB);
+
+        state->pin = pin;
+        state->freq = freq;
+        state->period = periodPWM;
     }
 }
 void analogWrite(uint8_t pin, int val) {
@@ -176,6 +215,215 @@ void analogWrite(uint8_t pin, int val) {
     PWMWrite(pin, 255, val, 490);
 }
 
+//
+// M0/M1 PWM generator outputs, the GPIO port and pin are taken from the
+// pin configuration value
+//
+typedef struct {
+    uint32_t pinConfig;
+    uint8_t module;
+    uint8_t output;
+} pwmGenOutput_t;
+
+static const pwmGenOutput_t pwm_gen_outputs[] = {
+#ifdef __TM4C1294NCPDT__
+    {0x00050006, 0, 0},     // PF0 M0PWM0
+    {0x00050406, 0, 1},     // PF1 M0PWM1
+    {0x00050806, 0, 2},     // PF2 M0PWM2
+    {0x00050C06, 0, 3},     // PF3 M0PWM3
+    {0x00060006, 0, 4},     // PG0 M0PWM4
+    {0x00060406, 0, 5},     // PG1 M0PWM5
+    {0x00091006, 0, 6},     // PK4 M0PWM6
+    {0x00091406, 0, 7},     // PK5 M0PWM7
+#else
+    {0x00011804, 0, 0},     // PB6 M0PWM0
+    {0x00011C04, 0, 1},     // PB7 M0PWM1
+    {0x00011004, 0, 2},     // PB4 M0PWM2
+    {0x00011404, 0, 3},     // PB5 M0PWM3
+    {0x00041004, 0, 4},     // PE4 M0PWM4
+    {0x00041404, 0, 5},     // PE5 M0PWM5
+    {0x00021004, 0, 6},     // PC4 M0PWM6
+    {0x00021404, 0, 7},     // PC5 M0PWM7
+    {0x00030005, 1, 0},     // PD0 M1PWM0
+    {0x00030405, 1, 1},     // PD1 M1PWM1
+    {0x00001805, 1, 2},     // PA6 M1PWM2
+    {0x00001C05, 1, 3},     // PA7 M1PWM3
+    {0x00050005, 1, 4},     // PF0 M1PWM4
+    {0x00050405, 1, 5},     // PF1 M1PWM5
+    {0x00050805, 1, 6},     // PF2 M1PWM6
+    {0x00050C05, 1, 7},     // PF3 M1PWM7
+#endif
+};
+#define PWM_GEN_OUTPUTS (sizeof(pwm_gen_outputs) / sizeof(pwm_gen_outputs[0]))
+
+static const pwmGenOutput_t *pwmGenOutput(uint8_t port, uint8_t bit) {
+    uint8_t i;
+    for (i = 0; i < PWM_GEN_OUTPUTS; i++) {
+        if (pinConfigToPort(pwm_gen_outputs[i].pinConfig) == port
+                && pinConfigToBitMask(pwm_gen_outputs[i].pinConfig) == bit)
+            return &pwm_gen_outputs[i];
+    }
+    return 0;
+}
+
+static const pwmGenOutput_t *pwmGenPartner(const pwmGenOutput_t *out) {
+    uint8_t i;
+    for (i = 0; i < PWM_GEN_OUTPUTS; i++) {
+        if (pwm_gen_outputs[i].module == out->module
+                && pwm_gen_outputs[i].output == (out->output ^ 1))
+            return &pwm_gen_outputs[i];
+    }
+    return 0;
+}
+
+static void pwmGenPinConfigure(const pwmGenOutput_t *out) {
+    uint8_t port = pinConfigToPort(out->pinConfig);
+    uint8_t bit = pinConfigToBitMask(out->pinConfig);
+
+    //
+    // PF0 on TM4C123 is locked as NMI, its function can only be changed
+    // with the commit bit set
+    //
+    *portLOCKRegister(port) = GPIO_LOCK_KEY;
+    *portCRRegister(port) |= bit;
+    *portLOCKRegister(port) = 0;
+
+    ROM_GPIOPinConfigure(out->pinConfig);
+    ROM_GPIOPinTypePWM((uint32_t) portBASERegister(port), bit);
+}
+
+#define PWM_GEN_BASE(out)   ((out)->module ? PWM1_BASE : PWM0_BASE)
+#define PWM_GEN_OFFSET(out) (PWM_GEN_0 + ((out)->output >> 1) * (PWM_GEN_1 - PWM_GEN_0))
+#define PWM_GEN_OUT(out)    (PWM_GEN_OFFSET(out) + (out)->output)
+
+//
+// Sets the pulse width in PWM clocks of a period of period clocks. At 0%
+// and 100% the compare events would coincide with the load or zero events
+// and glitch, so the output is held low or high by the generator actions
+// instead.
+//
+static void pwmGenDuty(uint32_t base, const pwmGenOutput_t *out, uint32_t width, uint32_t period) {
+    uint32_t gen = base + PWM_GEN_OFFSET(out);
+    uint8_t odd = out->output & 1;
+    uint32_t actions;
+
+    if (width == 0) {
+        actions = odd ? PWM_X_GENB_ACTLOAD_ZERO : PWM_X_GENA_ACTLOAD_ZERO;
+    }
+    else if (width >= period) {
+        actions = odd ? PWM_X_GENB_ACTLOAD_ONE : PWM_X_GENA_ACTLOAD_ONE;
+    }
+    else {
+        ROM_PWMPulseWidthSet(base, PWM_GEN_OUT(out), width);
+        if (HWREG(gen + PWM_O_X_CTL) & PWM_X_CTL_MODE)
+            actions = odd ? (PWM_X_GENB_ACTCMPBU_ONE | PWM_X_GENB_ACTCMPBD_ZERO)
+                          : (PWM_X_GENA_ACTCMPAU_ONE | PWM_X_GENA_ACTCMPAD_ZERO);
+        else
+            actions = odd ? (PWM_X_GENB_ACTLOAD_ONE | PWM_X_GENB_ACTCMPBD_ZERO)
+                          : (PWM_X_GENA_ACTLOAD_ONE | PWM_X_GENA_ACTCMPAD_ZERO);
+    }
+    HWREG(gen + (odd ? PWM_O_X_GENB : PWM_O_X_GENA)) = actions;
+}
+
+//
+// Route pin to its M0/M1 PWM generator. mode is PWM_EDGE_ALIGNED or
+// PWM_CENTER_ALIGNED. A non zero deadBand (ns) drives the generator's
+// second output with the complement of pin, both edges delayed by
+// deadBand; pin must then be the first (even) output of the generator.
+// The PWM clock divider is shared by all generators.
+//
+uint8_t PWMGenBegin(uint8_t pin, uint32_t freq, uint8_t mode, uint32_t deadBand) {
+    const pwmGenOutput_t *out = pwmGenOutput(digitalPinToPort(pin), digitalPinToBitMask(pin));
+    const pwmGenOutput_t *partner = 0;
+    uint32_t base, gen, clock, period, div = 0;
+
+    if (out == 0 || freq == 0) return 0;
+
+    if (deadBand) {
+        partner = pwmGenPartner(out);
+        if ((out->output & 1) || partner == 0) return 0;
+    }
+
+    if (!ROM_SysCtlPeripheralPresent(out->module ? SYSCTL_PERIPH_PWM1 : SYSCTL_PERIPH_PWM0))
+        return 0;
+
+    base = PWM_GEN_BASE(out);
+    gen = PWM_GEN_OFFSET(out);
+
+#ifdef __TM4C1294NCPDT__
+    clock = F_CPU;
+#else
+    clock = SysCtlClockGet();
+#endif
+    //
+    // Up/down counting covers the period twice
+    //
+    period = clock / freq;
+    if (mode == PWM_CENTER_ALIGNED) period >>= 1;
+    while (period > 0xFFFF && div < 6) {
+        period >>= 1;
+        div++;
+    }
+    if (period > 0xFFFF || period < 2) return 0;
+    clock >>= div;
+
+    ROM_SysCtlPeripheralEnable(out->module ? SYSCTL_PERIPH_PWM1 : SYSCTL_PERIPH_PWM0);
+#ifdef __TM4C1294NCPDT__
+    ROM_PWMClockSet(base, div ? (PWM_SYSCLK_DIV_2 + div - 1) : PWM_SYSCLK_DIV_1);
+#else
+    ROM_SysCtlPWMClockSet(div ? (SYSCTL_PWMDIV_2 + ((div - 1) << 17)) : SYSCTL_PWMDIV_1);
+#endif
+
+    pwmGenPinConfigure(out);
+    if (partner) pwmGenPinConfigure(partner);
+
+    //
+    // Load, compare, generator action and dead band updates are locally
+    // synchronized to counter zero so duty changes never cut a period
+    // short. PWM_GEN_MODE_SYNC would hold them until PWMSyncUpdate().
+    //
+    ROM_PWMGenDisable(base, gen);
+    ROM_PWMGenConfigure(base, gen,
+            (mode == PWM_CENTER_ALIGNED ? PWM_GEN_MODE_UP_DOWN : PWM_GEN_MODE_DOWN) |
+            PWM_GEN_MODE_NO_SYNC | PWM_GEN_MODE_GEN_SYNC_LOCAL |
+            PWM_GEN_MODE_DB_SYNC_LOCAL);
+    ROM_PWMGenPeriodSet(base, gen, mode == PWM_CENTER_ALIGNED ? period << 1 : period);
+    pwmGenDuty(base, out, 0, ROM_PWMGenPeriodGet(base, gen));
+
+    if (partner) {
+        deadBand = (clock / 1000000) * deadBand / 1000;
+        if (deadBand > 0xFFF) deadBand = 0xFFF;
+        ROM_PWMDeadBandEnable(base, gen, deadBand, deadBand);
+        ROM_PWMOutputState(base, (1 << out->output) | (1 << partner->output), true);
+    }
+    else {
+        ROM_PWMDeadBandDisable(base, gen);
+        ROM_PWMOutputState(base, 1 << out->output, true);
+    }
+    ROM_PWMGenEnable(base, gen);
+
+    return 1;
+}
+
+//
+// Duty only update of a pin set up with PWMGenBegin(): a compare register
+// write that takes effect at the next counter zero. duty of analog_res or
+// more is 100%.
+//
+void PWMGenWrite(uint8_t pin, uint32_t analog_res, uint32_t duty) {
+    const pwmGenOutput_t *out = pwmGenOutput(digitalPinToPort(pin), digitalPinToBitMask(pin));
+    uint32_t base, period;
+
+    if (out == 0 || analog_res == 0) return;
+
+    base = PWM_GEN_BASE(out);
+    period = ROM_PWMGenPeriodGet(base, PWM_GEN_OFFSET(out));
+    if (duty >= analog_res)
+        pwmGenDuty(base, out, period, period);
+    else
+        pwmGenDuty(base, out, (uint64_t) duty * period / analog_res, period);
+}
+
 void analogReadResolution(int res) {
     _readResolution = res;
 }
@@ -212,3 +460,82 @@ uint16_t analogRead(uint8_t pin) {
 
     return mapResolution(value[0], 12, _readResolution);
 }
+
+//
+// Sequencer steps currently programmed for each scan group so that
+// repeated analogScanRead() calls on the same group only trigger.
+//
+static analogScan_t *_scanLoaded[2];
+
+uint8_t analogScanBegin(analogScan_t *scan, const uint8_t pins[], uint8_t count) {
+    uint8_t i;
+    uint32_t channel;
+
+    if (count == 0 || count > ANALOG_SCAN_MAX) return 0;
+
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
+    for (i = 0; i < count; i++) {
+        channel = digitalPinToADCIn(pins[i]);
+        if (channel == NOT_ON_ADC) { //invalid ADC pin
+            return 0;
+        }
+        if(channel != ADC_CTL_TS)
+            ROM_GPIOPinTypeADC((uint32_t) portBASERegister(digitalPinToPort(pins[i])),
+                    digitalPinToBitMask(pins[i]));
+        scan->steps[i] = channel;
+    }
+    //
+    // Only the last step raises the completion interrupt
+    //
+    scan->steps[count - 1] |= ADC_CTL_IE | ADC_CTL_END;
+    scan->count = count;
+
+    //
+    // Sequencer 0 has an 8 deep FIFO, sequencer 1 a 4 deep one
+    //
+    scan->sequencer = (count > 4) ? 0 : 1;
+    if (_scanLoaded[scan->sequencer] == scan)
+        _scanLoaded[scan->sequencer] = 0;
+
+    return count;
+}
+
+void analogScanRead(analogScan_t *scan, uint16_t values[]) {
+    uint32_t seq = scan->sequencer;
+    uint32_t data[ANALOG_SCAN_MAX];
+    uint8_t i;
+
+    if (_scanLoaded[seq] != scan) {
+        ROM_ADCSequenceDisable(ADC0_BASE, seq);
+        ROM_ADCSequenceConfigure(ADC0_BASE, seq, ADC_TRIGGER_PROCESSOR, 0);
+        for (i = 0; i < scan->count; i++) {
+            ROM_ADCSequenceStepConfigure(ADC0_BASE, seq, i, scan->steps[i]);
+        }
+        ROM_ADCSequenceEnable(ADC0_BASE, seq);
+        _scanLoaded[seq] = scan;
+    }
+
+    ROM_ADCIntClear(ADC0_BASE, seq);
+    ROM_ADCProcessorTrigger(ADC0_BASE, seq);
+    while(!ROM_ADCIntStatus(ADC0_BASE, seq, false)) {
+    }
+    ROM_ADCIntClear(ADC0_BASE, seq);
+    ROM_ADCSequenceDataGet(ADC0_BASE, seq, data);
+
+    for (i = 0; i < scan->count; i++) {
+        values[i] = mapResolution(data[i], 12, _readResolution);
+    }
+}
+
+uint8_t analogReadMulti(const uint8_t pins[], uint8_t count, uint16_t values[]) {
+    analogScan_t scan;
+
+    if (!analogScanBegin(&scan, pins, count)) return 0;
+    analogScanRead(&scan, values);
+
+    //
+    // scan lives on the stack, do not let a later group match its address
+    //
+    _scanLoaded[scan.sequencer] = 0;
+    return count;
+}
@@ -43,11 +43,20 @@ extern "C"{
 void PWMWrite(uint8_t pin, uint32_t analog_res, uint32_t duty, unsigned int freq);
 uint8_t getTimerInterrupt(uint8_t timer);
 uint32_t getTimerBase(uint32_t offset);
+void enableTimerPeriph(uint32_t offset);
 void ToneIntHandler(void);
 void GPIOIntHandler(void);
+void PulseCaptureIntHandler(void);
 
 typedef void (*voidFuncPtr)(void);
 
+//
+// GPIOPinConfigure() values encode the GPIO port index in bits 16-23 and
+// the pin number * 4 in bits 8-15
+//
+#define pinConfigToPort(c)      ((((c) >> 16) & 0xFF) + PA)
+#define pinConfigToBitMask(c)   (1 << (((c) >> 10) & 0x07))
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
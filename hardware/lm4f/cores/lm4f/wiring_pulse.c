@@ -31,14 +31,372 @@
 
 #include "wiring_private.h"
 #include "pins_energia.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_nvic.h"
+#include "inc/hw_timer.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+//
+// Hardware pulse capture on the GPTM CCP pins. The timer half runs in
+// edge-time mode on both edges, counting down from its full range, and
+// the capture interrupt timestamps every edge. The time-out interrupt
+// counts the wraps of the counter, so pulses longer than its span are
+// timed too. Pulse widths therefore do not depend on interrupt latency as
+// long as the handler runs before the next edge.
+//
+typedef struct {
+    uint8_t pin;                // 0 when the slot is free
+    uint8_t state;              // level of the pulse timed by pulseInStart()
+    uint8_t continuous;
+    uint8_t bit;
+    uint8_t started;
+    uint8_t fell;
+    uint8_t interrupt;
+    volatile uint8_t ready;
+    uint32_t portBase;
+    uint32_t timerBase;
+    uint32_t event;             // capture event interrupt
+    uint32_t wrap;              // time-out interrupt
+    uint32_t valueReg;
+    uint32_t mask;
+    uint32_t wraps;
+    uint64_t lead;              // leading edge timestamp
+    uint64_t fall;              // trailing edge timestamp of a measured period
+    volatile uint32_t width;    // in microseconds
+    volatile uint32_t period;   // in microseconds
+    void (*vector)(void);       // handler of the timer half before capture
+    void (*callback)(uint8_t pin, unsigned long high, unsigned long period);
+} pulseCapture_t;
+
+static pulseCapture_t _capture[PULSE_CAPTURE_MAX];
+static uint32_t _ticksPerMicrosecond;
+
+extern void (* const g_pfnVectors[])(void);
+
+//
+// Ticks since the capture started of the count now
+//
+static uint64_t captureStamp(pulseCapture_t *c, uint32_t now)
+{
+    return (uint64_t) c->wraps * ((uint64_t) c->mask + 1) + (c->mask - now);
+}
+
+void PulseCaptureIntHandler(void)
+{
+    uint8_t i;
+    pulseCapture_t *c;
+    uint32_t status, now;
+    uint64_t stamp;
+    uint8_t level;
+
+    for (i = 0; i < PULSE_CAPTURE_MAX; i++) {
+        c = &_capture[i];
+        if (c->pin == 0)
+            continue;
+        status = HWREG(c->timerBase + TIMER_O_MIS) & (c->event | c->wrap);
+        if (status == 0)
+            continue;
+
+        HWREG(c->timerBase + TIMER_O_ICR) = status;
+        now = HWREG(c->timerBase + c->valueReg) & c->mask;
+
+        //
+        // The counter reloads at the top of its range, so with both pending
+        // an edge captured in the upper half came after the wrap
+        //
+        if ((status & c->wrap) && (!(status & c->event) || now > (c->mask >> 1))) {
+            c->wraps++;
+            status &= ~c->wrap;
+        }
+        if (!(status & c->event)) {
+            continue;
+        }
+
+        stamp = captureStamp(c, now);
+        level = HWREG(c->portBase + (GPIO_O_DATA + (c->bit << 2))) ? HIGH : LOW;
+
+        if (c->continuous) {
+            if (level == HIGH) {
+                if (c->started && c->fell) {
+                    c->period = (stamp - c->lead) / _ticksPerMicrosecond;
+                    c->width = (c->fall - c->lead) / _ticksPerMicrosecond;
+                    c->ready = 1;
+                    if (c->callback)
+                        c->callback(c->pin, c->width, c->period);
+                }
+                c->lead = stamp;
+                c->started = 1;
+                c->fell = 0;
+            }
+            else if (c->started) {
+                c->fall = stamp;
+                c->fell = 1;
+            }
+        }
+        else if (level == c->state) {
+            c->lead = stamp;
+            c->started = 1;
+        }
+        else if (c->started) {
+            c->width = (stamp - c->lead) / _ticksPerMicrosecond;
+            c->ready = 1;
+            HWREG(c->timerBase + TIMER_O_IMR) &= ~(c->event | c->wrap);
+        }
+
+        if (status & c->wrap) {
+            c->wraps++;
+        }
+    }
+}
+
+static pulseCapture_t *captureFind(uint8_t pin)
+{
+    uint8_t i;
+
+    for (i = 0; i < PULSE_CAPTURE_MAX; i++) {
+        if (_capture[i].pin == pin)
+            return &_capture[i];
+    }
+    return 0;
+}
+
+//
+// Timer half A interrupt of each capture timer, half B is the next one
+//
+static const uint32_t _captureInterrupt[][2] = {
+    { TIMER0_BASE, INT_TIMER0A },
+    { TIMER1_BASE, INT_TIMER1A },
+    { TIMER2_BASE, INT_TIMER2A },
+    { TIMER3_BASE, INT_TIMER3A },
+#ifdef __TM4C1294NCPDT__
+    { TIMER4_BASE, INT_TIMER4A },
+    { TIMER5_BASE, INT_TIMER5A },
+#else
+    { WTIMER0_BASE, INT_WTIMER0A },
+    { WTIMER1_BASE, INT_WTIMER1A },
+    { WTIMER2_BASE, INT_WTIMER2A },
+    { WTIMER3_BASE, INT_WTIMER3A },
+    { WTIMER5_BASE, INT_WTIMER5A },
+#endif
+};
+
+static uint8_t captureInterrupt(uint32_t timerBase, uint32_t timerAB)
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(_captureInterrupt) / sizeof(_captureInterrupt[0]); i++) {
+        if (_captureInterrupt[i][0] == timerBase)
+            return _captureInterrupt[i][1] + (timerAB == TIMER_B);
+    }
+    return 0;
+}
+
+//
+// Returns the handler the timer half's vector points at. Capture takes the
+// vector over with TimerIntRegister(), which moves the vector table to RAM.
+//
+static void (*captureVector(uint8_t interrupt))(void)
+{
+    return ((void (**)(void)) HWREG(NVIC_VTABLE))[interrupt];
+}
+
+//
+// A timer half is free for capture when its vector is still the one of the
+// startup table and it does not run with interrupts of its own, which rules
+// out Servo's registered handler and a playing Tone. A half concatenated
+// into a running 32 bit timer is never free.
+//
+static uint8_t captureTimerFree(uint32_t timerBase, uint32_t timerAB, uint8_t interrupt)
+{
+    uint32_t enable = (timerAB == TIMER_A) ? TIMER_CTL_TAEN : TIMER_CTL_TBEN;
+    uint32_t ints = (timerAB == TIMER_A)
+            ? (TIMER_IMR_TATOIM | TIMER_IMR_CAMIM | TIMER_IMR_CAEIM | TIMER_IMR_TAMIM)
+            : (TIMER_IMR_TBTOIM | TIMER_IMR_CBMIM | TIMER_IMR_CBEIM | TIMER_IMR_TBMIM);
+    void (*vector)(void) = captureVector(interrupt);
+
+    if (interrupt == 0 || vector != g_pfnVectors[interrupt])
+        return 0;
+    if (HWREG(timerBase + TIMER_O_CTL) & TIMER_CTL_TAEN
+            && HWREG(timerBase + TIMER_O_CFG) != 0x04)
+        return 0;
+    return !((HWREG(timerBase + TIMER_O_CTL) & enable)
+            && (HWREG(timerBase + TIMER_O_IMR) & ints));
+}
+
+static pulseCapture_t *captureStart(uint8_t pin, uint8_t continuous, uint8_t state)
+{
+    uint8_t bit = digitalPinToBitMask(pin);
+    uint8_t port = digitalPinToPort(pin);
+    uint8_t timer = digitalPinToTimer(pin);
+    uint32_t offset, timerAB, timerBase;
+    uint8_t interrupt;
+    pulseCapture_t *c;
+
+    //
+    // Only pins whose CCP mux actually lands on this pin can capture
+    //
+    if (pin == 0 || port == NOT_A_PORT
+            || pinConfigToPort(timerToPinConfig(timer)) != port
+            || pinConfigToBitMask(timerToPinConfig(timer)) != bit)
+        return 0;
+
+    offset = timerToOffset(timer);
+    timerAB = TIMER_A << timerToAB(timer);
+    timerBase = getTimerBase(offset);
+    interrupt = captureInterrupt(timerBase, timerAB);
+
+    c = captureFind(pin);
+    if (c == 0) {
+        c = captureFind(0);
+        if (c == 0) return 0;
+        enableTimerPeriph(offset);
+        if (!captureTimerFree(timerBase, timerAB, interrupt)) return 0;
+        c->vector = captureVector(interrupt);
+    }
+
+    c->pin = 0;
+    c->continuous = continuous;
+    c->state = state;
+    c->bit = bit;
+    c->started = 0;
+    c->fell = 0;
+    c->ready = 0;
+    c->callback = 0;
+    c->portBase = (uint32_t) portBASERegister(port);
+    c->timerBase = timerBase;
+    c->interrupt = interrupt;
+    c->wraps = 0;
+    c->event = (timerAB == TIMER_A) ? TIMER_CAPA_EVENT : TIMER_CAPB_EVENT;
+    c->wrap = (timerAB == TIMER_A) ? TIMER_TIMA_TIMEOUT : TIMER_TIMB_TIMEOUT;
+    c->valueReg = (timerAB == TIMER_A) ? TIMER_O_TAR : TIMER_O_TBR;
+
+#ifdef __TM4C1294NCPDT__
+    _ticksPerMicrosecond = F_CPU / 1000000;
+#else
+    _ticksPerMicrosecond = SysCtlClockGet() / 1000000;
+#endif
+
+    ROM_GPIOPinConfigure(timerToPinConfig(timer));
+    ROM_GPIOPinTypeTimer(c->portBase, bit);
+
+    //
+    // Split timer, this half in down counting edge-time mode
+    //
+    ROM_TimerDisable(c->timerBase, timerAB);
+    HWREG(c->timerBase + TIMER_O_CFG) = 0x04;
+    HWREG(c->timerBase + (timerAB == TIMER_A ? TIMER_O_TAMR : TIMER_O_TBMR)) =
+        TIMER_TAMR_TAMR_CAP | TIMER_TAMR_TACMR;
+    ROM_TimerControlEvent(c->timerBase, timerAB, TIMER_EVENT_BOTH_EDGES);
+
+    //
+    // 16 bit halves use the prescaler as an 8 bit extension (24 bits),
+    // wide timer halves count the full 32 bits
+    //
+#ifdef __TM4C1294NCPDT__
+    {
+#else
+    if (offset < WTIMER0) {
+#endif
+        ROM_TimerLoadSet(c->timerBase, timerAB, 0xFFFF);
+        ROM_TimerPrescaleSet(c->timerBase, timerAB, 0xFF);
+        c->mask = 0xFFFFFF;
+    }
+#ifndef __TM4C1294NCPDT__
+    else {
+        ROM_TimerLoadSet(c->timerBase, timerAB, 0xFFFFFFFF);
+        c->mask = 0xFFFFFFFF;
+    }
+#endif
+
+    c->pin = pin;
+    TimerIntRegister(c->timerBase, timerAB, PulseCaptureIntHandler);
+    ROM_TimerIntClear(c->timerBase, c->event | c->wrap);
+    ROM_TimerIntEnable(c->timerBase, c->event | c->wrap);
+    ROM_TimerEnable(c->timerBase, timerAB);
+
+    return c;
+}
+
+uint8_t pulseInStart(uint8_t pin, uint8_t state)
+{
+    return captureStart(pin, 0, state) != 0;
+}
+
+uint8_t pulseInAvailable(uint8_t pin)
+{
+    pulseCapture_t *c = captureFind(pin);
+    return c ? c->ready : 0;
+}
+
+unsigned long pulseInResult(uint8_t pin)
+{
+    pulseCapture_t *c = captureFind(pin);
+    if (c == 0 || !c->ready) return 0;
+    return c->width;
+}
+
+uint8_t pulseMeasureBegin(uint8_t pin,
+        void (*callback)(uint8_t pin, unsigned long high, unsigned long period))
+{
+    pulseCapture_t *c = captureStart(pin, 1, HIGH);
+    if (c == 0) return 0;
+    c->callback = callback;
+    return 1;
+}
+
+unsigned long pulseMeasureHigh(uint8_t pin)
+{
+    pulseCapture_t *c = captureFind(pin);
+    if (c == 0 || !c->ready) return 0;
+    return c->width;
+}
+
+unsigned long pulseMeasurePeriod(uint8_t pin)
+{
+    pulseCapture_t *c = captureFind(pin);
+    if (c == 0 || !c->ready) return 0;
+    return c->period;
+}
+
+void pulseCaptureEnd(uint8_t pin)
+{
+    pulseCapture_t *c = captureFind(pin);
+    if (c == 0) return;
+
+    ROM_TimerIntDisable(c->timerBase, c->event | c->wrap);
+    ROM_TimerDisable(c->timerBase, c->event == TIMER_CAPA_EVENT ? TIMER_A : TIMER_B);
+    IntRegister(c->interrupt, c->vector);
+    ROM_GPIOPinTypeGPIOInput(c->portBase, c->bit);
+    c->pin = 0;
+}
 
 /* Measures the length (in microseconds) of a pulse on the pin; state is HIGH
  * or LOW, the type of pulse to measure.  Works on pulses from 2-3 microseconds
  * to 3 minutes in length, but must be called at least a few dozen microseconds
- * before the start of the pulse. */
+ * before the start of the pulse. Pins with a free timer capture input are
+ * timed in hardware, see pulseInStart(); other pins use the polling loop. */
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
 {
+    if (pulseInStart(pin, state)) {
+        unsigned long start = micros();
+        unsigned long result;
+
+        while (!pulseInAvailable(pin)) {
+            if (micros() - start >= timeout) {
+                pulseCaptureEnd(pin);
+                return 0;
+            }
+        }
+        result = pulseInResult(pin);
+        pulseCaptureEnd(pin);
+        return result;
+    }
+
     // cache the port and bit of the pin in order to speed up the
     // pulse width measuring loop and achieve finer resolution.  calling
     // digitalRead() instead yields much coarser resolution.
@@ -31,33 +31,273 @@
  */
 
 #include "wiring_private.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/rom.h"
+#include "driverlib/ssi.h"
+#include "driverlib/sysctl.h"
 
-uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+//
+// Bit rate used when a shiftOutBuffer()/shiftInBuffer() pin pair lands on
+// an SSI module. 74HC595/74HC165 parts are good for well above this at 3.3V.
+//
+#define SHIFT_SSI_CLOCK 4000000
+
+typedef struct {
+    uint32_t periph;
+    uint32_t base;
+    uint32_t clk;
+    uint32_t tx;
+    uint32_t rx;
+} shiftSSI_t;
+
+//
+// AFSEL bit and PCTL field of a pin, saved while the SSI borrows it
+//
+typedef struct {
+    uint32_t afsel;
+    uint32_t pctl;
+} shiftPinState_t;
+
+static const shiftSSI_t shift_ssi[] = {
+#ifdef __TM4C1294NCPDT__
+    {SYSCTL_PERIPH_SSI0, SSI0_BASE, GPIO_PA2_SSI0CLK, GPIO_PA4_SSI0XDAT0, GPIO_PA5_SSI0XDAT1},
+    {SYSCTL_PERIPH_SSI1, SSI1_BASE, GPIO_PB5_SSI1CLK, GPIO_PE4_SSI1XDAT0, GPIO_PE5_SSI1XDAT1},
+    {SYSCTL_PERIPH_SSI2, SSI2_BASE, GPIO_PD3_SSI2CLK, GPIO_PD1_SSI2XDAT0, GPIO_PD0_SSI2XDAT1},
+    {SYSCTL_PERIPH_SSI3, SSI3_BASE, GPIO_PF3_SSI3CLK, GPIO_PF1_SSI3XDAT0, GPIO_PF0_SSI3XDAT1},
+    {SYSCTL_PERIPH_SSI3, SSI3_BASE, GPIO_PQ0_SSI3CLK, GPIO_PQ2_SSI3XDAT0, GPIO_PQ3_SSI3XDAT1},
+#else
+    {SYSCTL_PERIPH_SSI0, SSI0_BASE, GPIO_PA2_SSI0CLK, GPIO_PA5_SSI0TX, GPIO_PA4_SSI0RX},
+    {SYSCTL_PERIPH_SSI1, SSI1_BASE, GPIO_PF2_SSI1CLK, GPIO_PF1_SSI1TX, GPIO_PF0_SSI1RX},
+    {SYSCTL_PERIPH_SSI2, SSI2_BASE, GPIO_PB4_SSI2CLK, GPIO_PB7_SSI2TX, GPIO_PB6_SSI2RX},
+    {SYSCTL_PERIPH_SSI3, SSI3_BASE, GPIO_PD0_SSI3CLK, GPIO_PD3_SSI3TX, GPIO_PD2_SSI3RX},
+#endif
+};
+
+static uint8_t pinIsConfig(uint8_t pin, uint32_t config)
+{
+    return digitalPinToPort(pin) == pinConfigToPort(config)
+        && digitalPinToBitMask(pin) == pinConfigToBitMask(config);
+}
+
+//
+// An SSI that is already enabled belongs to someone else, e.g. the SPI
+// library on the same pins, and is left alone
+//
+static const shiftSSI_t *shiftFindSSI(uint8_t dataPin, uint8_t clockPin, uint8_t input)
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(shift_ssi) / sizeof(shift_ssi[0]); i++) {
+        if (pinIsConfig(clockPin, shift_ssi[i].clk)
+                && pinIsConfig(dataPin, input ? shift_ssi[i].rx : shift_ssi[i].tx)) {
+            if (ROM_SysCtlPeripheralReady(shift_ssi[i].periph)
+                    && (HWREG(shift_ssi[i].base + SSI_O_CR1) & SSI_CR1_SSE))
+                return 0;
+            return &shift_ssi[i];
+        }
+    }
+    return 0;
+}
+
+//
+// Hand the pin to the peripheral through AFSEL only, so that direction and
+// pad settings made by pinMode() are back in effect once it is released.
+// The pin's previous AFSEL and PCTL settings are saved in state.
+//
+static void pinToPeripheral(uint32_t config, shiftPinState_t *state)
+{
+    uint32_t base = (uint32_t) portBASERegister(pinConfigToPort(config));
+    uint8_t bit = pinConfigToBitMask(config);
+
+    state->afsel = HWREG(base + GPIO_O_AFSEL) & bit;
+    state->pctl = HWREG(base + GPIO_O_PCTL);
+    ROM_GPIOPinConfigure(config);
+    HWREG(base + GPIO_O_AFSEL) |= bit;
+}
+
+static void pinToGPIO(uint32_t config, const shiftPinState_t *state)
+{
+    uint32_t base = (uint32_t) portBASERegister(pinConfigToPort(config));
+    uint8_t bit = pinConfigToBitMask(config);
+    uint32_t field = 0xF << ((config >> 8) & 0xFF);
+
+    HWREG(base + GPIO_O_PCTL) = (HWREG(base + GPIO_O_PCTL) & ~field) | (state->pctl & field);
+    HWREG(base + GPIO_O_AFSEL) = (HWREG(base + GPIO_O_AFSEL) & ~bit) | state->afsel;
+}
+
+//
+// Both modes idle the clock low. shiftOut() sets the data bit before the
+// rising edge, as mode 0 does. shiftIn() reads the data bit while the clock
+// is high, after the rising edge has shifted it out, so reads use mode 1,
+// which samples on the falling edge.
+//
+static void shiftSSIBegin(const shiftSSI_t *ssi, uint32_t dataConfig, uint32_t mode,
+        shiftPinState_t *pins)
+{
+    uint32_t dummy;
+
+    ROM_SysCtlPeripheralEnable(ssi->periph);
+    ROM_SSIDisable(ssi->base);
+    ROM_SSIClockSourceSet(ssi->base, SSI_CLOCK_SYSTEM);
+#ifdef __TM4C1294NCPDT__
+    ROM_SSIConfigSetExpClk(ssi->base, F_CPU, mode, SSI_MODE_MASTER, SHIFT_SSI_CLOCK, 8);
+#else
+    ROM_SSIConfigSetExpClk(ssi->base, SysCtlClockGet(), mode, SSI_MODE_MASTER, SHIFT_SSI_CLOCK, 8);
+#endif
+    ROM_SSIEnable(ssi->base);
+    while (ROM_SSIDataGetNonBlocking(ssi->base, &dummy));
+
+    pinToPeripheral(ssi->clk, &pins[0]);
+    pinToPeripheral(dataConfig, &pins[1]);
+}
+
+static void shiftSSIEnd(const shiftSSI_t *ssi, uint32_t dataConfig,
+        const shiftPinState_t *pins)
+{
+    while (HWREG(ssi->base + SSI_O_SR) & SSI_SR_BSY);
+
+    //
+    // Clock idles low in mode 0 and 1, make the GPIO agree before switching back
+    //
+    HWREG((uint32_t) portBASERegister(pinConfigToPort(ssi->clk))
+            + (GPIO_O_DATA + (pinConfigToBitMask(ssi->clk) << 2))) = 0;
+    pinToGPIO(dataConfig, &pins[1]);
+    pinToGPIO(ssi->clk, &pins[0]);
+    ROM_SSIDisable(ssi->base);
+}
+
+static inline uint32_t reverseBits(uint32_t v)
+{
+    asm("rbit %0, %1" : "=r" (v) : "r" (v));	// reverse order of 32 bits
+    asm("rev %0, %1" : "=r" (v) : "r" (v));	// reverse order of bytes to get original bits into lowest byte
+    return v;
+}
+
+//
+// The masked GPIODATA alias for a single pin: writing any non zero value
+// sets the pin, reading returns non zero when it is high
+//
+static volatile uint32_t *pinDataRegister(uint8_t pin)
+{
+    uint8_t port = digitalPinToPort(pin);
+
+    if (port == NOT_A_PORT) return 0;
+    return (volatile uint32_t *) ((uint32_t) portBASERegister(port)
+            + (GPIO_O_DATA + (digitalPinToBitMask(pin) << 2)));
+}
+
+static uint8_t shiftInBits(volatile uint32_t *data, volatile uint32_t *clock, uint8_t bitOrder)
+{
     uint8_t value = 0;
     uint8_t i;
 
     for (i = 0; i < 8; ++i) {
-        digitalWrite(clockPin, HIGH);
+        *clock = 0xFF;
         if (bitOrder == LSBFIRST)
-            value |= digitalRead(dataPin) << i;
+            value |= (*data ? 1 : 0) << i;
         else
-            value |= digitalRead(dataPin) << (7 - i);
-        digitalWrite(clockPin, LOW);
+            value |= (*data ? 1 : 0) << (7 - i);
+        *clock = 0;
     }
     return value;
 }
 
-void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+static void shiftOutBits(volatile uint32_t *data, volatile uint32_t *clock, uint8_t bitOrder, uint8_t val)
 {
     uint8_t i;
 
     for (i = 0; i < 8; i++)  {
         if (bitOrder == LSBFIRST)
-            digitalWrite(dataPin, !!(val & (1 << i)));
+            *data = (val & (1 << i)) ? 0xFF : 0;
         else
-            digitalWrite(dataPin, !!(val & (1 << (7 - i))));
+            *data = (val & (1 << (7 - i))) ? 0xFF : 0;
 
-        digitalWrite(clockPin, HIGH);
-        digitalWrite(clockPin, LOW);
+        *clock = 0xFF;
+        *clock = 0;
     }
 }
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+    volatile uint32_t *data = pinDataRegister(dataPin);
+    volatile uint32_t *clock = pinDataRegister(clockPin);
+
+    if (data == 0 || clock == 0) return 0;
+    return shiftInBits(data, clock, bitOrder);
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+    volatile uint32_t *data = pinDataRegister(dataPin);
+    volatile uint32_t *clock = pinDataRegister(clockPin);
+
+    if (data == 0 || clock == 0) return;
+    shiftOutBits(data, clock, bitOrder, val);
+}
+
+void shiftInBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, uint32_t len)
+{
+    const shiftSSI_t *ssi = shiftFindSSI(dataPin, clockPin, 1);
+    shiftPinState_t pins[2];
+    volatile uint32_t *data, *clock;
+    uint32_t tx = 0, rx = 0, v;
+
+    if (ssi) {
+        shiftSSIBegin(ssi, ssi->rx, SSI_FRF_MOTO_MODE_1, pins);
+        //
+        // Keep the transmit side at most one FIFO ahead so nothing is lost
+        //
+        while (rx < len) {
+            if (tx < len && tx - rx < 8 && (HWREG(ssi->base + SSI_O_SR) & SSI_SR_TNF)) {
+                HWREG(ssi->base + SSI_O_DR) = 0xFF;
+                tx++;
+            }
+            if (HWREG(ssi->base + SSI_O_SR) & SSI_SR_RNE) {
+                v = HWREG(ssi->base + SSI_O_DR);
+                buf[rx++] = (bitOrder == LSBFIRST) ? reverseBits(v) : v;
+            }
+        }
+        shiftSSIEnd(ssi, ssi->rx, pins);
+        return;
+    }
+
+    data = pinDataRegister(dataPin);
+    clock = pinDataRegister(clockPin);
+    if (data == 0 || clock == 0) return;
+
+    while (len--)
+        *buf++ = shiftInBits(data, clock, bitOrder);
+}
+
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, uint32_t len)
+{
+    const shiftSSI_t *ssi = shiftFindSSI(dataPin, clockPin, 0);
+    shiftPinState_t pins[2];
+    volatile uint32_t *data, *clock;
+    uint32_t v, dummy;
+
+    if (ssi) {
+        shiftSSIBegin(ssi, ssi->tx, SSI_FRF_MOTO_MODE_0, pins);
+        while (len--) {
+            v = *buf++;
+            if (bitOrder == LSBFIRST)
+                v = reverseBits(v);
+            while (!(HWREG(ssi->base + SSI_O_SR) & SSI_SR_TNF));
+            HWREG(ssi->base + SSI_O_DR) = v;
+        }
+        shiftSSIEnd(ssi, ssi->tx, pins);
+        while (ROM_SSIDataGetNonBlocking(ssi->base, &dummy));
+        return;
+    }
+
+    data = pinDataRegister(dataPin);
+    clock = pinDataRegister(clockPin);
+    if (data == 0 || clock == 0) return;
+
+    while (len--)
+        shiftOutBits(data, clock, bitOrder, *buf++);
+}
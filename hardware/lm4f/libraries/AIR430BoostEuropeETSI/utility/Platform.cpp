@@ -73,10 +73,8 @@ void A110x2500SpiRead(unsigned char address,
   SPI.transfer(address);
   
   // Write dummy byte(s) and read response(s).
-  for (unsigned char i = 0; i < count; i++)
-  {
-    buffer[i] = SPI.transfer(0x00);
-  }
+  memset(buffer, 0, count);
+  SPI.transfer(buffer, count);
 
   // Note: It is assumed that the Energia SPI driver waits until the USCIB0
   // peripheral is done being busy before returning to the caller.
@@ -95,11 +93,8 @@ void A110x2500SpiWrite(unsigned char address,
   // Write the address/command byte.
   SPI.transfer(address);
   
-  // Write dummy byte(s) and read response(s).
-  for (unsigned char i = 0; i < count; i++)
-  {
-    SPI.transfer(buffer[i]);
-  }
+  // Write the data byte(s), the responses are discarded.
+  SPI.write(buffer, count);
 
   // Note: It is assumed that the Energia SPI driver waits until the USCIB0
   // peripheral is done being busy before returning to the caller.
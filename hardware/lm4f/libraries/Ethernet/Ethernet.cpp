@@ -76,6 +76,19 @@ int EthernetClass::maintain()
 	return 0;
 }
 
+void EthernetClass::setDeferred(uint32_t framesPerPass)
+{
+	lwIPDeferredProcessingSet(framesPerPass);
+}
+
+EthernetStats EthernetClass::stats()
+{
+	EthernetStats s;
+
+	s.capture();
+	return s;
+}
+
 IPAddress EthernetClass::localIP()
 {
 	return lwIPLocalIPAddrGet();
@@ -9,6 +9,7 @@
 #include "IPAddress.h"
 #include "EthernetClient.h"
 #include "EthernetServer.h"
+#include "EthernetStats.h"
 
 #define CLASS_A 0x0
 #define CLASS_B 0x2
@@ -41,6 +42,15 @@ public:
 	/* For Arduino compatibility */
 	int maintain();
 
+	/* Run lwIP from the lowest priority interrupt instead of the Ethernet
+	 * interrupt, passing at most framesPerPass received frames up the stack
+	 * per pass. 0 runs lwIP in the Ethernet interrupt again. */
+	void setDeferred(uint32_t framesPerPass = NUM_RX_DESCRIPTORS);
+
+	/* Snapshot of the lwIP protocol counters, the pool usage and the
+	 * EMAC descriptor rings, print it to list them all */
+	EthernetStats stats();
+
 	/* IP Address related functions */
 	IPAddress localIP();
 	IPAddress subnetMask();
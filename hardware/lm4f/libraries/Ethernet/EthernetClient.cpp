@@ -4,18 +4,21 @@
 #include "EthernetClient.h"
 #include "EthernetServer.h"
 
-#include "driverlib/interrupt.h"
+#include "lwip/sys.h"
 
-/* directives for disabling and enabling interrupts */
-#define INT_PROTECT_INIT(x)    int x = 0
-#define INT_PROTECT(x)         x=IntMasterDisable()
-#define INT_UNPROTECT(x)       do{if(!x)IntMasterEnable();}while(0)
+/* directives for holding off the lwIP processing, see sys_arch_protect() */
+#define INT_PROTECT_INIT(x)    SYS_ARCH_DECL_PROTECT(x)
+#define INT_PROTECT(x)         SYS_ARCH_PROTECT(x)
+#define INT_UNPROTECT(x)       SYS_ARCH_UNPROTECT(x)
 
 /* SYNC_FETCH_AND_NULL: atomic{ tmp=*x; *x=NULL; return tmp; } */
 #define SYNC_FETCH_AND_NULL(x)   (__sync_fetch_and_and(x, NULL))
 
 EthernetClient::EthernetClient() {
 	_connected = false;
+	_connecting = false;
+	_onConnect = NULL;
+	_onSent = NULL;
 	cs = &client_state;
 	cs->mode = true;
 	cs->cpcb = NULL;
@@ -23,6 +26,9 @@ EthernetClient::EthernetClient() {
 }
 
 EthernetClient::EthernetClient(struct client *c) {
+	_connecting = false;
+	_onConnect = NULL;
+	_onSent = NULL;
 	if (c == NULL) {
 		_connected = false;
 		cs = &client_state;
@@ -77,28 +83,41 @@ err_t EthernetClient::do_poll(void *arg, struct tcp_pcb *cpcb) {
 void EthernetClient::do_err(void * arg, err_t err) {
 	EthernetClient *client = static_cast<EthernetClient*>(arg);
 
-	if (client->_connected) {
-		client->_connected = false;
-		return;
-	}
+	/* lwIP has already freed the pcb */
+	client->cs->cpcb = NULL;
+	client->_connected = false;
 
-	/*
-	 * Set connected to true to finish connecting.
-	 * ::connect wil take care of figuring out if we are truly connected
-	 * by looking at the socket state
-	 */
-	client->_connected = true;
+	if (client->_connecting) {
+		client->_connecting = false;
+		if (client->_onConnect)
+			client->_onConnect(client, false);
+	}
 }
 
 err_t EthernetClient::do_connected(void * arg, struct tcp_pcb * tpcb,
 		err_t err) {
 	EthernetClient *client = static_cast<EthernetClient*>(arg);
 
+	/* Poll to determine if the peer is still alive */
+	tcp_poll(tpcb, do_poll, 10);
+
 	client->_connected = true;
+	client->_connecting = false;
+	if (client->_onConnect)
+		client->_onConnect(client, true);
 
 	return err;
 }
 
+err_t EthernetClient::do_sent(void *arg, struct tcp_pcb *cpcb, u16_t len) {
+	EthernetClient *client = static_cast<EthernetClient*>(arg);
+
+	if (client->_onSent)
+		client->_onSent(client, len);
+
+	return ERR_OK;
+}
+
 err_t EthernetClient::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 		err_t err) {
 	/*
@@ -155,9 +174,38 @@ int EthernetClient::connect(IPAddress ip, uint16_t port) {
 }
 
 int EthernetClient::connect(IPAddress ip, uint16_t port, unsigned long timeout) {
+	if (!connectAsync(ip, port)) {
+		return false;
+	}
+
+	/* Wait for the connection.
+	 * Abort if the connection does not succeed within the prescribed timeout */
+	unsigned long then = millis();
+
+	while (_connecting) {
+		unsigned long now = millis();
+		delay(10);
+		if (now - then > timeout) {
+			_connecting = false;
+			struct tcp_pcb * cpcb = (tcp_pcb *) SYNC_FETCH_AND_NULL(&cs->cpcb);
+			if (cpcb)
+				tcp_close(cpcb);
+			return false;
+		}
+	}
+
+	return _connected;
+}
+
+int EthernetClient::connectAsync(IPAddress ip, uint16_t port,
+		EthernetConnectCallback callback) {
 	ip_addr_t dest;
 	dest.addr = ip;
 
+	_connected = false;
+	_connecting = false;
+	_onConnect = callback;
+
 	cs->cpcb = tcp_new();
 	cs->read = 0;
 	cs->p = NULL;
@@ -169,34 +217,38 @@ int EthernetClient::connect(IPAddress ip, uint16_t port, unsigned long timeout)
 	tcp_arg((tcp_pcb*)cs->cpcb, this);
 	tcp_recv((tcp_pcb*)cs->cpcb, do_recv);
 	tcp_err((tcp_pcb*)cs->cpcb, do_err);
+	tcp_sent((tcp_pcb*)cs->cpcb, do_sent);
 
-	uint8_t val = tcp_connect((tcp_pcb *)cs->cpcb, &dest, port, do_connected);
+	_connecting = true;
+	err_t val = tcp_connect((tcp_pcb *)cs->cpcb, &dest, port, do_connected);
 
 	if (val != ERR_OK) {
+		_connecting = false;
+		tcp_close((tcp_pcb*)cs->cpcb);
+		cs->cpcb = NULL;
 		return false;
 	}
 
-	/* Wait for the connection.
-	 * Abort if the connection does not succeed within the prescribed timeout */
-	unsigned long then = millis();
+	return true;
+}
 
-	while (!_connected) {
-		unsigned long now = millis();
-		delay(10);
-		if (now - then > timeout) {
-			tcp_close((tcp_pcb*)cs->cpcb);
-			cs->cpcb = NULL;
-			return false;
-		}
-	}
+bool EthernetClient::connecting() {
+	return _connecting;
+}
 
-	if (cs->cpcb->state != ESTABLISHED) {
-		_connected = false;
-	}
+int EthernetClient::availableForWrite() {
+	struct tcp_pcb * cpcb = (tcp_pcb*)cs->cpcb; /* cs->cpcb may change to NULL during interrupt servicing */
 
-	/* Poll to determine if the peer is still alive */
-	tcp_poll((tcp_pcb*)cs->cpcb, do_poll, 10);
-	return _connected;
+	if (!cpcb || _connecting)
+		return 0;
+	/* tcp_write() also fails once the segment queue is full */
+	if (tcp_sndqueuelen(cpcb) >= TCP_SND_QUEUELEN)
+		return 0;
+	return tcp_sndbuf(cpcb);
+}
+
+void EthernetClient::onSent(EthernetSentCallback callback) {
+	_onSent = callback;
 }
 
 size_t EthernetClient::write(uint8_t b) {
@@ -204,6 +256,16 @@ size_t EthernetClient::write(uint8_t b) {
 }
 
 size_t EthernetClient::write(const uint8_t *buf, size_t size) {
+	// Attempt to write in 1024-byte increments.
+	return enqueue(buf, size, 1024, TCP_WRITE_FLAG_COPY);
+}
+
+size_t EthernetClient::writeStatic(const uint8_t *buf, size_t size) {
+	// Full segments, lwIP only keeps pointers into buf
+	return enqueue(buf, size, TCP_MSS, 0);
+}
+
+size_t EthernetClient::enqueue(const uint8_t *buf, size_t size, uint32_t chunk, uint8_t flags) {
 	uint32_t i = 0, inc = 0;
 	boolean stuffed_buffer = false;
 
@@ -212,10 +274,9 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size) {
 	if (!cpcb)
 		return 0;
 
-	// Attempt to write in 1024-byte increments.
 	while (i < size) {
-		inc = (size - i) < 1024 ? size - i : 1024;
-		err_t err = tcp_write(cpcb, buf + i, inc, TCP_WRITE_FLAG_COPY);
+		inc = (size - i) < chunk ? size - i : chunk;
+		err_t err = tcp_write(cpcb, buf + i, inc, flags);
 		if (err != ERR_MEM) {
 			// Keep enqueueing the lwIP buffer until it's full...
 			i += inc;
@@ -223,19 +284,17 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size) {
 		} else {
 			if (!stuffed_buffer) {
 				// Buffer full; force output
-				if (cs->mode)
-					tcp_output(cpcb);
+				tcp_output(cpcb);
 				stuffed_buffer = true;
 			} else {
 				delay(1); // else wait a little bit for lwIP to flush its buffers
 			}
 		}
 	}
-	// flush any remaining queue contents
-	if (!stuffed_buffer) {
-		if (cs->mode)
-			tcp_output(cpcb);
-	}
+	// flush any remaining queue contents, for accepted clients too, or
+	// their replies wait for the 250 ms TCP timer
+	if (!stuffed_buffer)
+		tcp_output(cpcb);
 
 	return size;
 }
@@ -251,8 +310,59 @@ int EthernetClient::port() {
 	return cs->port;
 }
 
+/*
+ * Takes up to size bytes off the receive chain, copying them to buf
+ * unless it is NULL. Fully read pbufs are freed together and the window
+ * is opened once by the number of bytes taken. Must be called with the
+ * ethernet interrupt servicing held off.
+ */
+size_t EthernetClient::consumeLocked(uint8_t *buf, size_t size) {
+	struct pbuf * head = (pbuf*)cs->p;
+	struct pbuf * p = head;
+	uint16_t offset = cs->read;
+	size_t done = 0;
+
+	while (p && done < size) {
+		size_t n = p->len - offset;
+
+		if (n > size - done) {
+			n = size - done;
+			if (buf)
+				memcpy(buf + done, (uint8_t *) p->payload + offset, n);
+			offset += n;
+			done += n;
+			break;
+		}
+
+		if (buf)
+			memcpy(buf + done, (uint8_t *) p->payload + offset, n);
+		done += n;
+		offset = 0;
+		p = p->next;
+	}
+
+	/* Read any data still in the buffer regardless of connection state */
+	if (p != head) {
+		/* Increase ref count on the new head, freeing the old one then
+		 * frees the chain up to it: 1->1->2->1 becomes 1->1 */
+		if (p)
+			pbuf_ref(p);
+		pbuf_free(head);
+		cs->p = p;
+	}
+	cs->read = offset;
+
+	/* Indicate data was received only if still connected */
+	if (done && cs->cpcb) {
+		tcp_recved((tcp_pcb*)cs->cpcb, done);
+	}
+
+	return done;
+}
+
 int EthernetClient::readLocked() {
 	INT_PROTECT_INIT(oldLevel);
+	uint8_t b;
 
 	/* protect the code from preemption of the ethernet interrupt servicing */
 	INT_PROTECT(oldLevel);
@@ -262,32 +372,7 @@ int EthernetClient::readLocked() {
 		return -1;
 	}
 
-	uint8_t *buf = (uint8_t *) cs->p->payload;
-	uint8_t b = buf[cs->read];
-	cs->read++;
-
-	/* Indicate data was received only if still connected */
-	if (cs->cpcb) {
-		tcp_recved((tcp_pcb*)cs->cpcb, cs->read);
-	}
-
-	/* Read any data still in the buffer regardless of connection state */
-	if ((cs->read == cs->p->len) && cs->p->next) {
-		cs->read = 0;
-		struct pbuf * q = (pbuf*)cs->p;
-		cs->p = cs->p->next;
-		/* Increase ref count on p->next
-		 * 1->3->1->etc */
-		pbuf_ref((pbuf*)cs->p);
-		/* Free p which decreases ref count of the chain
-		 * and frees up to p->next in this case
-		 * ...->1->1->etc */
-		pbuf_free(q);
-	} else if (cs->read == cs->p->len) {
-		cs->read = 0;
-		pbuf_free((pbuf*)cs->p);
-		cs->p = NULL;
-	}
+	consumeLocked(&b, 1);
 
 	INT_UNPROTECT(oldLevel);
 
@@ -299,21 +384,59 @@ int EthernetClient::read() {
 }
 
 int EthernetClient::read(uint8_t *buf, size_t size) {
-	uint16_t i;
-	int b;
+	INT_PROTECT_INIT(oldLevel);
+	size_t n;
 
-	if (available() <= 0)
+	/* protect the code from preemption of the ethernet interrupt servicing */
+	INT_PROTECT(oldLevel);
+
+	if (!available()) {
+		INT_UNPROTECT(oldLevel);
 		return -1;
+	}
 
-	/* TODO: Replace lazy method with optimized on */
-	for (i = 0; i < size; i++) {
-		b = read();
-		if (b == -1)
-			break;
-		buf[i] = b;
+	n = consumeLocked(buf, size);
+
+	INT_UNPROTECT(oldLevel);
+
+	return n;
+}
+
+size_t EthernetClient::peekSegment(const uint8_t **data) {
+	INT_PROTECT_INIT(oldLevel);
+	size_t n = 0;
+
+	/* protect code from preemption of the ethernet interrupt servicing */
+	INT_PROTECT(oldLevel);
+
+	struct pbuf * p = (pbuf*)cs->p;
+	uint16_t offset = cs->read;
+
+	/* skip pbufs without unread bytes */
+	while (p && offset == p->len) {
+		p = p->next;
+		offset = 0;
+	}
+	if (p) {
+		*data = (const uint8_t *) p->payload + offset;
+		n = p->len - offset;
 	}
 
-	return i;
+	INT_UNPROTECT(oldLevel);
+
+	return n;
+}
+
+size_t EthernetClient::consume(size_t size) {
+	INT_PROTECT_INIT(oldLevel);
+	size_t n;
+
+	/* protect code from preemption of the ethernet interrupt servicing */
+	INT_PROTECT(oldLevel);
+	n = consumeLocked(NULL, size);
+	INT_UNPROTECT(oldLevel);
+
+	return n;
 }
 
 int EthernetClient::peek() {
@@ -341,8 +464,7 @@ void EthernetClient::flush() {
 	/* protect code from preemption of the ethernet interrupt servicing */
 	INT_PROTECT(oldLevel);
 	if (available()) {
-		cs->read = cs->p->tot_len;
-		tcp_recved((tcp_pcb*)cs->cpcb, 0);
+		consumeLocked(NULL, available());
 	}
 	INT_UNPROTECT(oldLevel);
 }
@@ -10,6 +10,12 @@
 /* Set connection timeout to 10 sec */
 #define CONNECTION_TIMEOUT 1000 * 10
 
+class EthernetClient;
+
+/* Called from the ethernet interrupt servicing */
+typedef void (*EthernetConnectCallback)(EthernetClient *client, bool connected);
+typedef void (*EthernetSentCallback)(EthernetClient *client, uint16_t len);
+
 class EthernetClient : public Client {
 public:
 	EthernetClient();
@@ -20,12 +26,28 @@ public:
 	virtual int connect(const char *host, uint16_t port);
 	virtual int connect(IPAddress ip, uint16_t port, unsigned long timeout);
 	virtual int connect(const char *host, uint16_t port, unsigned long timeout);
+	/* Non-blocking connect: returns once the SYN is on its way,
+	 * connecting() is true until the handshake has finished or failed */
+	int connectAsync(IPAddress ip, uint16_t port, EthernetConnectCallback callback = NULL);
+	bool connecting();
+	/* Bytes write() takes without waiting for the peer */
+	int availableForWrite();
+	/* Reports data acknowledged by the peer, for connect() connections */
+	void onSent(EthernetSentCallback callback);
 	virtual size_t write(uint8_t);
 	virtual size_t write(const uint8_t *buf, size_t size);
+	/* Sends buf without copying it into the lwIP send buffer. buf must stay
+	 * unchanged until the peer has acknowledged it, e.g. const data in flash */
+	size_t writeStatic(const uint8_t *buf, size_t size);
 	virtual int available();
 	virtual int read();
 	virtual int port();
 	virtual int read(uint8_t *buf, size_t size);
+	/* Zero-copy reads: peekSegment() points into the receive buffer at
+	 * the next contiguous run of bytes and returns its length, the
+	 * pointer stays valid until consume(), read(), flush() or stop() */
+	size_t peekSegment(const uint8_t **data);
+	size_t consume(size_t size);
 	virtual int peek();
 	virtual void flush();
 	virtual void stop();
@@ -34,6 +56,7 @@ public:
 	static err_t do_connected(void *arg, struct tcp_pcb *pcb, err_t err);
 	static err_t do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p, err_t err);
 	static err_t do_poll(void *arg, struct tcp_pcb *cpcb);
+	static err_t do_sent(void *arg, struct tcp_pcb *cpcb, u16_t len);
 	static void do_err(void * arg, err_t err);
 	static void do_dns(const char *name, struct ip_addr *ipaddr, void *arg);
 	friend class EthernetServer;
@@ -42,8 +65,13 @@ public:
 private:
 	struct client client_state;
 	volatile bool _connected;
+	volatile bool _connecting;
+	EthernetConnectCallback _onConnect;
+	EthernetSentCallback _onSent;
 	struct client *cs;
 
 	int readLocked();
+	size_t consumeLocked(uint8_t *buf, size_t size);
+	size_t enqueue(const uint8_t *buf, size_t size, uint32_t chunk, uint8_t flags);
 };
 #endif
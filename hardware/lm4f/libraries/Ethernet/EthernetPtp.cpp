@@ -0,0 +1,374 @@
+#include "Ethernet.h"
+#include "EthernetPtp.h"
+#include "lwip/igmp.h"
+#include "lwip/sys.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/emac.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+
+/* PTP message types */
+#define PTP_SYNC        0x0
+#define PTP_DELAY_REQ   0x1
+#define PTP_FOLLOW_UP   0x8
+#define PTP_DELAY_RESP  0x9
+#define PTP_ANNOUNCE    0xB
+
+/* Offsets into the messages */
+#define PTP_HDR_LEN       34
+#define PTP_FLAGS         6
+#define PTP_CORRECTION    8
+#define PTP_SOURCE_PORT   20
+#define PTP_SEQUENCE      30
+#define PTP_TIMESTAMP     34
+#define PTP_REQUESTING    44
+#define PTP_GM_QUALITY    47
+
+#define PTP_TWO_STEP      0x02
+#define PTP_DELAY_REQ_LEN 44
+#define PTP_ANNOUNCE_LEN  64
+#define PTP_MAX_MSG       64
+
+/* The subsecond increment and the addend for the nominal rate,
+ * as programmed by tivaif_hwinit() */
+#define PTP_ADDEND 0x80000000UL
+
+#define NS_PER_SEC 1000000000LL
+
+static const IPAddress ptpPrimary(224, 0, 1, 129);
+
+/* Joins or leaves the group the master sends Sync, Follow_Up and Announce
+ * to, lwIP drops multicast for groups it has not joined */
+static bool ptpGroup(bool join) {
+	SYS_ARCH_DECL_PROTECT(oldLevel);
+	ip_addr_t group;
+	err_t err;
+
+	IP4_ADDR(&group, 224, 0, 1, 129);
+	SYS_ARCH_PROTECT(oldLevel);
+	if (join)
+		err = igmp_joingroup(IP_ADDR_ANY, &group);
+	else
+		err = igmp_leavegroup(IP_ADDR_ANY, &group);
+	SYS_ARCH_UNPROTECT(oldLevel);
+
+	return err == ERR_OK;
+}
+
+static uint16_t get16(const uint8_t *p) {
+	return (p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const uint8_t *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* 48 bit seconds and 32 bit nanoseconds to ns */
+static int64_t getTimestamp(const uint8_t *p) {
+	int64_t sec = ((int64_t)get16(p) << 32) | get32(p + 2);
+	return sec * NS_PER_SEC + get32(p + 6);
+}
+
+/* correctionField is in ns scaled by 2^16 */
+static int64_t getCorrection(const uint8_t *p) {
+	int64_t c = ((int64_t)get32(p) << 32) | get32(p + 4);
+	return c >> 16;
+}
+
+EthernetPTP::EthernetPTP() {
+	_domain = 0;
+	_integral = 0;
+	_adjust = 0;
+	_delaySeq = 0;
+	reset();
+}
+
+void EthernetPTP::reset() {
+	_haveMaster = false;
+	_syncWaiting = false;
+	_haveSync = false;
+	_delaySent = false;
+	_haveDelay = false;
+	_locked = false;
+	_delay = 0;
+	_offset = 0;
+}
+
+bool EthernetPTP::begin(uint8_t domain) {
+#if !LWIP_PTPD
+	/* Without the EMAC timestamps there is nothing to synchronize with */
+	(void) domain;
+	return false;
+#else
+	uint8_t mac[6];
+
+	_domain = domain;
+	_integral = 0;
+	_adjust = 0;
+	_delaySeq = 0;
+	reset();
+
+	/* EUI-64 clock identity from the MAC address */
+	lwIPLocalMACGet(mac);
+	_clockId[0] = mac[0];
+	_clockId[1] = mac[1];
+	_clockId[2] = mac[2];
+	_clockId[3] = 0xFF;
+	_clockId[4] = 0xFE;
+	_clockId[5] = mac[3];
+	_clockId[6] = mac[4];
+	_clockId[7] = mac[5];
+
+	if (!_event.begin(PTP_EVENT_PORT))
+		return false;
+	if (!_general.begin(PTP_GENERAL_PORT)) {
+		_event.stop();
+		return false;
+	}
+	if (!ptpGroup(true)) {
+		_event.stop();
+		_general.stop();
+		return false;
+	}
+
+	EMACTimestampAddendSet(EMAC0_BASE, PTP_ADDEND);
+	return true;
+#endif
+}
+
+void EthernetPTP::stop() {
+	ptpGroup(false);
+	_event.stop();
+	_general.stop();
+	reset();
+}
+
+void EthernetPTP::update() {
+	uint32_t sec, nsec;
+
+	handleEvent();
+	handleGeneral();
+
+	if (_haveMaster && millis() - _lastAnnounce > PTP_ANNOUNCE_TIMEOUT)
+		reset();
+
+	if (_delaySent && !_haveT3 && _event.txTimestamp(&sec, &nsec)) {
+		_t3 = sec * NS_PER_SEC + nsec;
+		_haveT3 = true;
+		if (_haveT4)
+			delayComplete();
+	}
+
+	if (_delaySent && millis() - _delaySentAt > PTP_DELAY_TIMEOUT)
+		_delaySent = false;
+}
+
+bool EthernetPTP::fromMaster(const uint8_t *msg) {
+	return _haveMaster && !memcmp(msg + PTP_SOURCE_PORT, _masterPort, 10);
+}
+
+void EthernetPTP::handleEvent() {
+	uint8_t msg[PTP_MAX_MSG];
+	uint32_t sec, nsec;
+	int len;
+
+	while ((len = _event.parsePacket()) > 0) {
+		len = _event.read(msg, len < PTP_MAX_MSG ? len : PTP_MAX_MSG);
+		if (len < PTP_HDR_LEN + 10 || (msg[1] & 0x0F) != 2 || msg[4] != _domain)
+			continue;
+		if ((msg[0] & 0x0F) != PTP_SYNC || !fromMaster(msg))
+			continue;
+		if (!_event.rxTimestamp(&sec, &nsec))
+			continue;
+
+		if (msg[PTP_FLAGS] & PTP_TWO_STEP) {
+			/* The origin time comes with the Follow_Up */
+			_syncWaiting = true;
+			_syncSeq = get16(msg + PTP_SEQUENCE);
+			_syncT2 = sec * NS_PER_SEC + nsec;
+			_syncCorrection = getCorrection(msg + PTP_CORRECTION);
+		} else {
+			_syncWaiting = false;
+			_syncT2 = sec * NS_PER_SEC + nsec;
+			syncComplete(getTimestamp(msg + PTP_TIMESTAMP),
+					getCorrection(msg + PTP_CORRECTION));
+		}
+	}
+}
+
+void EthernetPTP::handleGeneral() {
+	uint8_t msg[PTP_MAX_MSG];
+	int len;
+
+	while ((len = _general.parsePacket()) > 0) {
+		len = _general.read(msg, len < PTP_MAX_MSG ? len : PTP_MAX_MSG);
+		if (len < PTP_HDR_LEN + 10 || (msg[1] & 0x0F) != 2 || msg[4] != _domain)
+			continue;
+
+		switch (msg[0] & 0x0F) {
+		case PTP_ANNOUNCE:
+			if (len < PTP_ANNOUNCE_LEN)
+				break;
+			/* Best master: the grandmaster priority1, clock class, accuracy,
+			 * variance, priority2 and identity compare in that order */
+			if (!_haveMaster || fromMaster(msg)) {
+				_haveMaster = true;
+			} else if (memcmp(msg + PTP_GM_QUALITY, _masterQuality, 14) < 0) {
+				reset();
+				_haveMaster = true;
+			} else {
+				break;
+			}
+			memcpy(_masterPort, msg + PTP_SOURCE_PORT, 10);
+			memcpy(_masterQuality, msg + PTP_GM_QUALITY, 14);
+			_lastAnnounce = millis();
+			break;
+
+		case PTP_FOLLOW_UP:
+			if (!_syncWaiting || !fromMaster(msg)
+					|| get16(msg + PTP_SEQUENCE) != _syncSeq)
+				break;
+			_syncWaiting = false;
+			syncComplete(getTimestamp(msg + PTP_TIMESTAMP),
+					_syncCorrection + getCorrection(msg + PTP_CORRECTION));
+			break;
+
+		case PTP_DELAY_RESP:
+			if (len < PTP_REQUESTING + 10 || !_delaySent || !fromMaster(msg)
+					|| get16(msg + PTP_SEQUENCE) != _delaySeq
+					|| memcmp(msg + PTP_REQUESTING, _clockId, 8)
+					|| get16(msg + PTP_REQUESTING + 8) != 1)
+				break;
+			/* t4 - t3 with the t4 part here, t3 may still be on its way */
+			_slaveToMaster = getTimestamp(msg + PTP_TIMESTAMP)
+					- getCorrection(msg + PTP_CORRECTION);
+			_haveT4 = true;
+			if (_haveT3)
+				delayComplete();
+			break;
+		}
+	}
+}
+
+void EthernetPTP::syncComplete(int64_t t1, int64_t correction) {
+	_masterToSlave = _syncT2 - t1 - correction;
+	_haveSync = true;
+
+	/* Until the first delay measurement the offset is off by the path
+	 * delay, which is still good enough to step the clock close */
+	servo(_masterToSlave - _delay);
+
+	if (!_delaySent)
+		sendDelayReq();
+}
+
+void EthernetPTP::delayComplete() {
+	int64_t delay;
+
+	_delaySent = false;
+	if (!_haveSync)
+		return;
+
+	delay = (_masterToSlave + (_slaveToMaster - _t3)) / 2;
+	if (delay < 0 || delay > PTP_STEP_THRESHOLD)
+		return;
+
+	if (!_haveDelay) {
+		_delay = delay;
+		_haveDelay = true;
+	} else {
+		/* Average out the queueing jitter of the network */
+		_delay += ((int32_t)delay - _delay) / 8;
+	}
+}
+
+void EthernetPTP::sendDelayReq() {
+	uint8_t msg[PTP_DELAY_REQ_LEN];
+
+	memset(msg, 0, sizeof(msg));
+	msg[0] = PTP_DELAY_REQ;
+	msg[1] = 2;
+	msg[3] = PTP_DELAY_REQ_LEN;
+	msg[4] = _domain;
+	memcpy(msg + PTP_SOURCE_PORT, _clockId, 8);
+	msg[PTP_SOURCE_PORT + 9] = 1;
+	_delaySeq++;
+	msg[PTP_SEQUENCE] = _delaySeq >> 8;
+	msg[PTP_SEQUENCE + 1] = _delaySeq;
+	msg[32] = 1;      /* controlField: Delay_Req */
+	msg[33] = 0x7F;   /* logMessageInterval */
+
+	/* The originTimestamp stays 0, the master only uses its receive time */
+	if (!_event.beginPacket(ptpPrimary, PTP_EVENT_PORT))
+		return;
+	_event.write(msg, sizeof(msg));
+	if (!_event.endPacket())
+		return;
+
+	_delaySent = true;
+	_haveT3 = false;
+	_haveT4 = false;
+	_delaySentAt = millis();
+}
+
+void EthernetPTP::servo(int64_t offset) {
+	uint32_t sec, nsec;
+	int32_t adjust;
+
+	if (offset > PTP_STEP_THRESHOLD || offset < -PTP_STEP_THRESHOLD) {
+		/* Step the clock, the measurements in flight are void */
+		if (offset > 0) {
+			sec = offset / NS_PER_SEC;
+			nsec = offset % NS_PER_SEC;
+		} else {
+			sec = -offset / NS_PER_SEC;
+			nsec = -offset % NS_PER_SEC;
+		}
+		EMACTimestampSysTimeUpdate(EMAC0_BASE, sec, nsec, offset < 0);
+		_integral = 0;
+		_haveSync = false;
+		_delaySent = false;
+		_locked = false;
+		_offset = 0;
+		return;
+	}
+
+	_offset = offset;
+	_locked = _haveDelay && _offset < PTP_LOCK_THRESHOLD && _offset > -PTP_LOCK_THRESHOLD;
+
+	/* PI servo, kp = 0.7 and ki = 0.3 ppb per ns at one Sync per second */
+	_integral += _offset * 3 / 10;
+	_integral = constrain(_integral, -PTP_MAX_ADJUST, PTP_MAX_ADJUST);
+	adjust = -(_offset * 7 / 10 + _integral);
+	_adjust = constrain(adjust, -PTP_MAX_ADJUST, PTP_MAX_ADJUST);
+
+	EMACTimestampAddendSet(EMAC0_BASE,
+			PTP_ADDEND + (int32_t)((int64_t)PTP_ADDEND * _adjust / NS_PER_SEC));
+}
+
+bool EthernetPTP::synchronized() {
+	return _locked;
+}
+
+int32_t EthernetPTP::offset() {
+	return _offset;
+}
+
+int32_t EthernetPTP::pathDelay() {
+	return _delay;
+}
+
+int32_t EthernetPTP::frequency() {
+	return _adjust;
+}
+
+void EthernetPTP::now(uint32_t *sec, uint32_t *nsec) {
+	/* The EMAC is not clocked before Ethernet.begin() */
+	if (!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EMAC0)) {
+		*sec = 0;
+		*nsec = 0;
+		return;
+	}
+
+	EMACTimestampSysTimeGet(EMAC0_BASE, sec, nsec);
+}
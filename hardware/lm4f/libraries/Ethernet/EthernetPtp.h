@@ -0,0 +1,95 @@
+#ifndef ethernetptp_h
+#define ethernetptp_h
+
+#include "Energia.h"
+#include "EthernetUdp.h"
+
+#define PTP_EVENT_PORT 319
+#define PTP_GENERAL_PORT 320
+
+/* Offsets larger than this (ns) step the clock instead of slewing it */
+#define PTP_STEP_THRESHOLD 1000000L
+/* synchronized() once the offset (ns) stays below this */
+#define PTP_LOCK_THRESHOLD 1000L
+/* Largest frequency correction (ppb) */
+#define PTP_MAX_ADJUST 200000L
+/* The master is dropped after this many ms without an Announce */
+#define PTP_ANNOUNCE_TIMEOUT 6000
+/* A Delay_Req is given up after this many ms without a Delay_Resp */
+#define PTP_DELAY_TIMEOUT 2000
+
+/*
+ * IEEE 1588v2 ordinary clock, slave only, using the end-to-end delay
+ * mechanism over UDP/IPv4. The hardware receive and transmit timestamps
+ * of the EMAC drive a PI servo that steers the EMAC system time, which
+ * now() reads from anywhere, interrupts included.
+ *
+ * The library must be built with LWIP_PTPD=1 for the timestamps, see
+ * lwip/lwipopts.h, otherwise begin() fails.
+ */
+class EthernetPTP {
+private:
+	EthernetUDP _event;
+	EthernetUDP _general;
+	uint8_t _domain;
+	uint8_t _clockId[8];
+
+	/* Master picked from the Announce messages */
+	bool _haveMaster;
+	uint8_t _masterPort[10];
+	uint8_t _masterQuality[14];
+	unsigned long _lastAnnounce;
+
+	/* Sync waiting for its Follow_Up, times in ns */
+	bool _syncWaiting;
+	uint16_t _syncSeq;
+	int64_t _syncT2;
+	int64_t _syncCorrection;
+	/* Master to slave time of the last Sync, path delay included */
+	bool _haveSync;
+	int64_t _masterToSlave;
+
+	/* Delay_Req in flight */
+	bool _delaySent;
+	bool _haveT3;
+	bool _haveT4;
+	uint16_t _delaySeq;
+	unsigned long _delaySentAt;
+	int64_t _t3;
+	int64_t _slaveToMaster;
+
+	/* Servo state */
+	bool _haveDelay;
+	bool _locked;
+	int32_t _delay;
+	int32_t _offset;
+	int32_t _integral;
+	int32_t _adjust;
+
+	void handleEvent();
+	void handleGeneral();
+	void syncComplete(int64_t t1, int64_t correction);
+	void delayComplete();
+	void sendDelayReq();
+	void servo(int64_t offset);
+	void reset();
+	bool fromMaster(const uint8_t *msg);
+
+public:
+	EthernetPTP();
+	bool begin(uint8_t domain = 0);
+	void stop();
+	/* Processes the PTP messages, call from loop() */
+	void update();
+	bool synchronized();
+	/* Local clock minus master clock in ns */
+	int32_t offset();
+	int32_t pathDelay();
+	/* Frequency correction applied to the clock in ppb */
+	int32_t frequency();
+
+	/* The disciplined EMAC system time */
+	static void now(uint32_t *sec, uint32_t *nsec);
+};
+
+#endif
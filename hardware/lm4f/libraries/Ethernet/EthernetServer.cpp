@@ -2,12 +2,31 @@
 #include "EthernetClient.h"
 #include "EthernetServer.h"
 
+#include "lwip/sys.h"
+
+/* directives for holding off the lwIP processing, see sys_arch_protect() */
+#define INT_PROTECT_INIT(x)    SYS_ARCH_DECL_PROTECT(x)
+#define INT_PROTECT(x)         SYS_ARCH_PROTECT(x)
+#define INT_UNPROTECT(x)       SYS_ARCH_UNPROTECT(x)
+
 /* SYNC_FETCH_AND_NULL: atomic{ tmp=*x; *x=NULL; return tmp; } */
 #define SYNC_FETCH_AND_NULL(x)   (__sync_fetch_and_and(x, NULL))
 
+/* client.ready: off the ready list, on it for data, on it as a new connection */
+#define READY_NONE 0
+#define READY_DATA 1
+#define READY_NEW  2
+
 EthernetServer::EthernetServer(uint16_t port) {
 	_port = port;
 	lastConnect = 0;
+	clients = NULL;
+	maxClients = 0;
+	readyList = NULL;
+	readyHead = 0;
+	readyCount = 0;
+	acceptCount = 0;
+	rejectCount = 0;
 }
 
 err_t EthernetServer::do_poll(void *arg, struct tcp_pcb *cpcb) {
@@ -25,10 +44,10 @@ err_t EthernetServer::do_poll(void *arg, struct tcp_pcb *cpcb) {
 
 void EthernetServer::do_close(void *arg, struct tcp_pcb *cpcb) {
 	/*
-	 * Get the server object from the argument
+	 * Get the client slot from the argument
 	 * to get access to variables and functions
 	 */
-	EthernetServer *server = static_cast<EthernetServer*>(arg);
+	struct client * cs = static_cast<struct client*>(arg);
 
 	tcp_arg(cpcb, NULL);
 	tcp_recv(cpcb, NULL);
@@ -36,53 +55,70 @@ void EthernetServer::do_close(void *arg, struct tcp_pcb *cpcb) {
 	tcp_poll(cpcb, NULL, 0);
 	tcp_sent(cpcb, NULL);
 
-	uint8_t i;
-	for (i = 0; i < MAX_CLIENTS; i++) {
-		if (server->clients[i].port == cpcb->remote_port)
-			break;
-	}
-	if (i >= MAX_CLIENTS) {
+	if (cs == NULL || cs->cpcb != cpcb) {
 		/* connection already closed */
 		return;
 	}
 
 	/* --- close the connection --- */
 
-	struct client * cs = &server->clients[i];
-
 	cs->read = 0;
 	cs->port = 0;
 
 	if (cs->p) {
-		if (cs->cpcb)
-			tcp_recved(cpcb, cs->p->tot_len);
+		tcp_recved(cpcb, cs->p->tot_len);
 		pbuf_free((pbuf*)cs->p);
 		cs->p = NULL;
 	}
-	if (cs->cpcb) {
-		err_t err = tcp_close(cpcb);
-		if (err != ERR_OK) {
-			/* Error closing, try again later in polli (every 2 sec) */
-			tcp_poll(cpcb, do_poll, 4);
-		}
-		cs->cpcb = NULL;
+
+	err_t err = tcp_close(cpcb);
+	if (err != ERR_OK) {
+		/* Error closing, try again later in polli (every 2 sec) */
+		tcp_poll(cpcb, do_poll, 4);
 	}
+	cs->cpcb = NULL;
 
 	return;
 }
 
+void EthernetServer::do_err(void *arg, err_t err) {
+	struct client * cs = static_cast<struct client*>(arg);
+
+	/* lwIP has already freed the pcb, release the slot */
+	cs->cpcb = NULL;
+	cs->port = 0;
+	cs->read = 0;
+	if (cs->p) {
+		pbuf_free((pbuf*)cs->p);
+		cs->p = NULL;
+	}
+}
+
 err_t EthernetServer::did_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
 	return ERR_OK;
 }
 
+/*
+ * Puts a slot on the ready list unless it is on it already, called
+ * from the ethernet interrupt servicing or with it held off.
+ */
+void EthernetServer::setReady(struct client *cs, uint8_t state) {
+	if (cs->ready == READY_NONE) {
+		readyList[(readyHead + readyCount) % maxClients] = cs - clients;
+		readyCount++;
+	}
+	if (state > cs->ready)
+		cs->ready = state;
+}
+
 err_t EthernetServer::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 		err_t err) {
 
 	/*
-	 * Get the server object from the argument
+	 * Get the client slot from the argument
 	 * to get access to variables and functions
 	 */
-	EthernetServer *server = static_cast<EthernetServer*>(arg);
+	struct client * cs = static_cast<struct client*>(arg);
 
 	/* p==0 for end-of-connection (TCP_FIN packet) */
 	if (p == 0) {
@@ -90,21 +126,19 @@ err_t EthernetServer::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 		return ERR_OK;
 	}
 
-	/* find the connection */
-	uint8_t i;
-	for (i = 0; i < MAX_CLIENTS; i++) {
-		if (server->clients[i].port == cpcb->remote_port)
-			break;
-	}
-	if (i >= MAX_CLIENTS) {
-		/* connection already closed - reject the data */
-		return ERR_MEM;
+	if (cs == NULL || cs->cpcb != cpcb) {
+		/* connection already closed - drop the data */
+		tcp_recved(cpcb, p->tot_len);
+		pbuf_free(p);
+		return ERR_OK;
 	}
 
-	if (server->clients[i].p != 0)
-		pbuf_cat((pbuf*)server->clients[i].p, p);
+	if (cs->p != 0)
+		pbuf_cat((pbuf*)cs->p, p);
 	else
-		server->clients[i].p = p;
+		cs->p = p;
+
+	cs->server->setReady(cs, READY_DATA);
 
 	return ERR_OK;
 }
@@ -117,26 +151,39 @@ err_t EthernetServer::do_accept(void *arg, struct tcp_pcb *cpcb, err_t err) {
 
 	EthernetServer *server = static_cast<EthernetServer*>(arg);
 
+	/* The connection no longer counts against the listen backlog */
+	tcp_accepted(server->spcb);
+
 	/* Find free client */
 	uint8_t i;
-	for (i = 0; i < MAX_CLIENTS; i++) {
+	for (i = 0; i < server->maxClients; i++) {
 		if (server->clients[i].port == 0)
 			break;
 	}
-	if (i >= MAX_CLIENTS) {
+	if (i >= server->maxClients) {
+		server->rejectCount++;
 		return ERR_MEM;
 	}
 
-	memset(&server->clients[i], 0, sizeof(struct client));
+	/* A stale ready list entry of the slot stays valid */
+	struct client * cs = &server->clients[i];
+	uint8_t ready = cs->ready;
 
-	server->clients[i].port = cpcb->remote_port;
-	server->clients[i].cpcb = cpcb;
+	memset(cs, 0, sizeof(struct client));
 
-	tcp_accepted(server->spcb);
+	cs->ready = ready;
+	cs->server = server;
+	cs->port = cpcb->remote_port;
+	cs->cpcb = cpcb;
+	server->acceptCount++;
 
-	tcp_arg(cpcb, arg);
+	tcp_arg(cpcb, cs);
 	tcp_recv(cpcb, do_recv);
 	tcp_sent(cpcb, did_sent);
+	tcp_err(cpcb, do_err);
+
+	/* Hand the new connection out once even if it sends nothing */
+	server->setReady(cs, READY_NEW);
 
 	/*
 	 * Returning ERR_OK indicates to the stack the the
@@ -146,29 +193,73 @@ err_t EthernetServer::do_accept(void *arg, struct tcp_pcb *cpcb, err_t err) {
 }
 
 void EthernetServer::begin() {
+	begin(MAX_CLIENTS);
+}
+
+void EthernetServer::begin(uint8_t max, uint8_t backlog) {
+	if (max == 0)
+		max = MAX_CLIENTS;
+
+	/* The connection table is set up once */
+	if (clients == NULL) {
+		clients = (struct client *) calloc(max, sizeof(struct client));
+		readyList = (uint8_t *) malloc(max);
+		if (clients == NULL || readyList == NULL) {
+			free(clients);
+			free(readyList);
+			clients = NULL;
+			readyList = NULL;
+			return;
+		}
+		maxClients = max;
+	}
+
 	spcb = tcp_new();
 	tcp_bind(spcb, IP_ADDR_ANY, _port);
-	spcb = tcp_listen(spcb);
+	spcb = tcp_listen_with_backlog(spcb, backlog);
 	tcp_arg(spcb, this);
 	tcp_accept(spcb, do_accept);
 }
 
+/*
+ * Returns the next connection that is new or has data. A connection
+ * with data goes back to the end of the ready list so the connections
+ * are served in a round-robin fashion, one that has nothing left to
+ * read drops off until do_recv puts it back.
+ */
 EthernetClient EthernetServer::available() {
-	static uint8_t lastClient = 0; /* serve the clients in a round-robin fashion */
-	uint8_t i;
-	/* Find active client */
-	for (i = 0; i < MAX_CLIENTS; i++) {
-		if (++lastClient >= MAX_CLIENTS)
-			lastClient = 0;
-		if (clients[lastClient].port != 0) {
-			/* cpcb may change to NULL during interrupt servicing, so avoid the NULL pointer access */
-			struct tcp_pcb * cpcb = (tcp_pcb*)clients[lastClient].cpcb;
-			if (cpcb && cpcb->state == ESTABLISHED)
-				return EthernetClient(&clients[lastClient]);
+	INT_PROTECT_INIT(oldLevel);
+	struct client * found = NULL;
+	uint8_t n;
+
+	/* protect the code from preemption of the ethernet interrupt servicing */
+	INT_PROTECT(oldLevel);
+
+	for (n = readyCount; n > 0 && found == NULL; n--) {
+		struct client * cs = &clients[readyList[readyHead]];
+		uint8_t ready = cs->ready;
+
+		readyHead = (readyHead + 1) % maxClients;
+		readyCount--;
+		cs->ready = READY_NONE;
+
+		/* cpcb may change to NULL during interrupt servicing, so avoid the NULL pointer access */
+		struct tcp_pcb * cpcb = (tcp_pcb*)cs->cpcb;
+		if (cs->port == 0 || !cpcb || cpcb->state != ESTABLISHED)
+			continue;
+
+		if (cs->p) {
+			setReady(cs, READY_DATA);
+			found = cs;
+		} else if (ready == READY_NEW) {
+			found = cs;
 		}
 	}
+
+	INT_UNPROTECT(oldLevel);
+
 	/* No client connection active */
-	return EthernetClient(NULL);
+	return EthernetClient(found);
 }
 
 size_t EthernetServer::write(uint8_t b) {
@@ -181,7 +272,7 @@ size_t EthernetServer::write(const uint8_t *buffer, size_t size) {
 	EthernetClient client;
 
 	/* Find connected clients */
-	for (i = 0; i < MAX_CLIENTS; i++) {
+	for (i = 0; i < maxClients; i++) {
 		if (clients[i].port != 0 && clients[i].cpcb
 				&& clients[i].cpcb->state == ESTABLISHED) {
 			/* cpcb may change to NULL during interrupt servicing, so avoid the NULL pointer access */
@@ -195,3 +286,22 @@ size_t EthernetServer::write(const uint8_t *buffer, size_t size) {
 
 	return n;
 }
+
+uint32_t EthernetServer::acceptedConnections() {
+	return acceptCount;
+}
+
+/* Connections turned away because the connection table was full */
+uint32_t EthernetServer::rejectedConnections() {
+	return rejectCount;
+}
+
+uint8_t EthernetServer::activeConnections() {
+	uint8_t i, n = 0;
+
+	for (i = 0; i < maxClients; i++) {
+		if (clients[i].port != 0 && clients[i].cpcb)
+			n++;
+	}
+	return n;
+}
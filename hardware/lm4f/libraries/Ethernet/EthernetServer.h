@@ -4,7 +4,12 @@
 #include "Server.h"
 #include "lwip/tcp.h"
 
+/* Default size of the connection table, begin() can set another */
+#ifndef MAX_CLIENTS
 #define MAX_CLIENTS 8
+#endif
+
+class EthernetServer;
 
 /* 
  * client state structure that is passed on to the client
@@ -20,6 +25,9 @@ struct client {
 	volatile bool connected;
 	uint16_t read;
 	bool mode;
+	/* Owning server and the slot's place on its ready list */
+	EthernetServer *server;
+	volatile uint8_t ready;
 };
 
 class EthernetClient;
@@ -29,13 +37,27 @@ private:
 	unsigned long lastConnect;
 	uint16_t _port;
 	struct tcp_pcb *spcb;
-	struct client clients[MAX_CLIENTS];
+	struct client *clients;
+	uint8_t maxClients;
+	/* Ring of slots that are new or have data, each slot is on it once */
+	uint8_t *readyList;
+	volatile uint8_t readyHead;
+	volatile uint8_t readyCount;
+	volatile uint32_t acceptCount;
+	volatile uint32_t rejectCount;
 	static err_t do_poll(void *arg, struct tcp_pcb *cpcb);
 	static void  do_close(void *arg, struct tcp_pcb *cpcb);
+	static void  do_err(void *arg, err_t err);
+	void setReady(struct client *cs, uint8_t state);
 public:
 	EthernetServer(uint16_t);
 	EthernetClient available();
 	virtual void begin();
+	/* maxClients connections are served, backlog more may be in the handshake */
+	void begin(uint8_t maxClients, uint8_t backlog = TCP_DEFAULT_LISTEN_BACKLOG);
+	uint32_t acceptedConnections();
+	uint32_t rejectedConnections();
+	uint8_t activeConnections();
 	virtual size_t write(uint8_t);
 	virtual size_t write(const uint8_t *buf, size_t size);
 	static err_t do_accept(void *arg, struct tcp_pcb *pcb, err_t err);
@@ -0,0 +1,148 @@
+#include "Ethernet.h"
+#include "EthernetStats.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+
+/* The pool names in the order of memp_t */
+static const char * const poolNames[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc) desc,
+#include "lwip/memp_std.h"
+};
+
+static void copyProto(EthernetProtoStats *to, const struct stats_proto *from) {
+	to->xmit = from->xmit;
+	to->recv = from->recv;
+	to->drop = from->drop;
+	to->chkerr = from->chkerr;
+	to->lenerr = from->lenerr;
+	to->memerr = from->memerr;
+	to->proterr = from->proterr;
+	to->err = from->err;
+}
+
+static void copyPool(EthernetPoolStats *to, const char *name, const struct stats_mem *from) {
+	to->name = name;
+	to->avail = from->avail;
+	to->used = from->used;
+	to->max = from->max;
+	to->err = from->err;
+}
+
+EthernetStats::EthernetStats() {
+	memset(&link, 0, sizeof(link));
+	memset(&etharp, 0, sizeof(etharp));
+	memset(&ip, 0, sizeof(ip));
+	memset(&icmp, 0, sizeof(icmp));
+	memset(&udp, 0, sizeof(udp));
+	memset(&tcp, 0, sizeof(tcp));
+	tcpRetransmits = 0;
+	memset(&heap, 0, sizeof(heap));
+	memset(pools, 0, sizeof(pools));
+	txDescriptorsUsed = 0;
+	txDescriptorsMax = 0;
+	txRingFull = 0;
+	txCopies = 0;
+	rxDescriptorsReady = 0;
+	rxNoBuffer = 0;
+	rxOverruns = 0;
+	rxMissed = 0;
+}
+
+void EthernetStats::capture() {
+	tTivaIFStats driver;
+	uint8_t i;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	tivaif_stats(&driver);
+
+	/* Hold off the lwIP processing for a consistent snapshot */
+	SYS_ARCH_PROTECT(lev);
+#if LWIP_STATS
+	copyProto(&link, &lwip_stats.link);
+	copyProto(&etharp, &lwip_stats.etharp);
+	copyProto(&ip, &lwip_stats.ip);
+	copyProto(&icmp, &lwip_stats.icmp);
+	copyProto(&udp, &lwip_stats.udp);
+	copyProto(&tcp, &lwip_stats.tcp);
+	tcpRetransmits = lwip_stats.tcp.rexmit;
+
+	copyPool(&heap, "HEAP", &lwip_stats.mem);
+	for (i = 0; i < MEMP_MAX; i++)
+		copyPool(&pools[i], poolNames[i], &lwip_stats.memp[i]);
+#endif
+	SYS_ARCH_UNPROTECT(lev);
+
+	txDescriptorsUsed = driver.ui32TXDescUsed;
+	txDescriptorsMax = driver.ui32TXDescMax;
+	txRingFull = driver.ui32TXNoDescCount;
+	txCopies = driver.ui32TXCopyCount;
+	rxDescriptorsReady = driver.ui32RXDescReady;
+	rxNoBuffer = driver.ui32RXNoBufCount;
+	rxOverruns = driver.ui32RXOverflowCount;
+	rxMissed = driver.ui32RXMissedCount;
+}
+
+static size_t printCounter(Print &p, const char *name, uint32_t value) {
+	size_t n = p.print(' ');
+	n += p.print(name);
+	n += p.print(' ');
+	n += p.print(value);
+	return n;
+}
+
+static size_t printProto(Print &p, const char *name, const EthernetProtoStats &s) {
+	size_t n = p.print(name);
+	n += printCounter(p, "xmit", s.xmit);
+	n += printCounter(p, "recv", s.recv);
+	n += printCounter(p, "drop", s.drop);
+	n += printCounter(p, "chkerr", s.chkerr);
+	n += printCounter(p, "lenerr", s.lenerr);
+	n += printCounter(p, "memerr", s.memerr);
+	n += printCounter(p, "proterr", s.proterr);
+	n += printCounter(p, "err", s.err);
+	return n;
+}
+
+static size_t printPool(Print &p, const EthernetPoolStats &s) {
+	size_t n = p.print(s.name);
+	n += printCounter(p, "avail", s.avail);
+	n += printCounter(p, "used", s.used);
+	n += printCounter(p, "max", s.max);
+	n += printCounter(p, "err", s.err);
+	n += p.println();
+	return n;
+}
+
+size_t EthernetStats::printTo(Print &p) const {
+	size_t n = 0;
+	uint8_t i;
+
+	n += printProto(p, "LINK", link);
+	n += p.println();
+	n += printProto(p, "ETHARP", etharp);
+	n += p.println();
+	n += printProto(p, "IP", ip);
+	n += p.println();
+	n += printProto(p, "ICMP", icmp);
+	n += p.println();
+	n += printProto(p, "UDP", udp);
+	n += p.println();
+	n += printProto(p, "TCP", tcp);
+	n += printCounter(p, "rexmit", tcpRetransmits);
+	n += p.println();
+
+	n += printPool(p, heap);
+	for (i = 0; i < MEMP_MAX; i++)
+		n += printPool(p, pools[i]);
+
+	n += p.print("EMAC");
+	n += printCounter(p, "txused", txDescriptorsUsed);
+	n += printCounter(p, "txmax", txDescriptorsMax);
+	n += printCounter(p, "txfull", txRingFull);
+	n += printCounter(p, "txcopy", txCopies);
+	n += printCounter(p, "rxready", rxDescriptorsReady);
+	n += printCounter(p, "rxnobuf", rxNoBuffer);
+	n += printCounter(p, "rxoverrun", rxOverruns);
+	n += printCounter(p, "rxmissed", rxMissed);
+	return n;
+}
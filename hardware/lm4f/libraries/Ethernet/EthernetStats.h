@@ -0,0 +1,69 @@
+#ifndef ethernetstats_h
+#define ethernetstats_h
+
+#include "Energia.h"
+#include "Printable.h"
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+
+/* Counters of one protocol layer, see lwip/stats.h */
+struct EthernetProtoStats {
+	uint32_t xmit;
+	uint32_t recv;
+	uint32_t drop;
+	uint32_t chkerr;
+	uint32_t lenerr;
+	uint32_t memerr;
+	uint32_t proterr;
+	uint32_t err;
+};
+
+/* Use of an lwIP memory pool or the heap */
+struct EthernetPoolStats {
+	const char *name;
+	uint32_t avail;
+	uint32_t used;
+	/* High-water mark of used */
+	uint32_t max;
+	/* Allocations that failed */
+	uint32_t err;
+};
+
+/*
+ * Snapshot of the lwIP and Ethernet driver counters, taken by
+ * Ethernet.stats(). Printing it lists all of them.
+ */
+class EthernetStats : public Printable {
+private:
+	void capture();
+
+public:
+	EthernetStats();
+
+	EthernetProtoStats link;
+	EthernetProtoStats etharp;
+	EthernetProtoStats ip;
+	EthernetProtoStats icmp;
+	EthernetProtoStats udp;
+	EthernetProtoStats tcp;
+	uint32_t tcpRetransmits;
+
+	EthernetPoolStats heap;
+	EthernetPoolStats pools[MEMP_MAX];
+
+	/* EMAC descriptor rings */
+	uint32_t txDescriptorsUsed;
+	uint32_t txDescriptorsMax;
+	uint32_t txRingFull;
+	uint32_t txCopies;
+	uint32_t rxDescriptorsReady;
+	uint32_t rxNoBuffer;
+	uint32_t rxOverruns;
+	uint32_t rxMissed;
+
+	virtual size_t printTo(Print &p) const;
+
+	friend class EthernetClass;
+};
+
+#endif
@@ -1,12 +1,28 @@
 #include "EthernetUdp.h"
 #include "lwip/udp.h"
 #include <lwip/dns.h>
+#include "netif/tivaif.h"
+#include "lwip/sys.h"
+
+/* directives for holding off the lwIP processing, see sys_arch_protect() */
+#define INT_PROTECT_INIT(x)    SYS_ARCH_DECL_PROTECT(x)
+#define INT_PROTECT(x)         SYS_ARCH_PROTECT(x)
+#define INT_UNPROTECT(x)       SYS_ARCH_UNPROTECT(x)
 
 EthernetUDP::EthernetUDP() {
 	_read = 0;
+	packets = NULL;
+	size = 0;
 	front = 0;
+	rear = 0;
 	count = 0;
+	dropped = 0;
+	_pcb = NULL;
 	_p = NULL;
+	_sendTop = NULL;
+	_sent = NULL;
+	_rxSec = 0;
+	_rxNsec = 0;
 }
 
 void EthernetUDP::do_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, struct ip_addr* addr, uint16_t port)
@@ -14,37 +30,61 @@ void EthernetUDP::do_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, struc
 	EthernetUDP *udp = static_cast<EthernetUDP*>(arg);
 
 	/* No more space in the receive queue */
-	if(udp->count >= UDP_RX_MAX_PACKETS) {
+	if(udp->count >= udp->size) {
+		udp->dropped++;
 		pbuf_free(p);
 		return;
 	}
 
-	/* Increase the number of packets in the queue
-	 * that are waiting for processing */
-	udp->count++;
-	/* Add pacekt to the rear of the queue */
+	/* Add packet to the rear of the queue */
 	udp->packets[udp->rear].p = p;
-	/* Record the IP address and port the pacekt was received from */
-	udp->packets[udp->rear].remoteIP = IPAddress(addr->addr);
+	/* Record the IP address and port the packet was received from */
+	udp->packets[udp->rear].remoteIP = addr->addr;
 	udp->packets[udp->rear].remotePort = port;
-	udp->packets[udp->rear].destIP = IPAddress(ip_current_dest_addr()->addr);
+	udp->packets[udp->rear].destIP = ip_current_dest_addr()->addr;
 
 	/* Advance the rear of the queue */
 	udp->rear++;
 
 	/* Wrap around the end of the array was reached */
-	if(udp->rear == UDP_RX_MAX_PACKETS)
+	if(udp->rear == udp->size)
 		udp->rear = 0;
+
+	/* Increase the number of packets in the queue
+	 * that are waiting for processing, this hands the packet over */
+	udp->count++;
 }
 
 uint8_t EthernetUDP::begin(uint16_t port)
 {
+	return begin(port, UDP_RX_MAX_PACKETS);
+}
+
+uint8_t EthernetUDP::begin(uint16_t port, uint8_t queueLength)
+{
+	if(queueLength == 0)
+		queueLength = UDP_RX_MAX_PACKETS;
+
+	/* The receive queue is set up once */
+	if(packets == NULL) {
+		packets = (struct packet *) malloc(queueLength * sizeof(struct packet));
+		if(packets == NULL)
+			return 0;
+		size = queueLength;
+	}
+
 	_port = port;
 	_pcb = udp_new();
+	if(_pcb == NULL)
+		return 0;
+
 	err_t err = udp_bind(_pcb, IP_ADDR_ANY, port);
 
-	if(err == ERR_USE)
+	if(err == ERR_USE) {
+		udp_remove(_pcb);
+		_pcb = NULL;
 		return 0;
+	}
 
 	udp_recv(_pcb, do_recv, this);
 	return 1;
@@ -60,7 +100,33 @@ int EthernetUDP::available()
 
 void EthernetUDP::stop()
 {
-	udp_remove(_pcb);
+	INT_PROTECT_INIT(oldLevel);
+
+	if(_pcb) {
+		udp_remove(_pcb);
+		_pcb = NULL;
+	}
+
+	/* Drop the packets still in the queue */
+	INT_PROTECT(oldLevel);
+	while(count) {
+		pbuf_free(packets[front].p);
+		front++;
+		if(front == size)
+			front = 0;
+		count--;
+	}
+	INT_UNPROTECT(oldLevel);
+
+	if(_p) {
+		pbuf_free(_p);
+		_p = NULL;
+	}
+
+	if(_sent) {
+		pbuf_free(_sent);
+		_sent = NULL;
+	}
 }
 
 void EthernetUDP::do_dns(const char *name, struct ip_addr *ipaddr, void *arg)
@@ -93,7 +159,13 @@ int EthernetUDP::beginPacket(IPAddress ip, uint16_t port)
 	_sendToIP = ip;
 	_sendToPort = port;
 
-	_sendTop = pbuf_alloc(PBUF_TRANSPORT, UDP_TX_PACKET_MAX_SIZE, PBUF_POOL);
+	/* A packet that was begun but never sent */
+	if(_sendTop)
+		pbuf_free(_sendTop);
+
+	/* One contiguous buffer that write() fills in place, shrunk
+	 * to the written size by endPacket() */
+	_sendTop = pbuf_alloc(PBUF_TRANSPORT, UDP_TX_PACKET_MAX_SIZE, PBUF_RAM);
 
 	_write = 0;
 
@@ -108,15 +180,27 @@ int EthernetUDP::endPacket()
 	ip_addr_t dest;
 	dest.addr = _sendToIP;
 
+	if(_sendTop == NULL || _pcb == NULL)
+		return false;
+
 	/* Shrink the pbuf to the actual size that was written to it */
 	pbuf_realloc(_sendTop, _write);
 
 	/* Send the buffer to the remote host */
 	err_t err = udp_sendto(_pcb, _sendTop, &dest, _sendToPort);
 
+#if LWIP_PTPD
+	/* Hold on to the pbuf so that txTimestamp() can pick up
+	 * the timestamp the driver stores in it once it is sent */
+	if(_sent)
+		pbuf_free(_sent);
+	_sent = _sendTop;
+#else
 	/* udp_sendto is blocking and the pbuf is
 	 * no longer needed so free it */
 	pbuf_free(_sendTop);
+#endif
+	_sendTop = NULL;
 
 	if(err != ERR_OK)
 		return false;
@@ -131,6 +215,9 @@ size_t EthernetUDP::write(uint8_t byte)
 
 size_t EthernetUDP::write(const uint8_t *buffer, size_t size)
 {
+	if(_sendTop == NULL)
+		return 0;
+
 	uint16_t avail = _sendTop->tot_len - _write;
 
 	/* If there is no more space available
@@ -143,8 +230,8 @@ size_t EthernetUDP::write(const uint8_t *buffer, size_t size)
 	if(size > avail)
 		size = avail;
 
-	/* Copy buffer into the pbuf */
-	pbuf_take(_sendTop, buffer, size);
+	/* Copy buffer into the pbuf behind what was written before */
+	memcpy((uint8_t *)_sendTop->payload + _write, buffer, size);
 
 	_write += size;
 
@@ -153,6 +240,9 @@ size_t EthernetUDP::write(const uint8_t *buffer, size_t size)
 
 int EthernetUDP::parsePacket()
 {
+	INT_PROTECT_INIT(oldLevel);
+	struct packet packet;
+
 	_read = 0;
 
 	/* Discard the current packet */
@@ -162,18 +252,21 @@ int EthernetUDP::parsePacket()
 		_remotePort = 0;
 		_remoteIP = IPAddress(IPADDR_NONE);
 		_destIP = IPAddress(IPADDR_NONE);
+		_rxSec = 0;
+		_rxNsec = 0;
 	}
 
+	/* protect the queue from preemption of the ethernet interrupt servicing */
+	INT_PROTECT(oldLevel);
+
 	/* No more packets in the queue */
 	if(!count) {
+		INT_UNPROTECT(oldLevel);
 		return 0;
 	}
 
 	/* Take the next packet from the front of the queue */
-	_p = packets[front].p;
-	_remoteIP = packets[front].remoteIP;
-	_remotePort = packets[front].remotePort;
-	_destIP = packets[front].destIP;
+	packet = packets[front];
 
 	count--;
 
@@ -181,21 +274,27 @@ int EthernetUDP::parsePacket()
 	front++;
 
 	/* Wrap around if end of queue has been reached */
-	if(front == UDP_RX_MAX_PACKETS)
+	if(front == size)
 		front = 0;
 
+	INT_UNPROTECT(oldLevel);
+
+	_p = packet.p;
+	_remoteIP = IPAddress(packet.remoteIP);
+	_remotePort = packet.remotePort;
+	_destIP = IPAddress(packet.destIP);
+#if LWIP_PTPD
+	_rxSec = _p->time_s;
+	_rxNsec = _p->time_ns;
+#endif
+
 	/* Return the total len of the queue */
 	return _p->tot_len;
 }
 
-int EthernetUDP::read()
+/* Moves on to the next pbuf of the chain once the current one is read */
+void EthernetUDP::nextSegment()
 {
-	if(!available()) return -1;
-
-	uint8_t *buf = (uint8_t *)_p->payload;
-	uint8_t b = buf[_read];
-	_read = _read + 1;
-
 	if((_read == _p->len) && _p->next) {
 		_read = 0;
 		pbuf *p;
@@ -214,6 +313,17 @@ int EthernetUDP::read()
 		pbuf_free(_p);
 		_p = NULL;
 	}
+}
+
+int EthernetUDP::read()
+{
+	if(!available()) return -1;
+
+	uint8_t *buf = (uint8_t *)_p->payload;
+	uint8_t b = buf[_read];
+	_read = _read + 1;
+
+	nextSegment();
 
 	return b;
 }
@@ -222,23 +332,56 @@ int EthernetUDP::read()
 int EthernetUDP::read(unsigned char* buffer, size_t len)
 {
 	uint16_t avail = available();
-	uint16_t i;
-	int b;
+	uint16_t i = 0;
+	uint16_t n;
 
 	if(!avail)
 		return -1;
 
-	/* TODO: Replace lazy method with optimized on */
-	for(i = 0; i < len; i++) {
-		b = read();
-		if(b == -1)
-			break;
-		buffer[i] = b;
+	/* Copy a pbuf of the chain at a time */
+	while(i < len && _p && _read < _p->len) {
+		n = _p->len - _read;
+		if(n > len - i)
+			n = len - i;
+		memcpy(buffer + i, (uint8_t *)_p->payload + _read, n);
+		i += n;
+		_read += n;
+
+		nextSegment();
 	}
 
 	return i;
 }
 
+/*
+ * The unread part of the current pbuf in place, no copy. Datagrams up
+ * to the pbuf pool size come in one piece, read() moves on past it.
+ */
+const uint8_t *EthernetUDP::packetData(size_t *len)
+{
+	if(!available() || _read >= _p->len) {
+		if(len)
+			*len = 0;
+		return NULL;
+	}
+
+	if(len)
+		*len = _p->len - _read;
+
+	return (const uint8_t *)_p->payload + _read;
+}
+
+int EthernetUDP::queued()
+{
+	return count;
+}
+
+/* Datagrams dropped because the receive queue was full */
+uint32_t EthernetUDP::droppedPackets()
+{
+	return dropped;
+}
+
 int EthernetUDP::peek()
 {
 	uint8_t b;
@@ -258,3 +401,35 @@ void EthernetUDP::flush()
 		_read = _p->tot_len;
 	}
 }
+
+bool EthernetUDP::rxTimestamp(uint32_t *sec, uint32_t *nsec)
+{
+#if LWIP_PTPD
+	/* Cleared with the packet by parsePacket() */
+	if(!_rxSec && !_rxNsec)
+		return false;
+
+	*sec = _rxSec;
+	*nsec = _rxNsec;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool EthernetUDP::txTimestamp(uint32_t *sec, uint32_t *nsec)
+{
+#if LWIP_PTPD
+	struct pbuf *p = _sent;
+
+	/* The flag is set after the time by the transmit interrupt servicing */
+	if(!p || !(*(volatile u8_t *)&p->flags & PBUF_FLAG_TX_TIMESTAMP))
+		return false;
+
+	*sec = p->time_s;
+	*nsec = p->time_ns;
+	return true;
+#else
+	return false;
+#endif
+}
@@ -1,7 +1,10 @@
 #ifndef ethernetudp_h
 #define ethernetudp_h
 
+/* Default receive queue length, begin() can set another */
+#ifndef UDP_RX_MAX_PACKETS
 #define UDP_RX_MAX_PACKETS 32
+#endif
 #define UDP_TX_PACKET_MAX_SIZE 2048
 
 #include "Energia.h"
@@ -9,17 +12,20 @@
 
 struct packet {
 	struct pbuf *p;
-	IPAddress remoteIP;
+	uint32_t remoteIP;
+	uint32_t destIP;
 	uint16_t remotePort;
-	IPAddress destIP;
 };
 
 class EthernetUDP : public UDP {
 private:
-	struct packet packets[UDP_RX_MAX_PACKETS];
+	/* Ring of received datagrams, filled by do_recv() */
+	struct packet *packets;
+	uint8_t size;
 	uint8_t front;
-	uint8_t rear;
-	uint8_t count;
+	volatile uint8_t rear;
+	volatile uint8_t count;
+	volatile uint32_t dropped;
 
 	struct udp_pcb *_pcb;
 	struct pbuf *_p;
@@ -33,14 +39,22 @@ private:
 	struct udp_pcb *_sendToPcb;
 	IPAddress _sendToIP;
 	uint16_t _sendToPort;
+	/* Last packet sent, kept until the driver has stamped it */
+	struct pbuf *_sent;
+	/* Hardware receive timestamp of the current packet */
+	uint32_t _rxSec;
+	uint32_t _rxNsec;
 
 	uint16_t _read;
 	uint16_t _write;
+	void nextSegment();
 	static void do_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, struct ip_addr* addr, uint16_t port);
 	static void do_dns(const char *name, struct ip_addr *ipaddr, void *arg);
 public:
 	EthernetUDP();
 	virtual uint8_t begin(uint16_t);
+	/* Queues up to queueLength datagrams between parsePacket() calls */
+	uint8_t begin(uint16_t port, uint8_t queueLength);
 	virtual void stop();
 	virtual int beginPacket(IPAddress ip, uint16_t port);
 	virtual int beginPacket(const char *host, uint16_t port);
@@ -58,9 +72,23 @@ public:
 	virtual int peek();
 	virtual void flush();
 
+	/* Zero-copy access to the unread bytes of the current packet, len is
+	 * set to the number of contiguous bytes the pointer covers. Valid
+	 * until the next read(), flush() or parsePacket() */
+	const uint8_t *packetData(size_t *len = NULL);
+	/* Datagrams queued and not yet taken by parsePacket() */
+	int queued();
+	/* Datagrams dropped because the receive queue was full */
+	uint32_t droppedPackets();
+
 	virtual IPAddress remoteIP() { return _remoteIP; };
 	virtual uint16_t remotePort() { return _remotePort; };
 	virtual IPAddress destIP() { return _destIP; };
+
+	/* IEEE 1588 clock time at which the current packet was received and
+	 * the last packet was sent, false if the MAC did not stamp it (yet) */
+	bool rxTimestamp(uint32_t *sec, uint32_t *nsec);
+	bool txTimestamp(uint32_t *sec, uint32_t *nsec);
 };
 
 #endif
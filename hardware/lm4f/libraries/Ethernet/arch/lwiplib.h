@@ -78,6 +78,15 @@ extern "C"
 #define IPADDR_USE_DHCP         1
 #define IPADDR_USE_AUTOIP       2
 
+//*****************************************************************************
+//
+// The interrupt priority of the deferred lwIP handler, the lowest one.
+//
+//*****************************************************************************
+#ifndef LWIP_DEFERRED_PRIORITY
+#define LWIP_DEFERRED_PRIORITY  0xE0
+#endif
+
 //*****************************************************************************
 //
 // Hardware timer interrupt callback function type (available only when running
@@ -101,6 +110,8 @@ extern void lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8Mac,
 extern void lwIPTimerCallbackRegister(tHardwareTimerHandler pfnTimerFunc);
 extern void lwIPTimer(uint32_t ui32TimeMS);
 extern void lwIPEthernetIntHandler(void);
+extern void lwIPDeferredProcessingSet(uint32_t ui32MaxFrames);
+extern uint32_t lwIPDeferredProcessingGet(void);
 extern uint32_t lwIPLocalIPAddrGet(void);
 extern uint32_t lwIPLocalNetMaskGet(void);
 extern uint32_t lwIPLocalGWAddrGet(void);
@@ -0,0 +1,37 @@
+/*
+
+ Network Stats
+
+ Prints the lwIP protocol counters, the memory pool usage and the
+ Ethernet descriptor rings every 10 seconds. The "max" column of the
+ pools is the high-water mark, a pool with a non-zero "err" ran out and
+ is a candidate for a larger size in lwipopts.h.
+
+ This code is in the public domain.
+
+ */
+
+#include <Ethernet.h>
+
+unsigned long lastPrint;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("NetworkStats setup");
+
+  if (Ethernet.begin(0) == 0) {
+    Serial.println("Failed to configure Ethernet using DHCP");
+    for(;;) ;
+  }
+
+  Serial.print("My IP address: ");
+  Serial.println(Ethernet.localIP());
+}
+
+void loop() {
+  if (millis() - lastPrint >= 10000) {
+    lastPrint = millis();
+    Serial.println(Ethernet.stats());
+    Serial.println();
+  }
+}
@@ -0,0 +1,60 @@
+/*
+
+ PTP Slave
+
+ Synchronizes the Ethernet hardware clock to an IEEE 1588 (PTP) master
+ on the local network and prints the offset from the master, the path
+ delay and the frequency correction once per second.
+
+ A PTP master such as ptp4l must be running on the network in domain 0.
+ The Ethernet library must be built with the EMAC timestamps, add
+ -DLWIP_PTPD=1 to build.extra_flags of the board in boards.txt.
+
+ This code is in the public domain.
+
+ */
+
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <EthernetPtp.h>
+
+EthernetPTP ptp;
+unsigned long lastPrint;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("PtpSlave setup");
+
+  if (Ethernet.begin(0) == 0) {
+    Serial.println("Failed to configure Ethernet using DHCP");
+    for(;;) ;
+  }
+
+  if (!ptp.begin()) {
+    Serial.println("PTP needs LWIP_PTPD=1 and free ports 319 and 320");
+    for(;;) ;
+  }
+}
+
+void loop() {
+  uint32_t sec, nsec;
+
+  ptp.update();
+
+  if (millis() - lastPrint >= 1000) {
+    lastPrint = millis();
+    EthernetPTP::now(&sec, &nsec);
+
+    Serial.print(sec);
+    Serial.print('.');
+    Serial.print(nsec);
+    Serial.print(ptp.synchronized() ? " locked" : " unlocked");
+    Serial.print(" offset ");
+    Serial.print(ptp.offset());
+    Serial.print(" ns delay ");
+    Serial.print(ptp.pathDelay());
+    Serial.print(" ns freq ");
+    Serial.print(ptp.frequency());
+    Serial.println(" ppb");
+  }
+}
@@ -0,0 +1,99 @@
+/*
+
+ TCP Throughput
+
+ Measures the sustained TCP receive and send rates of the board and
+ prints them once per second.
+
+ Receive: send data to port 5001, e.g. with iperf 2
+   iperf -c <board ip> -p 5001 -t 30
+ Send: read data from port 5002, e.g. with netcat
+   nc <board ip> 5002 | pv > /dev/null
+
+ The rates depend on the lwIP network profile the library is built
+ with, see LWIP_PROFILE in lwipopts.h. The profile in use is printed
+ at startup.
+
+ This code is in the public domain.
+
+ */
+
+#include <Ethernet.h>
+
+EthernetServer sinkServer(5001);
+EthernetServer sourceServer(5002);
+EthernetClient sink;
+EthernetClient source;
+
+/* Sent with writeStatic(), the content never changes so it
+ * can be queued again before the peer has acknowledged it */
+static uint8_t pattern[4 * 1460];
+
+unsigned long received;
+unsigned long sent;
+unsigned long lastPrint;
+
+void printRate(const char *what, unsigned long bytes, unsigned long ms) {
+  Serial.print(what);
+  Serial.print(bytes * 8 / ms / 1000.0);
+  Serial.print(" Mbit/s");
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("TcpThroughput setup");
+
+  for (unsigned int i = 0; i < sizeof(pattern); i++)
+    pattern[i] = 'a' + i % 26;
+
+  if (Ethernet.begin(0) == 0) {
+    Serial.println("Failed to configure Ethernet using DHCP");
+    for(;;) ;
+  }
+
+  Serial.print("lwIP profile ");
+  Serial.print(LWIP_PROFILE);
+  Serial.print(", TCP window ");
+  Serial.print(TCP_WND);
+  Serial.print(", send buffer ");
+  Serial.println(TCP_SND_BUF);
+  Serial.print("Listening on ");
+  Serial.print(Ethernet.localIP());
+  Serial.println(" ports 5001 (receive) and 5002 (send)");
+
+  sinkServer.begin();
+  sourceServer.begin();
+  lastPrint = millis();
+}
+
+void loop() {
+  const uint8_t *data;
+  size_t len;
+  unsigned long now;
+
+  if (!sink.connected()) {
+    sink.stop();
+    sink = sinkServer.available();
+  }
+  if (!source.connected()) {
+    source.stop();
+    source = sourceServer.available();
+  }
+
+  /* Take the received data straight from the pbufs */
+  while (sink.connected() && (len = sink.peekSegment(&data)) > 0)
+    received += sink.consume(len);
+
+  if (source.connected())
+    sent += source.writeStatic(pattern, sizeof(pattern));
+
+  now = millis();
+  if (now - lastPrint >= 1000) {
+    printRate("receive ", received, now - lastPrint);
+    printRate(", send ", sent, now - lastPrint);
+    Serial.println();
+    received = 0;
+    sent = 0;
+    lastPrint = now;
+  }
+}
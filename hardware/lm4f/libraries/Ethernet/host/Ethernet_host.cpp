@@ -0,0 +1,112 @@
+/*
+ * Ethernet_host.cpp - EthernetClass for the Linux host build, in place of
+ * ../Ethernet.cpp, which reads the MAC from flash and drives the LED pins.
+ */
+
+#include <Energia.h>
+#include <Ethernet.h>
+#include <lwip/inet.h>
+#include <IPAddress.h>
+
+/* Locally administered, used when begin() is given no MAC */
+static const uint8_t hostMAC[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway, IPAddress subnet)
+{
+	registerSysTickCb(lwIPTimer);
+
+	memcpy(pui8MACArray, mac_address ? mac_address : hostMAC, 6);
+
+	if(!subnet) {
+		if((local_ip >> 31) == CLASS_A)
+			subnet = CLASS_A_SUBNET;
+		else if((local_ip >> 30) == CLASS_B)
+			subnet = CLASS_B_SUBNET;
+		else if((local_ip >> 29) == CLASS_C)
+			subnet = CLASS_C_SUBNET;
+	}
+
+	lwIPInit(F_CPU, pui8MACArray, htonl(local_ip), htonl(subnet), htonl(gateway), !local_ip ? IPADDR_USE_DHCP:IPADDR_USE_STATIC);
+
+	lwIPDNSAddrSet((uint32_t)dns_server);
+}
+
+void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server)
+{
+	IPAddress gateway = local_ip;
+	gateway[3] = 1;
+	begin(mac_address, local_ip, dns_server, gateway);
+}
+
+void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway)
+{
+	begin(mac_address, local_ip, dns_server, gateway, IPAddress(0,0,0,0));
+}
+
+void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip)
+{
+	IPAddress dns_server = local_ip;
+	dns_server[3] = 1;
+	begin(mac_address, local_ip, dns_server);
+}
+
+int EthernetClass::begin(uint8_t *mac_address)
+{
+	begin(mac_address, IPAddress(0,0,0,0), IPAddress(0,0,0,0), IPAddress(0,0,0,0), IPAddress(0,0,0,0));
+	return lwIPDHCPWaitLeaseValid();
+}
+
+int EthernetClass::maintain()
+{
+	return 0;
+}
+
+void EthernetClass::setDeferred(uint32_t framesPerPass)
+{
+	lwIPDeferredProcessingSet(framesPerPass);
+}
+
+EthernetStats EthernetClass::stats()
+{
+	EthernetStats s;
+
+	s.capture();
+	return s;
+}
+
+IPAddress EthernetClass::localIP()
+{
+	return lwIPLocalIPAddrGet();
+}
+
+IPAddress EthernetClass::gatewayIP()
+{
+	return lwIPLocalGWAddrGet();
+}
+
+IPAddress EthernetClass::subnetMask()
+{
+	return lwIPLocalNetMaskGet();
+}
+
+IPAddress EthernetClass::dnsServerIP()
+{
+	return lwIPDNSAddrGet();
+}
+
+uint8_t* EthernetClass::macAddress(uint8_t* mac)
+{
+	memcpy(mac, pui8MACArray, 6);
+	return mac;
+}
+
+/* No LEDs on the host */
+void EthernetClass::enableLinkLed()
+{
+}
+
+void EthernetClass::enableActivityLed()
+{
+}
+
+EthernetClass Ethernet;
@@ -0,0 +1,50 @@
+/*
+ * lwIP compiler and platform definitions for the Linux host build.
+ *
+ * Takes the place of ../../arch/cc.h, whose long based types are 64 bit
+ * wide on the host.
+ */
+#ifndef __CC_H__
+#define __CC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef uint8_t     u8_t;
+typedef int8_t      s8_t;
+typedef uint16_t    u16_t;
+typedef int16_t     s16_t;
+typedef uint32_t    u32_t;
+typedef int32_t     s32_t;
+typedef uintptr_t   mem_ptr_t;
+typedef u8_t        sys_prot_t;
+
+#define U16_F "hu"
+#define S16_F "hd"
+#define X16_F "hx"
+#define U32_F "u"
+#define S32_F "d"
+#define X32_F "x"
+#define SZT_F "zu"
+
+#ifndef BYTE_ORDER
+#define BYTE_ORDER LITTLE_ENDIAN
+#endif
+
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_STRUCT __attribute__ ((__packed__))
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x) x
+
+#define LWIP_PLATFORM_DIAG(msg) do { printf msg; } while(0)
+
+#define LWIP_PLATFORM_ASSERT(msg)                                           \
+    do {                                                                    \
+        printf("Assertion \"%s\" failed at line %d in %s\n", msg,           \
+               __LINE__, __FILE__);                                         \
+        abort();                                                            \
+    } while(0)
+
+#endif /* __CC_H__ */
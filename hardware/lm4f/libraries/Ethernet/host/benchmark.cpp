@@ -0,0 +1,264 @@
+/*
+ * benchmark.cpp - connection rate, throughput and latency of the Ethernet
+ * library on the host, for the network profile it was built with.
+ *
+ * Over the loopback wire a client and a server of this process talk to
+ * each other, so every figure is the cost of both ends of the stack plus
+ * the library. With ENERGIA_TAP set it serves Linux tools instead.
+ *
+ * usage: benchmark [local IP] [seconds per test]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Energia.h>
+#include <Ethernet.h>
+#include "host.h"
+
+#define SINK_PORT     5001
+#define CONNECT_PORT  5003
+#define PINGPONG_PORT 5004
+#define ECHO_PORT     7
+
+/* Prints to stdout, for the Printable results */
+class StdoutPrint : public Print {
+public:
+	virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static StdoutPrint out;
+static IPAddress localAddr(192, 168, 7, 2);
+static uint32_t testMillis = 2000;
+
+static uint8_t pattern[TCP_MSS];
+static uint8_t scratch[2048];
+
+/* Empties the receive buffer of a connection without copying it */
+static size_t drain(EthernetClient &c)
+{
+	const uint8_t *data;
+	size_t n, total = 0;
+
+	while ((n = c.peekSegment(&data)) > 0)
+		total += c.consume(n);
+
+	return total;
+}
+
+/* Waits for the next connection of srv, giving up after timeout ms */
+static EthernetClient accept(EthernetServer &srv, uint32_t timeout)
+{
+	uint32_t start = millis();
+
+	for (;;) {
+		host_service();
+		EthernetClient c = srv.available();
+		if (c || millis() - start > timeout)
+			return c;
+	}
+}
+
+static void printConfig()
+{
+	printf("LWIP_PROFILE %d: TCP_MSS %d, TCP_WND %d, TCP_SND_BUF %d, "
+	       "PBUF_POOL %d x %d, MEM_SIZE %d, RX/TX descriptors %d/%d\n",
+	       LWIP_PROFILE, TCP_MSS, TCP_WND, TCP_SND_BUF, PBUF_POOL_SIZE,
+	       PBUF_POOL_BUFSIZE, MEM_SIZE, NUM_RX_DESCRIPTORS,
+	       NUM_TX_DESCRIPTORS);
+}
+
+static void connectionRate(EthernetServer &srv)
+{
+	uint32_t start = millis(), elapsed;
+	uint32_t done = 0, failed = 0;
+
+	do {
+		EthernetClient c;
+
+		if (!c.connectAsync(localAddr, CONNECT_PORT)) {
+			failed++;
+			host_service();
+		} else {
+			while (c.connecting())
+				host_service();
+
+			EthernetClient s = accept(srv, 1000);
+			if (c.connected() && s) {
+				done++;
+				s.stop();
+			} else {
+				failed++;
+			}
+			c.stop();
+		}
+		elapsed = millis() - start;
+	} while (elapsed < testMillis);
+
+	printf("  connect/accept/close: %8.0f connections/s (%u failed, %u accepted)\n",
+	       done * 1000.0 / elapsed, failed, srv.acceptedConnections());
+}
+
+/* Sends from c to the sink for testMillis, without ever blocking in
+ * write(): only what fits into the send buffer is handed over */
+static void throughput(EthernetServer &srv, bool zeroCopy)
+{
+	EthernetClient c;
+
+	if (!c.connect(localAddr, SINK_PORT)) {
+		printf("  connect to the sink failed\n");
+		return;
+	}
+	EthernetClient s = accept(srv, 1000);
+
+	uint32_t start = millis(), elapsed;
+	uint64_t received = 0;
+	uint64_t t0 = host_micros();
+
+	do {
+		size_t room = c.availableForWrite();
+
+		if (zeroCopy) {
+			if (room >= TCP_MSS)
+				c.writeStatic(pattern, TCP_MSS);
+		} else if (room > 0) {
+			c.write(scratch, room < 1024 ? room : 1024);
+		}
+		host_service();
+		received += drain(s);
+		elapsed = millis() - start;
+	} while (elapsed < testMillis);
+
+	printf("  %-22s %8.1f Mbit/s\n", zeroCopy ? "writeStatic():" : "write():",
+	       received * 8.0 / (host_micros() - t0));
+
+	c.stop();
+	s.stop();
+	/* Let the closing handshake finish before the next test */
+	delay(10);
+}
+
+static void latency(EthernetServer &srv)
+{
+	EthernetClient c;
+
+	if (!c.connect(localAddr, PINGPONG_PORT)) {
+		printf("  connect to the echo server failed\n");
+		return;
+	}
+	EthernetClient s = accept(srv, 1000);
+
+	uint32_t start = millis();
+	uint64_t total = 0, worst = 0;
+	uint32_t rounds = 0;
+
+	while (millis() - start < testMillis) {
+		uint64_t t0 = host_micros();
+
+		c.write('p');
+		while (!s.available())
+			host_service();
+		s.write(s.read());
+		while (!c.available())
+			host_service();
+		c.read();
+
+		uint64_t rtt = host_micros() - t0;
+		total += rtt;
+		if (rtt > worst)
+			worst = rtt;
+		rounds++;
+	}
+
+	printf("  1 byte round trip:     %8.1f us mean, %llu us worst, %u rounds\n",
+	       rounds ? (double)total / rounds : 0.0,
+	       (unsigned long long)worst, rounds);
+
+	c.stop();
+	s.stop();
+	delay(10);
+}
+
+/* Discard on SINK_PORT and echo on ECHO_PORT for the Linux side of a TAP */
+static void serveTap()
+{
+	EthernetServer sink(SINK_PORT);
+	EthernetServer echo(ECHO_PORT);
+	uint32_t lastReport = millis();
+	uint64_t received = 0;
+
+	sink.begin();
+	echo.begin();
+	printf("serving sink on %d and echo on %d at ", SINK_PORT, ECHO_PORT);
+	localAddr.printTo(out);
+	printf("\n");
+
+	for (;;) {
+		host_service();
+
+		EthernetClient s = sink.available();
+		if (s)
+			received += drain(s);
+
+		EthernetClient e = echo.available();
+		if (e) {
+			int n = e.read(scratch, sizeof(scratch));
+			if (n > 0)
+				e.write(scratch, n);
+		}
+
+		if (millis() - lastReport >= 1000) {
+			if (received)
+				printf("sink: %.1f Mbit/s\n",
+				       received * 8.0 / 1000.0 / (millis() - lastReport));
+			received = 0;
+			lastReport = millis();
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1) {
+		ip_addr_t addr;
+
+		if (!ipaddr_aton(argv[1], &addr)) {
+			fprintf(stderr, "usage: %s [local IP] [seconds per test]\n", argv[0]);
+			return 1;
+		}
+		localAddr = IPAddress(addr.addr);
+	}
+	if (argc > 2)
+		testMillis = atoi(argv[2]) * 1000;
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	for (size_t i = 0; i < sizeof(pattern); i++)
+		pattern[i] = i;
+	memcpy(scratch, pattern, sizeof(pattern));
+
+	Ethernet.begin(localAddr);
+	printConfig();
+
+	if (getenv("ENERGIA_TAP")) {
+		serveTap();
+		return 0;
+	}
+
+	EthernetServer connectSrv(CONNECT_PORT);
+	EthernetServer sinkSrv(SINK_PORT);
+	EthernetServer pingSrv(PINGPONG_PORT);
+
+	connectSrv.begin();
+	sinkSrv.begin();
+	pingSrv.begin();
+
+	connectionRate(connectSrv);
+	throughput(sinkSrv, false);
+	throughput(sinkSrv, true);
+	latency(pingSrv);
+
+	Ethernet.stats().printTo(out);
+	printf("\n");
+	fflush(stdout);
+
+	return 0;
+}
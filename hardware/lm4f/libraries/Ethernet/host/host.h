@@ -0,0 +1,43 @@
+/*
+ * host.h - Linux host build of the Ethernet library.
+ *
+ * lwIP, the library classes and the sketch run in one thread. Where the
+ * target takes the SysTick and Ethernet interrupts, the host runs
+ * host_service(): from delay() and wherever the program calls it, e.g.
+ * once per loop().
+ *
+ * The network interface is an in-process loopback wire by default, every
+ * frame sent comes back as received so the stack talks to itself. With
+ * ENERGIA_TAP=<name> in the environment it is that Linux TAP device.
+ */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <stdint.h>
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct netif;
+
+/* Runs the SysTick callbacks that are due and passes the received
+ * frames up the stack, does nothing inside a critical section */
+extern void host_service(void);
+extern uint32_t host_millis(void);
+extern uint64_t host_micros(void);
+/* Opens the TAP device pcName non-blocking, -1 on failure */
+extern int host_tap_open(const char *pcName);
+
+/* lwIP side, see lwiplib_host.c and hostif.c */
+extern void lwIPHostPoll(void);
+extern int sys_arch_protected(void);
+extern err_t hostif_init(struct netif *psNetif);
+extern int hostif_poll(struct netif *psNetif, uint32_t ui32MaxFrames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_H__ */
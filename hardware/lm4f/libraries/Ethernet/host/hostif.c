@@ -0,0 +1,295 @@
+/*
+ * hostif.c - Ethernet interface for the Linux host build, in place of
+ * utility/tiva-tm4c129.c.
+ *
+ * Without ENERGIA_TAP the wire is a ring of frames in memory and every
+ * frame sent is received again, so a client and a server at the local
+ * address exercise ARP, IP and TCP in both directions. With
+ * ENERGIA_TAP=<name> frames go to and come from that Linux TAP device.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/stats.h"
+#include "lwip/ip.h"
+#include "netif/etharp.h"
+#include "netif/tivaif.h"
+#include "arch/lwiplib.h"
+#include "host.h"
+
+/* Frames the loopback wire holds before it drops them like a full RX ring */
+#ifndef HOSTIF_WIRE_FRAMES
+#define HOSTIF_WIRE_FRAMES 256
+#endif
+
+#define HOSTIF_FRAME_MAX 1518
+
+typedef struct {
+    uint16_t ui16Len;
+    uint8_t pui8Data[HOSTIF_FRAME_MAX];
+} tHostFrame;
+
+static tHostFrame *g_psWire;
+static uint32_t g_ui32WireHead;
+static uint32_t g_ui32WireCount;
+static uint32_t g_ui32WireMax;
+static int g_iTapFd = -1;
+static tTivaIFStats g_sStats;
+
+static uint32_t
+hostif_sum(const uint8_t *pui8Data, uint32_t ui32Len, uint32_t ui32Sum)
+{
+    uint32_t i;
+
+    for(i = 0; i + 1 < ui32Len; i += 2)
+    {
+        ui32Sum += (pui8Data[i] << 8) | pui8Data[i + 1];
+    }
+    if(ui32Len & 1)
+    {
+        ui32Sum += pui8Data[ui32Len - 1] << 8;
+    }
+
+    return(ui32Sum);
+}
+
+static void
+hostif_put_sum(uint8_t *pui8Field, uint32_t ui32Sum)
+{
+    while(ui32Sum >> 16)
+    {
+        ui32Sum = (ui32Sum & 0xFFFF) + (ui32Sum >> 16);
+    }
+    ui32Sum = ~ui32Sum & 0xFFFF;
+    pui8Field[0] = ui32Sum >> 8;
+    pui8Field[1] = ui32Sum & 0xFF;
+}
+
+/* Inserts the IP, ICMP, UDP and TCP checksums that lwIP leaves to the
+ * EMAC, see CHECKSUM_GEN_* in lwipopts.h */
+static void
+hostif_checksum(uint8_t *pui8Frame, uint16_t ui16Len)
+{
+    uint8_t *pui8IP = pui8Frame + SIZEOF_ETH_HDR;
+    uint8_t *pui8L4;
+    uint32_t ui32HdrLen, ui32L4Len, ui32Sum;
+    uint8_t *pui8Field;
+
+    if(ui16Len < SIZEOF_ETH_HDR + 20 || pui8Frame[12] != 0x08 ||
+       pui8Frame[13] != 0x00)
+    {
+        return;
+    }
+
+    ui32HdrLen = (pui8IP[0] & 0x0F) * 4;
+    ui32L4Len = ((pui8IP[2] << 8) | pui8IP[3]) - ui32HdrLen;
+    if(SIZEOF_ETH_HDR + ui32HdrLen + ui32L4Len > ui16Len)
+    {
+        return;
+    }
+
+    pui8IP[10] = pui8IP[11] = 0;
+    hostif_put_sum(pui8IP + 10, hostif_sum(pui8IP, ui32HdrLen, 0));
+
+    /* Fragments after the first do not carry the transport header */
+    if(((pui8IP[6] & 0x1F) | pui8IP[7]) != 0)
+    {
+        return;
+    }
+
+    pui8L4 = pui8IP + ui32HdrLen;
+    switch(pui8IP[9])
+    {
+        case IP_PROTO_ICMP:
+            pui8Field = pui8L4 + 2;
+            pui8Field[0] = pui8Field[1] = 0;
+            hostif_put_sum(pui8Field, hostif_sum(pui8L4, ui32L4Len, 0));
+            return;
+
+        case IP_PROTO_TCP:
+            pui8Field = pui8L4 + 16;
+            break;
+
+        case IP_PROTO_UDP:
+            pui8Field = pui8L4 + 6;
+            break;
+
+        default:
+            return;
+    }
+
+    /* Pseudo header of the source and destination address */
+    pui8Field[0] = pui8Field[1] = 0;
+    ui32Sum = hostif_sum(pui8IP + 12, 8, pui8IP[9] + ui32L4Len);
+    hostif_put_sum(pui8Field, hostif_sum(pui8L4, ui32L4Len, ui32Sum));
+    if(pui8IP[9] == IP_PROTO_UDP && !pui8Field[0] && !pui8Field[1])
+    {
+        pui8Field[0] = pui8Field[1] = 0xFF;
+    }
+}
+
+static err_t
+hostif_transmit(struct netif *psNetif, struct pbuf *p)
+{
+    uint8_t pui8Frame[HOSTIF_FRAME_MAX];
+    uint16_t ui16Len;
+    tHostFrame *psFrame;
+
+    if(p->tot_len > HOSTIF_FRAME_MAX)
+    {
+        LINK_STATS_INC(link.lenerr);
+        return(ERR_BUF);
+    }
+
+    if(g_iTapFd >= 0)
+    {
+        ui16Len = pbuf_copy_partial(p, pui8Frame, p->tot_len, 0);
+        hostif_checksum(pui8Frame, ui16Len);
+        if(write(g_iTapFd, pui8Frame, ui16Len) != ui16Len)
+        {
+            g_sStats.ui32TXNoDescCount++;
+            LINK_STATS_INC(link.drop);
+            return(ERR_IF);
+        }
+        LINK_STATS_INC(link.xmit);
+        return(ERR_OK);
+    }
+
+    /* The frame is received again once the stack is polled */
+    if(g_ui32WireCount == HOSTIF_WIRE_FRAMES)
+    {
+        g_sStats.ui32RXMissedCount++;
+        LINK_STATS_INC(link.drop);
+        return(ERR_OK);
+    }
+
+    psFrame = &g_psWire[(g_ui32WireHead + g_ui32WireCount) %
+                        HOSTIF_WIRE_FRAMES];
+    psFrame->ui16Len = pbuf_copy_partial(p, psFrame->pui8Data, p->tot_len, 0);
+    g_ui32WireCount++;
+    if(g_ui32WireCount > g_ui32WireMax)
+    {
+        g_ui32WireMax = g_ui32WireCount;
+    }
+    LINK_STATS_INC(link.xmit);
+
+    return(ERR_OK);
+}
+
+err_t
+hostif_init(struct netif *psNetif)
+{
+    const char *pcTap;
+
+    pcTap = getenv("ENERGIA_TAP");
+    if(pcTap && *pcTap)
+    {
+        g_iTapFd = host_tap_open(pcTap);
+        if(g_iTapFd < 0)
+        {
+            LWIP_PLATFORM_DIAG(("hostif: cannot open TAP %s: %s\n", pcTap,
+                                strerror(errno)));
+            return(ERR_IF);
+        }
+    }
+    else if(!g_psWire)
+    {
+        g_psWire = (tHostFrame *)calloc(HOSTIF_WIRE_FRAMES,
+                                        sizeof(tHostFrame));
+        if(!g_psWire)
+        {
+            return(ERR_MEM);
+        }
+    }
+
+    psNetif->name[0] = 'h';
+    psNetif->name[1] = 'o';
+    psNetif->output = etharp_output;
+    psNetif->linkoutput = hostif_transmit;
+    psNetif->mtu = 1500;
+    psNetif->hwaddr_len = ETHARP_HWADDR_LEN;
+    lwIPLocalMACGet(psNetif->hwaddr);
+    psNetif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP |
+                     NETIF_FLAG_LINK_UP | NETIF_FLAG_IGMP;
+
+    return(ERR_OK);
+}
+
+/* Copies a received frame into a pbuf chain from the pool, as the EMAC
+ * DMA does, and hands it to the stack */
+static void
+hostif_input(struct netif *psNetif, const uint8_t *pui8Data, uint16_t ui16Len)
+{
+    struct pbuf *p;
+
+    p = pbuf_alloc(PBUF_RAW, ui16Len, PBUF_POOL);
+    if(!p)
+    {
+        g_sStats.ui32RXNoBufCount++;
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        return;
+    }
+
+    pbuf_take(p, pui8Data, ui16Len);
+    LINK_STATS_INC(link.recv);
+
+    if(ethernet_input(p, psNetif) != ERR_OK)
+    {
+        pbuf_free(p);
+    }
+}
+
+int
+hostif_poll(struct netif *psNetif, uint32_t ui32MaxFrames)
+{
+    uint8_t pui8Frame[HOSTIF_FRAME_MAX];
+    tHostFrame *psFrame;
+    ssize_t iLen;
+    int iCount = 0;
+
+    while((uint32_t)iCount < ui32MaxFrames)
+    {
+        if(g_iTapFd >= 0)
+        {
+            iLen = read(g_iTapFd, pui8Frame, sizeof(pui8Frame));
+            if(iLen <= 0)
+            {
+                break;
+            }
+            hostif_input(psNetif, pui8Frame, (uint16_t)iLen);
+        }
+        else
+        {
+            /* Frames the stack sends in response join the end of the wire
+             * and are picked up by this or the next poll */
+            if(!g_ui32WireCount)
+            {
+                break;
+            }
+            psFrame = &g_psWire[g_ui32WireHead];
+            g_ui32WireHead = (g_ui32WireHead + 1) % HOSTIF_WIRE_FRAMES;
+            g_ui32WireCount--;
+            hostif_input(psNetif, psFrame->pui8Data, psFrame->ui16Len);
+        }
+        iCount++;
+    }
+
+    return(iCount);
+}
+
+/* The loopback wire plays the part of both descriptor rings */
+void
+tivaif_stats(tTivaIFStats *psStats)
+{
+    *psStats = g_sStats;
+    psStats->ui32TXDescUsed = g_ui32WireCount;
+    psStats->ui32TXDescMax = g_ui32WireMax;
+    psStats->ui32RXDescReady = g_ui32WireCount;
+}
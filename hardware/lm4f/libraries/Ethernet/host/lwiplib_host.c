@@ -0,0 +1,304 @@
+/*
+ * lwiplib_host.c - the lwIP abstraction layer of arch/lwiplib.h for the
+ * Linux host build, in place of utility/lwiplib.c.
+ *
+ * The timers are serviced like on the target. The link is always up.
+ */
+
+#include <string.h>
+#include "arch/lwiplib.h"
+#include "lwip/init.h"
+#include "lwip/dhcp.h"
+#include "lwip/dns.h"
+#include "lwip/autoip.h"
+#include "lwip/ip_frag.h"
+#include "lwip/igmp.h"
+#include "netif/etharp.h"
+#include "host.h"
+
+static struct netif g_sNetIF;
+static uint8_t g_pui8MAC[6];
+
+uint32_t g_ui32LocalTimer = 0;
+static uint32_t g_ui32TCPTimer = 0;
+#if LWIP_ARP
+static uint32_t g_ui32ARPTimer = 0;
+#endif
+#if LWIP_AUTOIP
+static uint32_t g_ui32AutoIPTimer = 0;
+#endif
+#if LWIP_DHCP
+static uint32_t g_ui32DHCPCoarseTimer = 0;
+static uint32_t g_ui32DHCPFineTimer = 0;
+#endif
+#if IP_REASSEMBLY
+static uint32_t g_ui32IPReassemblyTimer = 0;
+#endif
+#if LWIP_IGMP
+static uint32_t g_ui32IGMPTimer = 0;
+#endif
+#if LWIP_DNS
+static uint32_t g_ui32DNSTimer = 0;
+#endif
+
+static uint32_t g_ui32IPMode = IPADDR_USE_STATIC;
+static bool g_bInitialized = false;
+
+/* Frames passed up per poll, 0 for all that are waiting */
+static uint32_t g_ui32DeferredFrames = 0;
+
+static void
+lwIPServiceTimers(void)
+{
+#if LWIP_ARP
+    if((g_ui32LocalTimer - g_ui32ARPTimer) >= ARP_TMR_INTERVAL)
+    {
+        g_ui32ARPTimer = g_ui32LocalTimer;
+        etharp_tmr();
+    }
+#endif
+
+    if((g_ui32LocalTimer - g_ui32TCPTimer) >= TCP_TMR_INTERVAL)
+    {
+        g_ui32TCPTimer = g_ui32LocalTimer;
+        tcp_tmr();
+    }
+
+#if LWIP_AUTOIP
+    if((g_ui32LocalTimer - g_ui32AutoIPTimer) >= AUTOIP_TMR_INTERVAL)
+    {
+        g_ui32AutoIPTimer = g_ui32LocalTimer;
+        autoip_tmr();
+    }
+#endif
+
+#if LWIP_DHCP
+    if((g_ui32LocalTimer - g_ui32DHCPCoarseTimer) >= DHCP_COARSE_TIMER_MSECS)
+    {
+        g_ui32DHCPCoarseTimer = g_ui32LocalTimer;
+        dhcp_coarse_tmr();
+    }
+
+    if((g_ui32LocalTimer - g_ui32DHCPFineTimer) >= DHCP_FINE_TIMER_MSECS)
+    {
+        g_ui32DHCPFineTimer = g_ui32LocalTimer;
+        dhcp_fine_tmr();
+    }
+#endif
+
+#if IP_REASSEMBLY
+    if((g_ui32LocalTimer - g_ui32IPReassemblyTimer) >= IP_TMR_INTERVAL)
+    {
+        g_ui32IPReassemblyTimer = g_ui32LocalTimer;
+        ip_reass_tmr();
+    }
+#endif
+
+#if LWIP_IGMP
+    if((g_ui32LocalTimer - g_ui32IGMPTimer) >= IGMP_TMR_INTERVAL)
+    {
+        g_ui32IGMPTimer = g_ui32LocalTimer;
+        igmp_tmr();
+    }
+#endif
+
+#if LWIP_DNS
+    if((g_ui32LocalTimer - g_ui32DNSTimer) >= DNS_TMR_INTERVAL)
+    {
+        g_ui32DNSTimer = g_ui32LocalTimer;
+        dns_tmr();
+    }
+#endif
+}
+
+static void
+lwIPStartAddressing(uint32_t ui32IPAddr, uint32_t ui32NetMask,
+                    uint32_t ui32GWAddr)
+{
+    struct ip_addr ip_addr;
+    struct ip_addr net_mask;
+    struct ip_addr gw_addr;
+
+    if(g_ui32IPMode == IPADDR_USE_STATIC)
+    {
+        ip_addr.addr = htonl(ui32IPAddr);
+        net_mask.addr = htonl(ui32NetMask);
+        gw_addr.addr = htonl(ui32GWAddr);
+    }
+    else
+    {
+        ip_addr.addr = 0;
+        net_mask.addr = 0;
+        gw_addr.addr = 0;
+    }
+    netif_set_addr(&g_sNetIF, &ip_addr, &net_mask, &gw_addr);
+
+    /* lwIP does not answer ARP for its own address, the loopback wire
+     * needs the local address resolved to reach it */
+    if(g_ui32IPMode == IPADDR_USE_STATIC)
+    {
+        etharp_add_static_entry(&ip_addr,
+                                (struct eth_addr *)g_sNetIF.hwaddr);
+    }
+
+#if LWIP_DHCP
+    if(g_ui32IPMode == IPADDR_USE_DHCP)
+    {
+        dhcp_start(&g_sNetIF);
+    }
+#endif
+#if LWIP_AUTOIP
+    if(g_ui32IPMode == IPADDR_USE_AUTOIP)
+    {
+        autoip_start(&g_sNetIF);
+    }
+#endif
+}
+
+void
+lwIPInit(uint32_t ui32SysClkHz, const uint8_t *pui8MAC, uint32_t ui32IPAddr,
+         uint32_t ui32NetMask, uint32_t ui32GWAddr, uint32_t ui32IPMode)
+{
+    struct ip_addr any;
+
+    memcpy(g_pui8MAC, pui8MAC, 6);
+    g_ui32IPMode = ui32IPMode;
+
+    lwip_init();
+
+    any.addr = 0;
+    netif_add(&g_sNetIF, &any, &any, &any, NULL, hostif_init, ip_input);
+    netif_set_default(&g_sNetIF);
+    netif_set_up(&g_sNetIF);
+
+    lwIPStartAddressing(ui32IPAddr, ui32NetMask, ui32GWAddr);
+    g_bInitialized = true;
+}
+
+void
+lwIPTimerCallbackRegister(tHardwareTimerHandler pfnTimerFunc)
+{
+    /* There is no IEEE-1588 timer on the host */
+}
+
+void
+lwIPTimer(uint32_t ui32TimeMS)
+{
+    g_ui32LocalTimer += ui32TimeMS;
+
+    if(g_bInitialized)
+    {
+        lwIPServiceTimers();
+    }
+}
+
+void
+lwIPHostPoll(void)
+{
+    if(g_bInitialized)
+    {
+        hostif_poll(&g_sNetIF, g_ui32DeferredFrames ? g_ui32DeferredFrames :
+                                                      0xFFFFFFFF);
+    }
+}
+
+void
+lwIPEthernetIntHandler(void)
+{
+    lwIPHostPoll();
+}
+
+/* On the host this only limits the frames passed up per poll */
+void
+lwIPDeferredProcessingSet(uint32_t ui32MaxFrames)
+{
+    g_ui32DeferredFrames = ui32MaxFrames;
+}
+
+uint32_t
+lwIPDeferredProcessingGet(void)
+{
+    return(g_ui32DeferredFrames);
+}
+
+uint32_t
+lwIPLocalIPAddrGet(void)
+{
+    return((uint32_t)g_sNetIF.ip_addr.addr);
+}
+
+bool lwIPLinkActive(void)
+{
+    return g_bInitialized;
+}
+
+uint32_t
+lwIPLocalNetMaskGet(void)
+{
+    return((uint32_t)g_sNetIF.netmask.addr);
+}
+
+uint32_t
+lwIPLocalGWAddrGet(void)
+{
+    return((uint32_t)g_sNetIF.gw.addr);
+}
+
+void lwIPDNSAddrSet(uint32_t dns_server)
+{
+    dns_setserver(0, (ip_addr_t *)&dns_server);
+}
+
+uint32_t
+lwIPDNSAddrGet(void)
+{
+    ip_addr_t addr = dns_getserver(0);
+    return addr.addr;
+}
+
+void
+lwIPLocalMACGet(uint8_t *pui8MAC)
+{
+    memcpy(pui8MAC, g_pui8MAC, 6);
+}
+
+void
+lwIPNetifSetStatusCallback(netif_status_callback_fn status_callback)
+{
+    netif_set_status_callback(&g_sNetIF, status_callback);
+}
+
+void
+lwIPNetworkConfigChange(uint32_t ui32IPAddr, uint32_t ui32NetMask,
+                        uint32_t ui32GWAddr, uint32_t ui32IPMode)
+{
+#if LWIP_DHCP
+    if(g_ui32IPMode == IPADDR_USE_DHCP)
+    {
+        dhcp_stop(&g_sNetIF);
+    }
+#endif
+#if LWIP_AUTOIP
+    if(g_ui32IPMode == IPADDR_USE_AUTOIP)
+    {
+        autoip_stop(&g_sNetIF);
+    }
+#endif
+
+    g_ui32IPMode = ui32IPMode;
+    lwIPStartAddressing(ui32IPAddr, ui32NetMask, ui32GWAddr);
+}
+
+bool lwIPDHCPWaitLeaseValid()
+{
+    unsigned long _timeout = 60000;
+    uint32_t startTime = host_millis();
+
+    while(g_sNetIF.dhcp->state != DHCP_BOUND) {
+        host_service();
+        if(((host_millis() - startTime) > _timeout))
+            return false;
+    };
+
+    return true;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file - sys_arch.c
+ * System Architecture support routines for the Linux host build.
+ *
+ * The host build runs lwIP from the same thread as the sketch, at the
+ * points where the target would take the Ethernet interrupt, see
+ * host_service().  Protecting a critical section therefore only has to
+ * keep host_service() from running lwIP inside it.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "host.h"
+
+static volatile int g_iProtectDepth;
+
+u32_t
+sys_now(void)
+{
+    return(host_millis());
+}
+
+sys_prot_t
+sys_arch_protect(void)
+{
+    return((sys_prot_t)g_iProtectDepth++);
+}
+
+void
+sys_arch_unprotect(sys_prot_t lev)
+{
+    g_iProtectDepth = lev;
+}
+
+int
+sys_arch_protected(void)
+{
+    return(g_iProtectDepth != 0);
+}
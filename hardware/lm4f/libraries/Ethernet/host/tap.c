@@ -0,0 +1,35 @@
+/*
+ * tap.c - opens a Linux TAP device for hostif.c. Built without the
+ * library include paths, whose sys/socket.h would hide the system one.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+int
+host_tap_open(const char *pcName)
+{
+    struct ifreq sReq;
+    int iFd;
+
+    iFd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+    if(iFd < 0)
+    {
+        return(-1);
+    }
+
+    memset(&sReq, 0, sizeof(sReq));
+    sReq.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(sReq.ifr_name, pcName, IFNAMSIZ - 1);
+    if(ioctl(iFd, TUNSETIFF, &sReq) < 0)
+    {
+        close(iFd);
+        return(-1);
+    }
+
+    return(iFd);
+}
@@ -0,0 +1,91 @@
+/*
+ * wiring_host.c - the timing part of the Energia core for the Linux
+ * host build of the Ethernet library.
+ */
+
+#include <time.h>
+#include "Energia.h"
+#include "host.h"
+
+static void (*SysTickCbFuncs[8])(uint32_t ui32TimeMS);
+static uint32_t ui32Ticked;
+
+uint64_t host_micros(void)
+{
+	static struct timespec start;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (start.tv_sec == 0 && start.tv_nsec == 0)
+		start = now;
+
+	return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000 +
+		(now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+uint32_t host_millis(void)
+{
+	return host_micros() / 1000;
+}
+
+unsigned long micros()
+{
+	return host_micros();
+}
+
+unsigned long millis()
+{
+	return host_millis();
+}
+
+void delay(uint32_t milliseconds)
+{
+	uint32_t start = host_millis();
+
+	while (host_millis() - start < milliseconds)
+		host_service();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	uint64_t start = host_micros();
+
+	while (host_micros() - start < us)
+		;
+}
+
+void registerSysTickCb(void (*userFunc)(uint32_t))
+{
+	uint8_t i;
+	for (i=0; i<8; i++) {
+		if(!SysTickCbFuncs[i]) {
+			SysTickCbFuncs[i] = userFunc;
+			break;
+		}
+	}
+}
+
+void host_service(void)
+{
+	static int busy;
+	uint32_t now = host_millis();
+	uint8_t i;
+
+	/* Interrupts do not nest into themselves or into a critical section */
+	if (busy || sys_arch_protected())
+		return;
+	busy = 1;
+
+	/* One SysTick per millisecond that passed */
+	while (ui32Ticked != now) {
+		ui32Ticked++;
+		for (i=0; i<8; i++) {
+			if (SysTickCbFuncs[i])
+				SysTickCbFuncs[i](1);
+		}
+	}
+
+	lwIPHostPoll();
+
+	busy = 0;
+}
@@ -47,8 +47,71 @@
 #define EMAC_PHY_CONFIG (EMAC_PHY_TYPE_INTERNAL | EMAC_PHY_INT_MDIX_EN |      \
                          EMAC_PHY_AN_100B_T_FULL_DUPLEX)
 #define PHY_PHYS_ADDR      0
-#define NUM_TX_DESCRIPTORS 24
-#define NUM_RX_DESCRIPTORS 8
+
+//*****************************************************************************
+//
+// ---------- Network profiles ----------
+//
+// LWIP_PROFILE sizes the descriptor rings, the memory pools and the TCP
+// windows.  It must be defined for the whole build, a #define in the sketch
+// does not reach the library sources.  With Energia add it to the board in
+// boards.txt, e.g.
+//
+//   lptm4c1294ncpdt.build.extra_flags=-DLWIP_PROFILE=3
+//
+// LWIP_PROFILE_LOW_MEMORY  about 26 KB, a few connections at low rates.
+// LWIP_PROFILE_BALANCED    about 92 KB, the default.
+// LWIP_PROFILE_THROUGHPUT  about 165 KB, windows sized for 100 Mbit/s at
+//                          LAN round trip times on the 256 KB TM4C129 parts.
+//
+//*****************************************************************************
+#define LWIP_PROFILE_LOW_MEMORY         1
+#define LWIP_PROFILE_BALANCED           2
+#define LWIP_PROFILE_THROUGHPUT         3
+
+#ifndef LWIP_PROFILE
+#define LWIP_PROFILE                    LWIP_PROFILE_BALANCED
+#endif
+
+#if LWIP_PROFILE == LWIP_PROFILE_LOW_MEMORY
+#define NUM_TX_DESCRIPTORS              8
+#define NUM_RX_DESCRIPTORS              4
+#define MEM_SIZE                        (16 * 1024)
+#define MEMP_NUM_PBUF                   16
+#define MEMP_NUM_TCP_PCB                5
+#define MEMP_NUM_TCP_SEG                16
+#define PBUF_POOL_SIZE                  16
+#define PBUF_POOL_BUFSIZE               512
+#define TCP_WND                         (2 * TCP_MSS)
+#define TCP_SND_BUF                     (2 * TCP_MSS)
+#elif LWIP_PROFILE == LWIP_PROFILE_BALANCED
+#define NUM_TX_DESCRIPTORS              24
+#define NUM_RX_DESCRIPTORS              8
+#define MEM_SIZE                        (64 * 1024)
+#define MEMP_NUM_PBUF                   48
+#define MEMP_NUM_TCP_PCB                16
+#define MEMP_NUM_TCP_SEG                32
+#define PBUF_POOL_SIZE                  48
+#define PBUF_POOL_BUFSIZE               512
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_SND_BUF                     (6 * TCP_MSS)
+#elif LWIP_PROFILE == LWIP_PROFILE_THROUGHPUT
+// A full sized frame fits one pool pbuf.  The pool holds the receive
+// window on top of the pbufs parked in the receive descriptors, the heap
+// holds the send buffer.
+#define NUM_TX_DESCRIPTORS              32
+#define NUM_RX_DESCRIPTORS              16
+#define MEM_SIZE                        (96 * 1024)
+#define MEMP_NUM_PBUF                   64
+#define MEMP_NUM_TCP_PCB                16
+#define MEMP_NUM_TCP_SEG                96
+#define PBUF_POOL_SIZE                  40
+#define PBUF_POOL_BUFSIZE               1536
+#define TCP_WND                         (24 * TCP_MSS)
+#define TCP_SND_BUF                     (24 * TCP_MSS)
+#else
+#error "LWIP_PROFILE must be one of the LWIP_PROFILE_* values"
+#endif
 
 //*****************************************************************************
 //
@@ -67,7 +130,7 @@
 //*****************************************************************************
 //#define MEM_LIBC_MALLOC                 0
 #define MEM_ALIGNMENT                   4           // default is 1
-#define MEM_SIZE                        (64 * 1024)  // default is 1600
+//#define MEM_SIZE                        1600        // see network profiles
 //#define MEMP_OVERFLOW_CHECK             0
 //#define MEMP_SANITY_CHECK               0
 //#define MEM_USE_POOLS                   0
@@ -78,12 +141,12 @@
 // ---------- Internal Memory Pool Sizes ----------
 //
 //*****************************************************************************
-#define MEMP_NUM_PBUF                     48    // Default 16
+//#define MEMP_NUM_PBUF                   16          // see network profiles
 //#define MEMP_NUM_RAW_PCB                4
 //#define MEMP_NUM_UDP_PCB                4
-#define MEMP_NUM_TCP_PCB                  16    // Default 5
+//#define MEMP_NUM_TCP_PCB                5           // see network profiles
 //#define MEMP_NUM_TCP_PCB_LISTEN         8
-#define MEMP_NUM_TCP_SEG                  32  // Default 16
+//#define MEMP_NUM_TCP_SEG                16          // see network profiles
 //#define MEMP_NUM_REASSDATA              5
 //#define MEMP_NUM_ARP_QUEUE              30
 //#define MEMP_NUM_IGMP_GROUP             8
@@ -92,7 +155,7 @@
 //#define MEMP_NUM_NETCONN                4
 //#define MEMP_NUM_TCPIP_MSG_API          8
 //#define MEMP_NUM_TCPIP_MSG_INPKT        8
-#define PBUF_POOL_SIZE                    48    // Default 16
+//#define PBUF_POOL_SIZE                  16          // see network profiles
 
 //*****************************************************************************
 //
@@ -154,8 +217,16 @@
 //
 // ---------- PTPD options ----------
 //
+// EthernetPTP needs the EMAC timestamps. They add a timestamp to every pbuf
+// and have the EMAC timestamp every frame sent, so they are off unless the
+// build defines LWIP_PTPD the way it does LWIP_PROFILE, e.g.
+//
+//   lptm4c1294ncpdt.build.extra_flags=-DLWIP_PTPD=1
+//
 //*****************************************************************************
-//#define LWIP_PTPD                       0
+#ifndef LWIP_PTPD
+#define LWIP_PTPD                       0
+#endif
 
 //*****************************************************************************
 //
@@ -183,7 +254,11 @@
 // ---------- IGMP options ----------
 //
 //*****************************************************************************
-//#define LWIP_IGMP                       0
+#define LWIP_IGMP                       1           // default is 0
+
+// Spreads the IGMP membership reports over their response time
+#include <stdlib.h>
+#define LWIP_RAND()                     ((u32_t)rand())
 
 //*****************************************************************************
 //
@@ -214,17 +289,16 @@
 //*****************************************************************************
 #define LWIP_TCP                        1
 //#define TCP_TTL                         (IP_DEFAULT_TTL)
-#define TCP_WND                         4096   // default is 2048
+//#define TCP_WND                         2048        // see network profiles
 //#define TCP_MAXRTX                      12
 //#define TCP_SYNMAXRTX                   6
 //#define TCP_QUEUE_OOSEQ                 1
-#define TCP_MSS                        1500        // default is 128
+#define TCP_MSS                         1460        // default is 128
 //#define TCP_CALCULATE_EFF_SEND_MSS      1
-#define TCP_SND_BUF                     (6 * TCP_MSS)
-                                                    // default is 256
+//#define TCP_SND_BUF                     256         // see network profiles
 //#define TCP_SND_QUEUELEN                (4 * (TCP_SND_BUF/TCP_MSS))
 //#define TCP_SNDLOWAT                    (TCP_SND_BUF/2)
-//#define TCP_LISTEN_BACKLOG              0
+#define TCP_LISTEN_BACKLOG              1    // default is 0
 //#define TCP_DEFAULT_LISTEN_BACKLOG      0xff
 
 //*****************************************************************************
@@ -241,8 +315,8 @@
 //
 //*****************************************************************************
 #define PBUF_LINK_HLEN                  16          // default is 14
-#define PBUF_POOL_BUFSIZE               512
-                                                    // default is LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
+//#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
+                                                    // see network profiles
 #define ETH_PAD_SIZE                    0           // default is 0
 
 //*****************************************************************************
@@ -313,7 +387,8 @@
 // ---------- Statistics options ----------
 //
 //*****************************************************************************
-//#define LWIP_STATS                      1
+#define LWIP_STATS                      1           // read by Ethernet.stats()
+#define LWIP_STATS_LARGE                1           // 32 bit counters
 //#define LWIP_STATS_DISPLAY              0
 //#define LINK_STATS                      1
 //#define ETHARP_STATS                    (LWIP_ARP)
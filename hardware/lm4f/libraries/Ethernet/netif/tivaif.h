@@ -45,9 +45,35 @@
 #ifndef __TIVAIF_H__
 #define __TIVAIF_H__
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set on a sent pbuf once time_s and time_ns hold its transmit timestamp. */
+#if LWIP_PTPD
+#define PBUF_FLAG_TX_TIMESTAMP 0x80U
+#endif
+
+/**
+ * Driver counters and descriptor ring occupancy, see tivaif_stats().
+ */
+typedef struct {
+    uint32_t ui32TXDescUsed;       /* descriptors queued for the DMA now */
+    uint32_t ui32TXDescMax;        /* high-water mark of ui32TXDescUsed */
+    uint32_t ui32TXNoDescCount;    /* frames rejected for a full ring */
+    uint32_t ui32TXCopyCount;      /* frames copied to a bounce buffer */
+    uint32_t ui32RXDescReady;      /* received descriptors not yet processed */
+    uint32_t ui32RXNoBufCount;     /* descriptors left without a pbuf */
+    uint32_t ui32RXOverflowCount;  /* frames lost to a receive FIFO overflow */
+    uint32_t ui32RXMissedCount;    /* frames missed for lack of descriptors */
+} tTivaIFStats;
+
 extern int tivaif_input(struct netif *psNetif);
 extern err_t tivaif_init(struct netif *psNetif);
 extern void tivaif_interrupt(struct netif *netif, uint32_t ui32Status);
+extern int tivaif_process(struct netif *netif, uint32_t ui32Status,
+                          uint32_t ui32MaxFrames);
+extern void tivaif_stats(tTivaIFStats *psStats);
 
 #if NETIF_DEBUG
 void tivaif_debug_print(struct pbuf *psBuf);
@@ -55,4 +81,8 @@ void tivaif_debug_print(struct pbuf *psBuf);
 #define tivaif_debug_print(psBuf)
 #endif /* NETIF_DEBUG */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // __TIVAIF_H__
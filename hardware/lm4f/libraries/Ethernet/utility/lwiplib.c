@@ -82,6 +82,7 @@ extern void lwIPHostTimerHandler(void);
 #include "inc/hw_emac.h"
 #include "driverlib/debug.h"
 #include "driverlib/emac.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
 #include "driverlib/sysctl.h"
@@ -259,6 +260,28 @@ static uint32_t g_ui32NetMask;
 //*****************************************************************************
 static uint32_t g_ui32GWAddr;
 
+//*****************************************************************************
+//
+// The number of received frames the deferred handler passes up the stack per
+// pass, or 0 if the stack runs in the Ethernet interrupt handler.  The
+// interrupt status collected for the deferred handler.
+//
+//*****************************************************************************
+#if NO_SYS
+static volatile uint32_t g_ui32DeferredFrames = 0;
+static volatile uint32_t g_ui32DeferredStatus = 0;
+#endif
+
+//*****************************************************************************
+//
+// The Ethernet MAC interrupt sources that are serviced by lwIP.
+//
+//*****************************************************************************
+#define EMAC_INT_LWIP           (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |       \
+                                 EMAC_INT_TX_STOPPED |                        \
+                                 EMAC_INT_RX_NO_BUFFER |                      \
+                                 EMAC_INT_RX_STOPPED | EMAC_INT_PHY)
+
 //*****************************************************************************
 //
 // The stack size for the interrupt task.
@@ -843,9 +866,132 @@ lwIPTimer(uint32_t ui32TimeMS)
     // be placed inside the Ethernet interrupt handler ensuring that all calls
     // into lwIP are coming from the same context, preventing any reentrancy
     // issues.  Putting all the lwIP calls in the Ethernet interrupt handler
-    // avoids the use of mutexes to avoid re-entering lwIP.
+    // avoids the use of mutexes to avoid re-entering lwIP.  With deferred
+    // processing the PendSV handler takes the place of the Ethernet interrupt
+    // handler.
+    //
+    if(g_ui32DeferredFrames)
+    {
+        HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+    }
+    else
+    {
+        HWREG(NVIC_SW_TRIG) |= INT_EMAC0 - 16;
+    }
+}
+#endif
+
+//*****************************************************************************
+//
+//! Handles the deferred lwIP processing.
+//!
+//! With deferred processing enabled this PendSV handler does the work that
+//! lwIPEthernetIntHandler() otherwise does in the Ethernet interrupt.  It runs
+//! at the lowest interrupt priority and passes at most the configured number
+//! of received frames up the stack per pass.  Frames left over stay in the
+//! receive descriptors with the Ethernet interrupt sources disabled until the
+//! next lwIP timer tick, so a flood of packets cannot starve the main program.
+//!
+//! \return None.
+//
+//*****************************************************************************
+#if NO_SYS
+static void
+lwIPDeferredIntHandler(void)
+{
+    uint32_t ui32Status;
+
+    //
+    // Take the interrupt status collected by the Ethernet interrupt handler.
+    //
+    ui32Status = __sync_fetch_and_and(&g_ui32DeferredStatus, 0);
+
+    if(ui32Status)
+    {
+        if(tivaif_process(&g_sNetIF, ui32Status, g_ui32DeferredFrames))
+        {
+            //
+            // The frame budget is used up, the rest waits for the next tick.
+            //
+            __sync_fetch_and_or(&g_ui32DeferredStatus,
+                                EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT);
+        }
+        else
+        {
+            //
+            // All caught up, let the Ethernet interrupt report new work.
+            //
+            MAP_EMACIntEnable(EMAC0_BASE, EMAC_INT_LWIP);
+        }
+    }
+
     //
-    HWREG(NVIC_SW_TRIG) |= INT_EMAC0 - 16;
+    // Service the lwIP timers.
+    //
+    lwIPServiceTimers();
+}
+#endif
+
+//*****************************************************************************
+//
+//! Moves the lwIP processing out of the Ethernet interrupt handler.
+//!
+//! \param ui32MaxFrames is the number of received frames passed up the stack
+//! per pass of the deferred handler, or 0 to process in the Ethernet
+//! interrupt handler.
+//!
+//! By default the receive path, the TCP/IP input and the lwIP timers all run
+//! in the Ethernet interrupt handler.  With deferred processing the Ethernet
+//! interrupt handler only collects the interrupt status and pends PendSV.  The
+//! PendSV handler runs at \b LWIP_DEFERRED_PRIORITY, below every other
+//! interrupt, and lwIP critical sections hold off only that priority instead
+//! of disabling all interrupts.
+//!
+//! This function should be called from the main program, preferably before
+//! lwIPInit().
+//!
+//! \return None.
+//
+//*****************************************************************************
+#if NO_SYS
+void
+lwIPDeferredProcessingSet(uint32_t ui32MaxFrames)
+{
+    if(ui32MaxFrames && !g_ui32DeferredFrames)
+    {
+        //
+        // Install the deferred handler at the lowest priority.
+        //
+        MAP_IntPrioritySet(FAULT_PENDSV, LWIP_DEFERRED_PRIORITY);
+        IntRegister(FAULT_PENDSV, lwIPDeferredIntHandler);
+    }
+
+    g_ui32DeferredFrames = ui32MaxFrames;
+
+    //
+    // Whichever handler is now in charge picks up the work left pending.
+    //
+    if(ui32MaxFrames)
+    {
+        HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+    }
+    else if(MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EMAC0))
+    {
+        MAP_EMACIntEnable(EMAC0_BASE, EMAC_INT_LWIP);
+        HWREG(NVIC_SW_TRIG) |= INT_EMAC0 - 16;
+    }
+}
+
+//*****************************************************************************
+//
+//! Returns the number of received frames the deferred handler passes up the
+//! stack per pass, or 0 if lwIP runs in the Ethernet interrupt handler.
+//
+//*****************************************************************************
+uint32_t
+lwIPDeferredProcessingGet(void)
+{
+    return(g_ui32DeferredFrames);
 }
 #endif
 
@@ -911,6 +1057,26 @@ lwIPEthernetIntHandler(void)
     // The handling of the interrupt is different based on the use of a RTOS.
     //
 #if NO_SYS
+    if(g_ui32DeferredFrames)
+    {
+        //
+        // Deferred processing.  Leave the work to the PendSV handler and hold
+        // off further Ethernet interrupts until it has caught up.
+        //
+        if(ui32Status & EMAC_INT_LWIP)
+        {
+            g_ui32DeferredStatus |= ui32Status;
+            MAP_EMACIntDisable(EMAC0_BASE, EMAC_INT_LWIP);
+            HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+        }
+        return;
+    }
+
+    //
+    // Pick up any work the deferred handler left when it was turned off.
+    //
+    ui32Status |= __sync_fetch_and_and(&g_ui32DeferredStatus, 0);
+
     //
     // No RTOS is being used.  If a transmit/receive interrupt was active,
     // run the low-level interrupt handler.
@@ -935,10 +1101,7 @@ lwIPEthernetIntHandler(void)
     // handled, they are not asserted.  Once they are handled by the Ethernet
     // interrupt task, it will re-enable the interrupts.
     //
-    MAP_EMACIntDisable(EMAC0_BASE, (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |
-                                    EMAC_INT_TX_STOPPED |
-                                    EMAC_INT_RX_NO_BUFFER |
-                                    EMAC_INT_RX_STOPPED | EMAC_INT_PHY));
+    MAP_EMACIntDisable(EMAC0_BASE, EMAC_INT_LWIP);
 
     //
     // Potentially task switch as a result of the above queue write.
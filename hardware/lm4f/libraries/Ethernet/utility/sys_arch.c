@@ -53,6 +53,10 @@
 #include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
+#include "arch/lwiplib.h"
+
+/* Marks a protection level saved from BASEPRI rather than PRIMASK. */
+#define SYS_PROT_BASEPRI 2
 
 /**
  * This global is defined in lwiplib.c and contains a count of the number of
@@ -76,11 +80,24 @@ sys_now(void)
  * indicating the interrupt enable state when the function entered. This
  * value must be passed back on the matching call to sys_arch_unprotect().
  *
+ * With deferred processing lwIP only runs in the PendSV handler and the main
+ * program, so only interrupts at LWIP_DEFERRED_PRIORITY are held off.
+ *
  * @return the interrupt level when the function was entered.
  */
 sys_prot_t
 sys_arch_protect(void)
 {
+  uint32_t ui32Mask;
+
+  if(lwIPDeferredProcessingGet()) {
+    ui32Mask = MAP_IntPriorityMaskGet();
+    if(!ui32Mask || (ui32Mask > LWIP_DEFERRED_PRIORITY)) {
+      MAP_IntPriorityMaskSet(LWIP_DEFERRED_PRIORITY);
+    }
+    return((sys_prot_t)(ui32Mask | SYS_PROT_BASEPRI));
+  }
+
   return((sys_prot_t)MAP_IntMasterDisable());
 }
 
@@ -96,6 +113,12 @@ sys_arch_protect(void)
 void
 sys_arch_unprotect(sys_prot_t lev)
 {
+  /* Restore the priority mask saved in deferred mode. */
+  if(lev & SYS_PROT_BASEPRI) {
+    MAP_IntPriorityMaskSet(lev & ~SYS_PROT_BASEPRI);
+    return;
+  }
+
   /* Only turn interrupts back on if they were originally on when the matching
      sys_arch_protect() call was made. */
   if(!(lev & 1)) {
@@ -145,12 +145,15 @@ typedef struct {
     uint32_t ui32RXPacketErrCount;
     uint32_t ui32RXPacketCBErrCount;
     uint32_t ui32RXNoBufCount;
+    uint32_t ui32TXDescMax;
+    uint32_t ui32RXOverflowCount;
+    uint32_t ui32RXMissedCount;
 }
 tDriverStats;
 
 tDriverStats g_sDriverStats;
 
-#ifdef DEBUG
+#if defined(DEBUG) || LWIP_STATS
 /**
  * Note: This rather weird construction where we invoke the macro with the
  * name of the field minus its Hungarian prefix is a workaround for a problem
@@ -316,7 +319,8 @@ tivaif_hwinit(struct netif *psNetif)
   psNetif->mtu = 1500;
 
   /* Device capabilities */
-  psNetif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+  psNetif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP |
+                   NETIF_FLAG_IGMP;
 
   /* Initialize the DMA descriptors. */
   InitDMADescriptors();
@@ -356,7 +360,7 @@ tivaif_hwinit(struct netif *psNetif)
   EMACTimestampConfigSet(EMAC0_BASE, (EMAC_TS_ALL_RX_FRAMES |
                          EMAC_TS_DIGITAL_ROLLOVER |
                          EMAC_TS_PROCESS_IPV4_UDP | EMAC_TS_ALL |
-                         EMAC_TS_PTP_VERSION_1 | EMAC_TS_UPDATE_FINE),
+                         EMAC_TS_PTP_VERSION_2 | EMAC_TS_UPDATE_FINE),
                          (1000000000 / (25000000 / 2)));
   EMACTimestampAddendSet(EMAC0_BASE, 0x80000000);
   EMACTimestampEnable(EMAC0_BASE);
@@ -414,83 +418,30 @@ tivaif_trace_pbuf(const char *pcTitle, struct pbuf *p)
 #endif
 
 /**
- * This function is used to check whether a passed pbuf contains only buffers
- * resident in regions of memory that the Ethernet MAC can access.  If any
- * buffers in the chain are outside a directly-DMAable section of memory,
- * the pbuf is copied to SRAM and a different pointer returned.  If all
- * buffers are safe, the pbuf reference count is incremented and the original
- * pointer returned.
+ * This function returns the number of bytes in a pbuf chain that are held in
+ * buffers outside the memory the Ethernet MAC can DMA from, such as constant
+ * data in flash.  tivaif_transmit copies only these buffers to SRAM, every
+ * other buffer in the chain is sent in place from its own descriptor.
  */
-static struct pbuf *
-tivaif_check_pbuf(struct pbuf *p)
+static uint32_t
+tivaif_unsafe_len(struct pbuf *p)
 {
-    struct pbuf *pBuf;
-    err_t Err;
-
-    pBuf = p;
+    uint32_t ui32Len = 0;
 
 #ifdef DEBUG
     tivaif_trace_pbuf("Original:", p);
 #endif
 
     /* Walk the list of buffers in the pbuf checking each. */
-    do
+    for(; p; p = p->next)
     {
-        /* Does this pbuf's payload reside in memory that the Ethernet DMA
-         * can access?
-         */
-        if(!PTR_SAFE_FOR_EMAC_DMA(pBuf->payload))
+        if(!PTR_SAFE_FOR_EMAC_DMA(p->payload))
         {
-            /* This buffer is outside the DMA-able memory space so we need
-             * to copy the pbuf.
-             */
-            pBuf = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_POOL);
-
-            /* If we got a new pbuf... */
-            if(pBuf)
-            {
-                /* ...copy the old pbuf into the new one. */
-                Err = pbuf_copy(pBuf, p);
-
-                /* If we failed to copy the pbuf, free the newly allocated one
-                 * and make sure we return a NULL to show a problem.
-                 */
-                if(Err != ERR_OK)
-                {
-                    DRIVER_STATS_INC(TXCopyFailCount);
-                    pbuf_free(pBuf);
-                    pBuf = NULL;
-                }
-                else
-                {
-#ifdef DEBUG
-                    tivaif_trace_pbuf("Copied:", pBuf);
-#endif
-                    DRIVER_STATS_INC(TXCopyCount);
-
-                    /* Reduce the reference count on the original pbuf since
-                     * we're not going to hold on to it after returning from
-                     * tivaif_transmit.  Note that we already bumped
-                     * the reference count at the top of tivaif_transmit.
-                     */
-                    pbuf_free(p);
-                }
-            }
-
-            /* Send back the new pbuf pointer or NULL if an error occurred. */
-            return(pBuf);
+            ui32Len += p->len;
         }
-
-        /* Move on to the next buffer in the queue */
-        pBuf = pBuf->next;
     }
-    while(pBuf);
 
-    /**
-     * If we get here, the passed pbuf can be safely used without needing to
-     * be copied.
-     */
-    return(p);
+    return(ui32Len);
 }
 
 /**
@@ -508,8 +459,9 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
 {
   tStellarisIF *pIF;
   tDescriptor *pDesc;
-  struct pbuf *pBuf;
-  uint32_t ui32NumChained, ui32NumDescs;
+  struct pbuf *pBuf, *pOwner, *pBounce;
+  uint32_t ui32NumChained, ui32NumDescs, ui32Unsafe;
+  uint8_t *pui8Bounce;
   bool bFirst;
   SYS_ARCH_DECL_PROTECT(lev);
 
@@ -531,21 +483,6 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
    */
   pbuf_ref(p);
 
-  /**
-   * Determine whether all buffers passed are within SRAM and, if not, copy
-   * the pbuf into SRAM-resident buffers so that the Ethernet DMA can access
-   * the data.
-   */
-  p = tivaif_check_pbuf(p);
-
-  /* Make sure we still have a valid buffer (it may have been copied) */
-  if(!p)
-  {
-      LINK_STATS_INC(link.memerr);
-      SYS_ARCH_UNPROTECT(lev);
-      return(ERR_MEM);
-  }
-
   /* Get our state data from the netif structure we were passed. */
   pIF = (tStellarisIF *)psNetif->state;
 
@@ -585,6 +522,41 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
       return (ERR_MEM);
   }
 
+  /* Track how full the ring gets for tivaif_stats(). */
+  if(NUM_TX_DESCRIPTORS - ui32NumDescs + ui32NumChained >
+     g_sDriverStats.ui32TXDescMax)
+  {
+      g_sDriverStats.ui32TXDescMax = NUM_TX_DESCRIPTORS - ui32NumDescs +
+                                     ui32NumChained;
+  }
+
+  /**
+   * Buffers outside SRAM, typically constant data sent with
+   * TCP_WRITE_FLAG_COPY cleared, are copied into a single SRAM bounce
+   * buffer.  The bounce buffer takes over our reference to the packet so
+   * freeing it when the last descriptor completes releases both.
+   */
+  pOwner = p;
+  pBounce = NULL;
+  pui8Bounce = NULL;
+  ui32Unsafe = tivaif_unsafe_len(p);
+  if(ui32Unsafe)
+  {
+      pBounce = pbuf_alloc(PBUF_RAW, ui32Unsafe, PBUF_RAM);
+      if(!pBounce)
+      {
+          pbuf_free(p);
+          LINK_STATS_INC(link.memerr);
+          DRIVER_STATS_INC(TXCopyFailCount);
+          SYS_ARCH_UNPROTECT(lev);
+          return (ERR_MEM);
+      }
+      DRIVER_STATS_INC(TXCopyCount);
+      pui8Bounce = (uint8_t *)pBounce->payload;
+      pbuf_cat(pBounce, p);
+      pOwner = pBounce;
+  }
+
   /* Tag the first descriptor as the start of the packet. */
   bFirst = true;
   pDesc->Desc.ui32CtrlStatus = DES0_TX_CTRL_FIRST_SEG;
@@ -599,13 +571,26 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
 
       /* Fill in the buffer pointer and length */
       pDesc->Desc.ui32Count = (uint32_t)pBuf->len;
-      pDesc->Desc.pvBuffer1 = pBuf->payload;
+      if(PTR_SAFE_FOR_EMAC_DMA(pBuf->payload))
+      {
+          pDesc->Desc.pvBuffer1 = pBuf->payload;
+      }
+      else
+      {
+          MEMCPY(pui8Bounce, pBuf->payload, pBuf->len);
+          pDesc->Desc.pvBuffer1 = pui8Bounce;
+          pui8Bounce += pBuf->len;
+      }
 
       /* Tag the first descriptor as the start of the packet. */
       if(bFirst)
       {
           bFirst = false;
           pDesc->Desc.ui32CtrlStatus = DES0_TX_CTRL_FIRST_SEG;
+#if LWIP_PTPD
+          /* Have the MAC timestamp every frame it sends. */
+          pDesc->Desc.ui32CtrlStatus |= DES0_TX_CTRL_ENABLE_TS;
+#endif
       }
       else
       {
@@ -633,8 +618,8 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
           pDesc->Desc.ui32CtrlStatus |= (DES0_TX_CTRL_LAST_SEG |
                                          DES0_TX_CTRL_INTERRUPT);
 
-          /* Tag the descriptor with the original pbuf pointer. */
-          pDesc->pBuf = p;
+          /* Tag the descriptor with the pbuf that owns the packet. */
+          pDesc->pBuf = pOwner;
       }
       else
       {
@@ -644,7 +629,7 @@ tivaif_transmit(struct netif *psNetif, struct pbuf *p)
            * pbuf when processing the last descriptor used to transmit its
            * chain.
            */
-          pDesc->pBuf = (struct pbuf *)((uint32_t)p + 1);
+          pDesc->pBuf = (struct pbuf *)((uint32_t)pOwner + 1);
       }
 
       DRIVER_STATS_INC(TXBufQueuedCount);
@@ -702,6 +687,25 @@ tivaif_process_transmit(tStellarisIF *pIF)
             /* Yes - free it if it's not marked as an intermediate pbuf */
             if(!((uint32_t)(pDescList->pDescriptors[pDescList->ui32Read].pBuf) & 1))
             {
+#if LWIP_PTPD
+                /* Hand the transmit timestamp back to whoever still holds
+                 * a reference to the packet. */
+                if(pDescList->pDescriptors[pDescList->ui32Read].Desc.ui32CtrlStatus &
+                   DES0_TX_STAT_TS_CAPTURED)
+                {
+                    struct pbuf *pTS;
+
+                    for(pTS = pDescList->pDescriptors[pDescList->ui32Read].pBuf;
+                        pTS; pTS = pTS->next)
+                    {
+                        pTS->time_s =
+                          pDescList->pDescriptors[pDescList->ui32Read].Desc.ui32IEEE1588TimeHi;
+                        pTS->time_ns =
+                          pDescList->pDescriptors[pDescList->ui32Read].Desc.ui32IEEE1588TimeLo;
+                        pTS->flags |= PBUF_FLAG_TX_TIMESTAMP;
+                    }
+                }
+#endif
                 pbuf_free(pDescList->pDescriptors[pDescList->ui32Read].pBuf);
                 DRIVER_STATS_INC(TXBufFreedCount);
             }
@@ -728,18 +732,22 @@ tivaif_process_transmit(tStellarisIF *pIF)
  * timestamp of the packet will be placed into the pbuf structure if PTPD is
  * enabled.
  *
- * This function is called only from the Ethernet interrupt handler.
+ * This function is called only from the Ethernet interrupt handler or the
+ * deferred lwIP handler.
  *
  * @param psNetif the lwip network interface structure for this ethernetif
- * @return None.
+ * @param ui32MaxFrames the number of frames to pass up before returning
+ * @return 1 if frames were left in the descriptor list, else 0.
  */
-static void
-tivaif_receive(struct netif *psNetif)
+static int
+tivaif_receive(struct netif *psNetif, uint32_t ui32MaxFrames)
 {
   tDescriptorList *pDescList;
   tStellarisIF *pIF;
   struct pbuf *pBuf;
   uint32_t ui32DescEnd;
+  uint32_t ui32Frames = 0;
+  int iMore = 0;
 
   /* Get a pointer to our state data */
   pIF = (tStellarisIF *)(psNetif->state);
@@ -758,6 +766,15 @@ tivaif_receive(struct netif *psNetif)
   /* Step through the descriptors that are marked for CPU attention. */
   while(pDescList->ui32Read != ui32DescEnd)
   {
+      /* Stop at a frame boundary once the frame budget is used up. */
+      if(!pBuf && (ui32Frames >= ui32MaxFrames))
+      {
+          iMore = pDescList->pDescriptors[pDescList->ui32Read].pBuf &&
+                  !(pDescList->pDescriptors[pDescList->ui32Read].Desc.ui32CtrlStatus &
+                    DES0_RX_CTRL_OWN);
+          break;
+      }
+
       /* Does the current descriptor have a buffer attached to it? */
       if(pDescList->pDescriptors[pDescList->ui32Read].pBuf)
       {
@@ -856,6 +873,7 @@ tivaif_receive(struct netif *psNetif)
 			   * to link the next buffer to it.
 			   */
 			  pBuf = NULL;
+			  ui32Frames++;
           }
       }
 
@@ -907,6 +925,8 @@ tivaif_receive(struct netif *psNetif)
 	  pbuf_free(pBuf);
 	  pBuf = NULL;
   }
+
+  return(iMore);
 }
 
 /**
@@ -1060,6 +1080,22 @@ tivaif_process_phy_interrupt(struct netif *psNetif)
  */
 void
 tivaif_interrupt(struct netif *psNetif, uint32_t ui32Status)
+{
+  tivaif_process(psNetif, ui32Status, 0xFFFFFFFF);
+}
+
+/**
+ * Process the tx and rx work flagged by the interrupt status ui32Status,
+ * passing at most ui32MaxFrames received frames up the stack.
+ *
+ * This is the body of tivaif_interrupt() and is also called from the deferred
+ * lwIP handler, which hands in the status collected by the interrupt.
+ *
+ * @return 1 if received frames were left for a later call, else 0.
+ */
+int
+tivaif_process(struct netif *psNetif, uint32_t ui32Status,
+               uint32_t ui32MaxFrames)
 {
   tStellarisIF *tivaif;
 
@@ -1100,8 +1136,60 @@ tivaif_interrupt(struct netif *psNetif, uint32_t ui32Status)
   if(ui32Status & (EMAC_INT_RECEIVE | EMAC_INT_RX_NO_BUFFER |
      EMAC_INT_RX_STOPPED))
   {
-      tivaif_receive(psNetif);
+      return(tivaif_receive(psNetif, ui32MaxFrames));
   }
+
+  return(0);
+}
+
+/**
+ * Fills in the driver counters and a snapshot of the descriptor rings.
+ * The MAC's missed frame counters clear when read so they are collected
+ * into the driver counters here.
+ *
+ * @param psStats the structure to fill in
+ */
+void
+tivaif_stats(tTivaIFStats *psStats)
+{
+  uint32_t ui32Loop, ui32MFBOC;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+
+  ui32MFBOC = HWREG(EMAC0_BASE + EMAC_O_MFBOC);
+  g_sDriverStats.ui32RXOverflowCount += (ui32MFBOC & EMAC_MFBOC_OVFFRMCNT_M) >>
+                                        EMAC_MFBOC_OVFFRMCNT_S;
+  g_sDriverStats.ui32RXMissedCount += (ui32MFBOC & EMAC_MFBOC_MISFRMCNT_M) >>
+                                      EMAC_MFBOC_MISFRMCNT_S;
+
+  psStats->ui32TXDescUsed = 0;
+  for(ui32Loop = 0; ui32Loop < NUM_TX_DESCRIPTORS; ui32Loop++)
+  {
+      if(g_pTxDescriptors[ui32Loop].pBuf)
+      {
+          psStats->ui32TXDescUsed++;
+      }
+  }
+
+  psStats->ui32RXDescReady = 0;
+  for(ui32Loop = 0; ui32Loop < NUM_RX_DESCRIPTORS; ui32Loop++)
+  {
+      if(g_pRxDescriptors[ui32Loop].pBuf &&
+         !(g_pRxDescriptors[ui32Loop].Desc.ui32CtrlStatus & DES0_RX_CTRL_OWN))
+      {
+          psStats->ui32RXDescReady++;
+      }
+  }
+
+  psStats->ui32TXDescMax = g_sDriverStats.ui32TXDescMax;
+  psStats->ui32TXNoDescCount = g_sDriverStats.ui32TXNoDescCount;
+  psStats->ui32TXCopyCount = g_sDriverStats.ui32TXCopyCount;
+  psStats->ui32RXNoBufCount = g_sDriverStats.ui32RXNoBufCount;
+  psStats->ui32RXOverflowCount = g_sDriverStats.ui32RXOverflowCount;
+  psStats->ui32RXMissedCount = g_sDriverStats.ui32RXMissedCount;
+
+  SYS_ARCH_UNPROTECT(lev);
 }
 
 #if NETIF_DEBUG
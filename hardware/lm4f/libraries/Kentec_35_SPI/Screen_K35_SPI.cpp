@@ -392,8 +392,7 @@ void Screen_K35_SPI::_writeData88(uint8_t dataHigh8, uint8_t dataLow8)
     HWREG(LCD_DC_BASE + GPIO_O_DATA + (LCD_DC_PIN << 2)) = LCD_DC_PIN;          // HIGH = data
     HWREG(LCD_CS_BASE + GPIO_O_DATA + (LCD_CS_PIN << 2)) = 0;                   // CS LOW
     
-    SPI.transfer(dataHigh8);
-    SPI.transfer(dataLow8);
+    SPI.transfer16(((uint16_t)dataHigh8 << 8) | dataLow8);
     
     HWREG(LCD_CS_BASE + GPIO_O_DATA + (LCD_CS_PIN << 2)) = LCD_CS_PIN;          // CS HIGH
     
@@ -402,8 +401,7 @@ void Screen_K35_SPI::_writeData88(uint8_t dataHigh8, uint8_t dataLow8)
     digitalWrite(_pinScreenDataCommand, HIGH);                                  // HIGH = data
     digitalWrite(_pinScreenChipSelect, LOW);                                    // CS LOW
     
-    SPI.transfer(dataHigh8);
-    SPI.transfer(dataLow8);
+    SPI.transfer16(((uint16_t)dataHigh8 << 8) | dataLow8);
     
     digitalWrite(_pinScreenChipSelect, HIGH);                                   // CS HIGH
     
@@ -516,9 +514,36 @@ void Screen_K35_SPI::_fastFill(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y
     uint8_t lowColour  = lowByte(colour);
     
     _setWindow(x1, y1, x2, y2);
-    for (uint32_t t=(uint32_t)(y2-y1+1)*(x2-x1+1); t>0; t--) {
-        _writeData88(highColour, lowColour);
+
+    // Stream the pixels in blocks with CS held low, the GRAM address
+    // auto-increments after each pixel
+    uint8_t block[64];
+    for (uint8_t i=0; i<sizeof(block); i+=2) {
+        block[i]   = highColour;
+        block[i+1] = lowColour;
+    }
+
+    uint32_t t = (uint32_t)(y2-y1+1)*(x2-x1+1)*2;
+
+#if (GPIO_MODE == GPIO_FAST)
+    HWREG(LCD_DC_BASE + GPIO_O_DATA + (LCD_DC_PIN << 2)) = LCD_DC_PIN;          // HIGH = data
+    HWREG(LCD_CS_BASE + GPIO_O_DATA + (LCD_CS_PIN << 2)) = 0;                   // CS LOW
+#else
+    digitalWrite(_pinScreenDataCommand, HIGH);                                  // HIGH = data
+    digitalWrite(_pinScreenChipSelect, LOW);                                    // CS LOW
+#endif
+
+    while (t > 0) {
+        uint32_t n = (t < sizeof(block)) ? t : sizeof(block);
+        SPI.write(block, n);
+        t -= n;
     }
+
+#if (GPIO_MODE == GPIO_FAST)
+    HWREG(LCD_CS_BASE + GPIO_O_DATA + (LCD_CS_PIN << 2)) = LCD_CS_PIN;          // CS HIGH
+#else
+    digitalWrite(_pinScreenChipSelect, HIGH);                                   // CS HIGH
+#endif
 }
 
 // Touch
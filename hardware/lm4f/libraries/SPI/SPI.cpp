@@ -8,11 +8,17 @@
  * published by the Free Software Foundation.
  */
 
+#include <malloc.h>
 #include "wiring_private.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_ssi.h"
+#include "inc/hw_gpio.h"
 #include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/cpu.h"
 #include "driverlib/ssi.h"
+#include "driverlib/udma.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/pin_map.h"
@@ -21,6 +27,9 @@
 
 #define SSIBASE g_ulSSIBase[SSIModule]
 #define NOT_ACTIVE 0xA
+#define SSI_FIFO_DEPTH 8
+#define SSI_HW_MODULES 4
+#define UDMA_MAX_ITEMS 1024
 
 /* variants
    stellarpad - LM4F120H5QR, TM4C123GH6PM, aka TARGET_IS_BLIZZARD_RB1
@@ -148,11 +157,15 @@ static const unsigned long g_ulSSIPins[] = {
 SPIClass::SPIClass(void) {
 	SSIModule = NOT_ACTIVE;
 	SSIBitOrder = MSBFIRST;
+	interruptMode = 0;
+	interruptCount = 0;
 }
 
 SPIClass::SPIClass(uint8_t module) {
 	SSIModule = module;
 	SSIBitOrder = MSBFIRST;
+	interruptMode = 0;
+	interruptCount = 0;
 }
   
 void SPIClass::begin() {
@@ -229,25 +242,450 @@ void SPIClass::setClockDivider(uint8_t divider){
   HWREG(SSIBASE + SSI_O_CPSR) = divider;
 }
 
+// Bit reverse every byte of a word: rbit reverses all 32 bits and the byte
+// order, rev puts the bytes back in place
+static inline uint32_t reverseBytes(uint32_t word) {
+	asm("rbit %0, %1" : "=r" (word) : "r" (word));
+	asm("rev %0, %1" : "=r" (word) : "r" (word));
+	return word;
+}
+
+static inline uint8_t reverseByte(uint8_t data) {
+	uint32_t word = data;
+	asm("rbit %0, %1" : "=r" (word) : "r" (word));
+	return word >> 24;
+}
+
+// LSBFIRST buffers are reversed in place once, a word at a time
+static void reverseBuffer(uint8_t *buf, size_t count) {
+	while (count && ((uint32_t) buf & 3)) {
+		*buf = reverseByte(*buf);
+		buf++;
+		count--;
+	}
+	for (; count >= 4; count -= 4, buf += 4)
+		*(uint32_t *) buf = reverseBytes(*(uint32_t *) buf);
+	while (count--) {
+		*buf = reverseByte(*buf);
+		buf++;
+	}
+}
+
 uint8_t SPIClass::transfer(uint8_t data) {
 	unsigned long rxtxData;
 
 	rxtxData = data;
+	if(SSIBitOrder == LSBFIRST)
+		rxtxData = reverseByte(rxtxData);
+
+	HWREG(SSIBASE + SSI_O_DR) = rxtxData;
+	while(!(HWREG(SSIBASE + SSI_O_SR) & SSI_SR_RNE));
+	rxtxData = HWREG(SSIBASE + SSI_O_DR);
+
+	if(SSIBitOrder == LSBFIRST)
+		rxtxData = reverseByte(rxtxData);
+
+	return (uint8_t) rxtxData;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data) {
+	uint8_t buf[2];
+
 	if(SSIBitOrder == LSBFIRST) {
-		asm("rbit %0, %1" : "=r" (rxtxData) : "r" (rxtxData));	// reverse order of 32 bits 
-		asm("rev %0, %1" : "=r" (rxtxData) : "r" (rxtxData));	// reverse order of bytes to get original bits into lowest byte 
+		buf[0] = data;
+		buf[1] = data >> 8;
+		transfer(buf, 2);
+		return buf[0] | (buf[1] << 8);
 	}
-	ROM_SSIDataPut(SSIBASE, (uint8_t) rxtxData);
 
-	while(ROM_SSIBusy(SSIBASE));
+	buf[0] = data >> 8;
+	buf[1] = data;
+	transfer(buf, 2);
+	return (buf[0] << 8) | buf[1];
+}
 
-	ROM_SSIDataGet(SSIBASE, &rxtxData);
-	if(SSIBitOrder == LSBFIRST) {
-		asm("rbit %0, %1" : "=r" (rxtxData) : "r" (rxtxData));	// reverse order of 32 bits 
-		asm("rev %0, %1" : "=r" (rxtxData) : "r" (rxtxData));	// reverse order of bytes to get original bits into lowest byte 
+/*
+ * Exchange count bytes in place. The TX FIFO is kept filled while the
+ * RX FIFO is drained, with never more than the FIFO depth in flight so
+ * the receive side cannot overrun.
+ */
+void SPIClass::transfer(void *buf, size_t count) {
+	uint8_t *data = (uint8_t *) buf;
+	unsigned long base = SSIBASE;
+	size_t tx = 0, rx = 0;
+
+	if(count == 0) return;
+	if(SSIBitOrder == LSBFIRST) reverseBuffer(data, count);
+
+	while(rx < count) {
+		while(tx < count && tx - rx < SSI_FIFO_DEPTH
+				&& (HWREG(base + SSI_O_SR) & SSI_SR_TNF))
+			HWREG(base + SSI_O_DR) = data[tx++];
+		while(rx < tx && (HWREG(base + SSI_O_SR) & SSI_SR_RNE))
+			data[rx++] = HWREG(base + SSI_O_DR);
 	}
 
-	return (uint8_t) rxtxData;
+	if(SSIBitOrder == LSBFIRST) reverseBuffer(data, count);
+}
+
+/*
+ * Send count bytes and discard what comes back. The received bytes are
+ * dropped as they arrive, which leaves the RX FIFO empty for the next
+ * transfer().
+ */
+void SPIClass::write(const void *buf, size_t count) {
+	const uint8_t *data = (const uint8_t *) buf;
+	unsigned long base = SSIBASE;
+	unsigned long dummy;
+
+	while(count) {
+		if(HWREG(base + SSI_O_SR) & SSI_SR_TNF) {
+			HWREG(base + SSI_O_DR) = (SSIBitOrder == LSBFIRST) ?
+				reverseByte(*data) : *data;
+			data++;
+			count--;
+		}
+		while(HWREG(base + SSI_O_SR) & SSI_SR_RNE)
+			dummy = HWREG(base + SSI_O_DR);
+	}
+
+	while(HWREG(base + SSI_O_SR) & SSI_SR_BSY);
+	while(HWREG(base + SSI_O_SR) & SSI_SR_RNE)
+		dummy = HWREG(base + SSI_O_DR);
+	(void) dummy;
+}
+
+/*
+ * uDMA transfers. Each SSI module has a queue of pending transfers that
+ * is worked through from the SSI interrupt, which the uDMA raises when
+ * the RX channel completes. Both channels always run: a missing TX
+ * buffer sends 0xFF and a missing RX buffer is received into a dummy
+ * byte, so completion always means the last bit has been clocked in.
+ * Transfers larger than the uDMA limit are sent in 1024 byte chunks.
+ */
+typedef struct {
+	const uint8_t *tx;
+	uint8_t *rx;
+	size_t count;
+	SPIAsyncCallback callback;
+	void *context;
+	uint8_t csPin;
+} spiAsyncTransfer_t;
+
+typedef struct {
+	spiAsyncTransfer_t queue[SPI_ASYNC_QUEUE];
+	volatile uint8_t head;
+	volatile uint8_t count;
+	volatile uint8_t busy;
+	uint8_t ready;
+	size_t done;
+	size_t chunk;
+} spiAsync_t;
+
+static spiAsync_t spiAsync[SSI_HW_MODULES];
+
+static const uint8_t spiFill = 0xFF;
+static uint8_t spiDummy;
+
+static const unsigned long g_ulSSIDMAChannel[SSI_HW_MODULES][2] = {
+	{UDMA_CH10_SSI0RX, UDMA_CH11_SSI0TX},
+	{UDMA_CH24_SSI1RX, UDMA_CH25_SSI1TX},
+	{UDMA_CH12_SSI2RX, UDMA_CH13_SSI2TX},
+	{UDMA_CH14_SSI3RX, UDMA_CH15_SSI3TX}
+};
+
+static const unsigned long g_ulSSIInt[SSI_HW_MODULES] = {
+	INT_SSI0, INT_SSI1, INT_SSI2, INT_SSI3
+};
+
+static inline uint8_t ssiNumber(unsigned long base) {
+	return (base - SSI0_BASE) >> 12;
+}
+
+static void spiAsyncChunk(uint8_t n) {
+	spiAsync_t *a = &spiAsync[n];
+	spiAsyncTransfer_t *t = &a->queue[a->head];
+	unsigned long base = SSI0_BASE + (n << 12);
+	unsigned long rxCh = g_ulSSIDMAChannel[n][0] & 0xff;
+	unsigned long txCh = g_ulSSIDMAChannel[n][1] & 0xff;
+	size_t chunk = t->count - a->done;
+
+	if(chunk > UDMA_MAX_ITEMS) chunk = UDMA_MAX_ITEMS;
+	a->chunk = chunk;
+
+	ROM_uDMAChannelControlSet(rxCh | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_NONE |
+		(t->rx ? UDMA_DST_INC_8 : UDMA_DST_INC_NONE) | UDMA_ARB_4);
+	ROM_uDMAChannelTransferSet(rxCh | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+		(void *)(base + SSI_O_DR), t->rx ? t->rx + a->done : &spiDummy, chunk);
+
+	ROM_uDMAChannelControlSet(txCh | UDMA_PRI_SELECT, UDMA_SIZE_8 |
+		(t->tx ? UDMA_SRC_INC_8 : UDMA_SRC_INC_NONE) | UDMA_DST_INC_NONE | UDMA_ARB_4);
+	ROM_uDMAChannelTransferSet(txCh | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+		t->tx ? (void *)(t->tx + a->done) : (void *)&spiFill,
+		(void *)(base + SSI_O_DR), chunk);
+
+	ROM_uDMAChannelEnable(rxCh);
+	ROM_uDMAChannelEnable(txCh);
+}
+
+static void spiAsyncStart(uint8_t n) {
+	spiAsync_t *a = &spiAsync[n];
+	unsigned long base = SSI0_BASE + (n << 12);
+
+	// Leftovers from FIFO transfers would shift the received data
+	while(HWREG(base + SSI_O_SR) & SSI_SR_RNE)
+		HWREG(base + SSI_O_DR);
+
+	a->busy = 1;
+	a->done = 0;
+	if(a->queue[a->head].csPin != SPI_NO_CS)
+		digitalWrite(a->queue[a->head].csPin, LOW);
+	spiAsyncChunk(n);
+}
+
+static void spiAsyncHandler(uint8_t n) {
+	spiAsync_t *a = &spiAsync[n];
+	spiAsyncTransfer_t *t = &a->queue[a->head];
+	unsigned long base = SSI0_BASE + (n << 12);
+	SPIAsyncCallback callback;
+	void *context;
+
+#if defined(__TM4C129XNCZAD__) || defined(__TM4C1294NCPDT__)
+	ROM_SSIIntClear(base, SSI_DMARX | SSI_DMATX);
+#endif
+
+	// The TX channel finishes first, wait for the last byte to come in
+	if(!a->busy || ROM_uDMAChannelIsEnabled(g_ulSSIDMAChannel[n][0] & 0xff))
+		return;
+
+	a->done += a->chunk;
+	if(a->done < t->count) {
+		spiAsyncChunk(n);
+		return;
+	}
+
+	if(t->csPin != SPI_NO_CS)
+		digitalWrite(t->csPin, HIGH);
+	callback = t->callback;
+	context = t->context;
+	a->head = (a->head + 1) % SPI_ASYNC_QUEUE;
+	a->count--;
+	a->busy = 0;
+
+	if(callback)
+		callback(context);
+
+	// The callback may have queued and started another transfer
+	if(!a->busy) {
+		if(a->count)
+			spiAsyncStart(n);
+		else
+			ROM_SSIDMADisable(base, SSI_DMA_RX | SSI_DMA_TX);
+	}
+}
+
+static void SPIAsync0IntHandler(void) { spiAsyncHandler(0); }
+static void SPIAsync1IntHandler(void) { spiAsyncHandler(1); }
+static void SPIAsync2IntHandler(void) { spiAsyncHandler(2); }
+static void SPIAsync3IntHandler(void) { spiAsyncHandler(3); }
+
+static void (* const spiAsyncIntHandler[SSI_HW_MODULES])(void) = {
+	SPIAsync0IntHandler, SPIAsync1IntHandler, SPIAsync2IntHandler, SPIAsync3IntHandler
+};
+
+/*
+ * With interrupts masked by PRIMASK, or by BASEPRI at or above the SSI
+ * interrupt's priority, the completion interrupt never runs. The blocking
+ * calls then run the handler themselves.
+ */
+static void spiAsyncPoll(uint8_t n) {
+	uint32_t basepri = CPUbasepriGet();
+
+	if(CPUprimask() || (basepri && basepri <= (uint32_t) ROM_IntPriorityGet(g_ulSSIInt[n])))
+		spiAsyncHandler(n);
+}
+
+static bool spiAsyncBegin(uint8_t n) {
+	unsigned long base = SSI0_BASE + (n << 12);
+	void *table;
+
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	ROM_uDMAEnable();
+	// The 1 KB control table is only allocated once a sketch uses the uDMA
+	if(ROM_uDMAControlBaseGet() == 0) {
+		table = memalign(1024, sizeof(tDMAControlTable) * 64);
+		if(table == 0)
+			return false;
+		memset(table, 0, sizeof(tDMAControlTable) * 64);
+		ROM_uDMAControlBaseSet(table);
+	}
+
+	uDMAChannelAssign(g_ulSSIDMAChannel[n][0]);
+	uDMAChannelAssign(g_ulSSIDMAChannel[n][1]);
+	ROM_uDMAChannelAttributeDisable(g_ulSSIDMAChannel[n][0] & 0xff, UDMA_ATTR_ALL);
+	ROM_uDMAChannelAttributeDisable(g_ulSSIDMAChannel[n][1] & 0xff, UDMA_ATTR_ALL);
+	// Reading has to keep up with the TX channel or the RX FIFO overruns
+	ROM_uDMAChannelAttributeEnable(g_ulSSIDMAChannel[n][0] & 0xff, UDMA_ATTR_HIGH_PRIORITY);
+
+	SSIIntRegister(base, spiAsyncIntHandler[n]);
+#if defined(__TM4C129XNCZAD__) || defined(__TM4C1294NCPDT__)
+	ROM_SSIIntEnable(base, SSI_DMARX);
+#endif
+	spiAsync[n].ready = 1;
+	return true;
+}
+
+bool SPIClass::transferAsync(const void *txBuf, void *rxBuf, size_t count,
+		SPIAsyncCallback callback, void *context, uint8_t csPin) {
+	uint8_t n = ssiNumber(SSIBASE);
+	spiAsync_t *a = &spiAsync[n];
+	spiAsyncTransfer_t *t;
+
+	// The uDMA cannot reverse bits, LSBFIRST stays with transfer()
+	if(count == 0 || SSIBitOrder == LSBFIRST || a->count == SPI_ASYNC_QUEUE)
+		return false;
+
+	if(!a->ready && !spiAsyncBegin(n))
+		return false;
+
+	ROM_IntDisable(g_ulSSIInt[n]);
+	t = &a->queue[(a->head + a->count) % SPI_ASYNC_QUEUE];
+	t->tx = (const uint8_t *) txBuf;
+	t->rx = (uint8_t *) rxBuf;
+	t->count = count;
+	t->callback = callback;
+	t->context = context;
+	t->csPin = csPin;
+	a->count++;
+	if(!a->busy) {
+		ROM_SSIDMAEnable(SSIBASE, SSI_DMA_RX | SSI_DMA_TX);
+		spiAsyncStart(n);
+	}
+	ROM_IntEnable(g_ulSSIInt[n]);
+
+	return true;
+}
+
+static void spiAsyncDone(void *context) {
+	*(volatile bool *) context = true;
+}
+
+/*
+ * Blocking uDMA transfer. It queues behind any pending transfers and
+ * falls back to the FIFO path for LSBFIRST or without a control table.
+ */
+void SPIClass::transfer(const void *txBuf, void *rxBuf, size_t count, uint8_t csPin) {
+	uint8_t n = ssiNumber(SSIBASE);
+	volatile bool done = false;
+
+	if(count == 0) return;
+
+	if(SSIBitOrder == LSBFIRST || (!spiAsync[n].ready && !spiAsyncBegin(n))) {
+		asyncFlush();
+		if(csPin != SPI_NO_CS) digitalWrite(csPin, LOW);
+		if(rxBuf) {
+			if(!txBuf)
+				memset(rxBuf, 0xFF, count);
+			else if(txBuf != rxBuf)
+				memmove(rxBuf, txBuf, count);
+			transfer(rxBuf, count);
+		} else if(txBuf) {
+			write(txBuf, count);
+		}
+		if(csPin != SPI_NO_CS) digitalWrite(csPin, HIGH);
+		return;
+	}
+
+	while(!transferAsync(txBuf, rxBuf, count, spiAsyncDone, (void *) &done, csPin))
+		spiAsyncPoll(n);
+	while(!done)
+		spiAsyncPoll(n);
+}
+
+uint8_t SPIClass::asyncPending() {
+	return spiAsync[ssiNumber(SSIBASE)].count;
+}
+
+// Wait for the queued transfers, required before using the FIFO calls
+void SPIClass::asyncFlush() {
+	uint8_t n = ssiNumber(SSIBASE);
+
+	while(spiAsync[n].count)
+		spiAsyncPoll(n);
+}
+
+/*
+ * A pin's interrupt is held off by clearing its GPIOIM bit, the edge is
+ * still latched in GPIORIS and serviced once the mask is restored. Any
+ * other source, or more pins than fit, holds off all interrupts.
+ */
+void SPIClass::usingInterrupt(uint8_t pin) {
+	uint8_t i;
+
+	if(digitalPinToPort(pin) == NOT_A_PORT) {
+		interruptMode = 2;
+		return;
+	}
+
+	for(i = 0; i < interruptCount; i++)
+		if(interruptPins[i] == pin) return;
+
+	if(interruptCount == SPI_INTERRUPT_PINS) {
+		interruptMode = 2;
+		return;
+	}
+
+	interruptPins[interruptCount++] = pin;
+	if(interruptMode == 0)
+		interruptMode = 1;
+}
+
+void SPIClass::beginTransaction(const SPISettings &settings) {
+	unsigned long base = SSIBASE;
+	uint8_t i;
+
+	// The settings must not change under a running uDMA transfer. Wait
+	// for it before masking interrupts, its completion is counted by the
+	// SSI interrupt handler
+	asyncFlush();
+
+	if(interruptMode == 2) {
+		interruptState = ROM_IntMasterDisable();
+	} else if(interruptMode == 1) {
+		for(i = 0; i < interruptCount; i++) {
+			uint8_t pin = interruptPins[i];
+			uint32_t im = (uint32_t) portBASERegister(digitalPinToPort(pin)) + GPIO_O_IM;
+			uint8_t bit = digitalPinToBitMask(pin);
+
+			interruptSave[i] = HWREG(im) & bit;
+			HWREG(im) &= ~bit;
+		}
+	}
+
+	SSIBitOrder = settings.order;
+	if(HWREG(base + SSI_O_CR0) != settings.cr0 ||
+			HWREG(base + SSI_O_CPSR) != settings.prescale) {
+		HWREG(base + SSI_O_CR1) &= ~SSI_CR1_SSE;
+		HWREG(base + SSI_O_CR0) = settings.cr0;
+		HWREG(base + SSI_O_CPSR) = settings.prescale;
+		HWREG(base + SSI_O_CR1) |= SSI_CR1_SSE;
+	}
+}
+
+void SPIClass::endTransaction(void) {
+	uint8_t i;
+
+	if(interruptMode == 2) {
+		if(!interruptState)
+			ROM_IntMasterEnable();
+	} else if(interruptMode == 1) {
+		for(i = 0; i < interruptCount; i++) {
+			uint8_t pin = interruptPins[i];
+			uint32_t im = (uint32_t) portBASERegister(digitalPinToPort(pin)) + GPIO_O_IM;
+
+			HWREG(im) |= interruptSave[i];
+		}
+	}
 }
 
 void SPIClass::setModule(uint8_t module) {
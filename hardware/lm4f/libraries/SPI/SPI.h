@@ -32,6 +32,55 @@
 #define MSBFIRST 1
 #define LSBFIRST 0
 
+// transfer(buf, count), transfer16() and write(buf, count) are available
+#define SPI_HAS_TRANSFER_BUF
+
+// Pending uDMA transfers per SSI module
+#define SPI_ASYNC_QUEUE 4
+#define SPI_NO_CS 0xFF
+
+typedef void (*SPIAsyncCallback)(void *context);
+
+#define SPI_HAS_TRANSACTION 1
+// Pins whose GPIO interrupt can be held off during a transaction
+#define SPI_INTERRUPT_PINS 4
+
+/*
+ * Settings of one SPI device as SSICR0 and SSICPSR images. The bit rate
+ * is F_CPU / (CPSR * (1 + SCR)) and never above the requested clock.
+ */
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    init(clock, bitOrder, dataMode);
+  }
+  SPISettings() {
+    init(4000000, MSBFIRST, SPI_MODE0);
+  }
+
+private:
+  void init(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    uint32_t div = clock ? (F_CPU + clock - 1) / clock : 0xFFFF;
+    uint32_t cpsr = ((div + 511) / 512) * 2;
+    uint32_t scr;
+
+    if (cpsr < 2) cpsr = 2;
+    if (cpsr > 254) cpsr = 254;
+    scr = (div + cpsr - 1) / cpsr;
+    scr = scr ? scr - 1 : 0;
+    if (scr > 255) scr = 255;
+
+    cr0 = (scr << 8) | (dataMode & (SPI_MODE3)) | 0x07;  // SPO, SPH, 8-bit data
+    prescale = cpsr;
+    order = bitOrder;
+  }
+
+  uint16_t cr0;
+  uint8_t prescale;
+  uint8_t order;
+  friend class SPIClass;
+};
+
 class SPIClass {
 
 private:
@@ -39,6 +88,12 @@ private:
 	uint8_t SSIModule;
 	uint8_t SSIBitOrder;
 
+	uint8_t interruptMode;		// 0 none, 1 pin masks, 2 all interrupts
+	uint8_t interruptCount;
+	uint8_t interruptPins[SPI_INTERRUPT_PINS];
+	uint8_t interruptSave[SPI_INTERRUPT_PINS];
+	bool interruptState;
+
 public:
 
   SPIClass(void);
@@ -54,6 +109,24 @@ public:
   void setClockDivider(uint8_t);
 
   uint8_t transfer(uint8_t);
+  uint16_t transfer16(uint16_t);
+  void transfer(void *, size_t);
+  void write(const void *, size_t);
+
+  // uDMA transfers, either buffer may be NULL for TX or RX only
+  bool transferAsync(const void *txBuf, void *rxBuf, size_t count,
+                     SPIAsyncCallback callback = 0, void *context = 0,
+                     uint8_t csPin = SPI_NO_CS);
+  void transfer(const void *txBuf, void *rxBuf, size_t count,
+                uint8_t csPin = SPI_NO_CS);
+  uint8_t asyncPending();
+  void asyncFlush();
+
+  // Transactions, interrupts registered with usingInterrupt() are held
+  // off until endTransaction()
+  void usingInterrupt(uint8_t pin);
+  void beginTransaction(const SPISettings &settings);
+  void endTransaction(void);
 
   //Stellarpad-specific functions
   void setModule(uint8_t);
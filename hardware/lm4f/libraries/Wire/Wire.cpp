@@ -61,6 +61,12 @@
 
 #define NOT_ACTIVE  0xA
 
+// Queued transaction states
+#define WIRE_IDLE	0
+#define WIRE_TX		1
+#define WIRE_RX		2
+#define WIRE_STOP	3
+
 static const unsigned long g_uli2cMasterBase[4] =
 {
 #if defined(TARGET_IS_BLIZZARD_RB1)
@@ -213,6 +219,16 @@ void (*TwoWire::user_onReceive)(int);
 
 uint8_t TwoWire::i2cModule = NOT_ACTIVE;
 uint8_t TwoWire::slaveAddress = 0;
+uint32_t TwoWire::i2cClock = 100000;
+
+static WireTransaction *wireQueue[WIRE_QUEUE_LENGTH];
+static volatile uint8_t wireHead = 0;
+static volatile uint8_t wireCount = 0;
+static volatile uint8_t wireState = WIRE_IDLE;
+static uint8_t wireReady = 0;
+static size_t wireIndex;
+static unsigned long wireCommand;
+static uint8_t wireError;
 // Constructors ////////////////////////////////////////////////////////////////
 
 TwoWire::TwoWire()
@@ -281,7 +297,18 @@ void TwoWire::forceStop(void) {
     //bring the bus back to it's erroneous state
     ROM_SysCtlPeripheralReset(g_uli2cPeriph[i2cModule]);
     while(!ROM_SysCtlPeripheralReady(g_uli2cPeriph[i2cModule]));
-    ROM_I2CMasterInitExpClk(MASTER_BASE, F_CPU, false);
+    setMasterClock();
+}
+
+void TwoWire::setMasterClock(void) {
+	uint32_t tpr;
+
+	ROM_I2CMasterInitExpClk(MASTER_BASE, F_CPU, false);
+	//SCL period is 20 * (1 + TPR) system clocks, round down the bit rate
+	tpr = ((F_CPU + 20 * i2cClock - 1) / (20 * i2cClock)) - 1;
+	//TPR is 7 bits, bit 7 is HS: clocks below F_CPU / 2560 run at that rate
+	if(tpr > I2C_MTPR_TPR_M) tpr = I2C_MTPR_TPR_M;
+	HWREG(MASTER_BASE + I2C_O_MTPR) = tpr;
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -301,7 +328,7 @@ void TwoWire::begin(void)
   ROM_GPIOPinConfigure(g_uli2cConfig[i2cModule][1]);
   ROM_GPIOPinTypeI2C(g_uli2cBase[i2cModule], g_uli2cSDAPins[i2cModule]);
   ROM_GPIOPinTypeI2CSCL(g_uli2cBase[i2cModule], g_uli2cSCLPins[i2cModule]);
-  ROM_I2CMasterInitExpClk(MASTER_BASE, F_CPU, false);//max bus speed=400kHz for gyroscope
+  setMasterClock();
 
   //force a stop condition
   if(!ROM_GPIOPinRead(g_uli2cBase[i2cModule], g_uli2cSCLPins[i2cModule]))
@@ -368,6 +395,7 @@ void TwoWire::begin(int address)
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop)
 {
   uint8_t error = 0;
+  asyncFlush();
   uint8_t oldWriteIndex = rxWriteIndex;
   uint8_t spaceAvailable = (rxWriteIndex >= rxReadIndex) ?
 		 BUFFER_LENGTH - (rxWriteIndex - rxReadIndex) : (rxReadIndex - rxWriteIndex);
@@ -447,6 +475,7 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop)
 
   if(TX_BUFFER_EMPTY) return 0;
   //Wait for any previous transaction to complete
+  asyncFlush();
   while(ROM_I2CMasterBusBusy(MASTER_BASE));
   while(ROM_I2CMasterBusy(MASTER_BASE));
 
@@ -586,6 +615,12 @@ void TwoWire::onRequest( void (*function)(void) )
 }
 
 void TwoWire::I2CIntHandler(void) {
+	//master interrupts are only unmasked while transactions are queued
+	if(i2cModule != NOT_ACTIVE && HWREG(MASTER_BASE + I2C_O_MMIS)) {
+		asyncHandler();
+		return;
+	}
+
 	//clear data interrupt
 	HWREG(SLAVE_BASE + I2C_O_SICR) = I2C_SICR_DATAIC;
 	uint8_t startDetected = 0;
@@ -652,6 +687,207 @@ void TwoWire::I2CIntHandler(void) {
 
 }
 
+// Sets the master bit rate, 1MHz Fast-mode Plus is only on the TM4C129
+void TwoWire::setClock(uint32_t clock)
+{
+#if defined(__TM4C1294NCPDT__) || defined(__TM4C129XNCZAD__)
+	if(clock > 1000000) clock = 1000000;
+#else
+	if(clock > 400000) clock = 400000;
+#endif
+	if(clock == 0) return;
+	i2cClock = clock;
+
+	if(i2cModule != NOT_ACTIVE && slaveAddress == 0 &&
+	   ROM_SysCtlPeripheralReady(g_uli2cPeriph[i2cModule])) {
+		asyncFlush();
+		while(ROM_I2CMasterBusy(MASTER_BASE));
+		setMasterClock();
+	}
+}
+
+/*
+ * Queued transactions. The master interrupt fires once per byte and
+ * asyncHandler() issues the next command, so the bus runs without the
+ * CPU waiting on it. A failed transaction that did not end with a STOP
+ * sends one first and completes on the interrupt that follows.
+ */
+void TwoWire::asyncCommand(unsigned long cmd)
+{
+	wireCommand = cmd;
+	HWREG(MASTER_BASE + I2C_O_MCS) = cmd;
+}
+
+void TwoWire::asyncRead(uint8_t start)
+{
+	WireTransaction *t = wireQueue[wireHead];
+
+	//NACK and STOP on the last byte, ACK on all others
+	if(wireIndex == t->rxLength - 1)
+		asyncCommand(RUN_BIT | start | STOP_BIT);
+	else
+		asyncCommand(RUN_BIT | start | ACK_BIT);
+}
+
+void TwoWire::asyncStart(void)
+{
+	WireTransaction *t = wireQueue[wireHead];
+
+	wireIndex = 0;
+	if(t->txLength) {
+		wireState = WIRE_TX;
+		ROM_I2CMasterSlaveAddrSet(MASTER_BASE, t->address, false);
+		ROM_I2CMasterDataPut(MASTER_BASE, t->txBuffer[0]);
+		asyncCommand(RUN_BIT | START_BIT |
+			((t->txLength == 1 && t->rxLength == 0) ? STOP_BIT : 0));
+	}
+	else {
+		wireState = WIRE_RX;
+		ROM_I2CMasterSlaveAddrSet(MASTER_BASE, t->address, true);
+		asyncRead(START_BIT);
+	}
+}
+
+void TwoWire::asyncDone(uint8_t error)
+{
+	WireTransaction *t = wireQueue[wireHead];
+	WireCallback callback = t->callback;
+
+	wireHead = (wireHead + 1) % WIRE_QUEUE_LENGTH;
+	wireCount--;
+	wireState = WIRE_IDLE;
+	t->status = error;
+
+	if(callback)
+		callback(t);
+
+	//The callback may have submitted and started another transaction
+	if(wireState == WIRE_IDLE) {
+		if(wireCount)
+			asyncStart();
+		else
+			ROM_I2CMasterIntDisable(MASTER_BASE);
+	}
+}
+
+void TwoWire::asyncHandler(void)
+{
+	WireTransaction *t = wireQueue[wireHead];
+	unsigned long status = HWREG(MASTER_BASE + I2C_O_MCS);
+
+	ROM_I2CMasterIntClear(MASTER_BASE);
+
+	if(wireState == WIRE_STOP) {
+		asyncDone(wireError);
+		return;
+	}
+
+	if(status & I2C_MCS_ERROR) {
+		if(status & I2C_MCS_ARBLST) {
+			//another master owns the bus now
+			asyncDone(4);
+			return;
+		}
+		wireError = (status & I2C_MCS_ADRACK) ? 2 : 3;
+		if(wireCommand & STOP_BIT) {
+			asyncDone(wireError);
+		}
+		else {
+			wireState = WIRE_STOP;
+			HWREG(MASTER_BASE + I2C_O_MCS) = STOP_BIT;
+		}
+		return;
+	}
+
+	switch(wireState) {
+		case(WIRE_TX):
+			if(++wireIndex < t->txLength) {
+				ROM_I2CMasterDataPut(MASTER_BASE, t->txBuffer[wireIndex]);
+				asyncCommand(RUN_BIT |
+					((wireIndex == t->txLength - 1 && t->rxLength == 0) ? STOP_BIT : 0));
+			}
+			else if(t->rxLength) {
+				//repeated start for the read
+				wireState = WIRE_RX;
+				wireIndex = 0;
+				ROM_I2CMasterSlaveAddrSet(MASTER_BASE, t->address, true);
+				asyncRead(START_BIT);
+			}
+			else {
+				asyncDone(0);
+			}
+			break;
+
+		case(WIRE_RX):
+			t->rxBuffer[wireIndex++] = ROM_I2CMasterDataGet(MASTER_BASE);
+			if(wireIndex < t->rxLength)
+				asyncRead(0);
+			else
+				asyncDone(0);
+			break;
+
+		default:
+			break;
+	}
+}
+
+bool TwoWire::submit(WireTransaction *t)
+{
+	if(i2cModule == NOT_ACTIVE || slaveAddress != 0 ||
+	   (t->txLength == 0 && t->rxLength == 0) ||
+	   wireCount == WIRE_QUEUE_LENGTH)
+		return false;
+
+	//The startup vector table covers only some of the modules
+	if(!wireReady) {
+		I2CIntRegister(MASTER_BASE, ::I2CIntHandler);
+		wireReady = 1;
+	}
+
+	t->status = WIRE_PENDING;
+
+	ROM_IntDisable(g_uli2cInt[i2cModule]);
+	wireQueue[(wireHead + wireCount) % WIRE_QUEUE_LENGTH] = t;
+	wireCount++;
+	if(wireState == WIRE_IDLE) {
+		//a blocking transfer may still be finishing its STOP
+		while(ROM_I2CMasterBusy(MASTER_BASE));
+		ROM_I2CMasterIntClear(MASTER_BASE);
+		ROM_I2CMasterIntEnable(MASTER_BASE);
+		asyncStart();
+	}
+	ROM_IntEnable(g_uli2cInt[i2cModule]);
+
+	return true;
+}
+
+uint8_t TwoWire::asyncPending(void)
+{
+	return wireCount;
+}
+
+void TwoWire::asyncFlush(void)
+{
+	while(wireCount);
+}
+
+uint8_t TwoWire::transfer(uint8_t address, const uint8_t *txBuffer, size_t txLength,
+		uint8_t *rxBuffer, size_t rxLength)
+{
+	WireTransaction t = { address, txBuffer, txLength, rxBuffer, rxLength };
+
+	if(i2cModule == NOT_ACTIVE || slaveAddress != 0)
+		return 4;
+	if(txLength == 0 && rxLength == 0)
+		return 0;
+
+	//queues behind any pending transactions
+	while(!submit(&t));
+	while(t.status == WIRE_PENDING);
+
+	return t.status;
+}
+
 void
 I2CIntHandler(void)
 {
@@ -660,6 +896,8 @@ I2CIntHandler(void)
 
 void TwoWire::setModule(unsigned long _i2cModule)
 {
+    asyncFlush();
+    wireReady = 0;
     i2cModule = _i2cModule;
     if(slaveAddress != 0) begin(slaveAddress);
     else begin();
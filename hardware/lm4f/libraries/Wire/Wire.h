@@ -14,6 +14,32 @@
 
 #define BOOST_PACK_WIRE 1
 
+// Transactions waiting for the bus, the active one included
+#define WIRE_QUEUE_LENGTH 8
+// WireTransaction status until the transaction has completed
+#define WIRE_PENDING 0xFF
+
+/*
+ * An interrupt driven master transaction: txLength bytes are written,
+ * then after a repeated start rxLength bytes are read. Either part may
+ * be empty. The struct belongs to the caller and has to stay in place
+ * until status is no longer WIRE_PENDING, it then holds the
+ * endTransmission() error code.
+ */
+struct WireTransaction;
+typedef void (*WireCallback)(WireTransaction *);
+
+struct WireTransaction {
+	uint8_t address;
+	const uint8_t *txBuffer;
+	size_t txLength;
+	uint8_t *rxBuffer;
+	size_t rxLength;
+	WireCallback callback;	// called from the I2C interrupt, may be NULL
+	void *context;
+	volatile uint8_t status;
+};
+
 class TwoWire : public Stream
 {
 
@@ -30,6 +56,8 @@ class TwoWire : public Stream
 		static uint8_t i2cModule;
 		static uint8_t slaveAddress;
 
+		static uint32_t i2cClock;
+
 		static uint8_t transmitting;
 		static uint8_t currentState;
 		static void (*user_onRequest)(void);
@@ -40,6 +68,13 @@ class TwoWire : public Stream
 		uint8_t getRxData(unsigned long cmd);
 		uint8_t sendTxData(unsigned long cmd, uint8_t data);
 		void forceStop(void);
+		void setMasterClock(void);
+
+		void asyncStart(void);
+		void asyncRead(uint8_t);
+		void asyncCommand(unsigned long);
+		void asyncDone(uint8_t);
+		void asyncHandler(void);
 
     public:
 		TwoWire(void);
@@ -63,6 +98,18 @@ class TwoWire : public Stream
 		virtual void flush(void);
 		void onReceive( void (*)(int) );
 		void onRequest( void (*)(void) );
+		void setClock(uint32_t);
+
+		// Queued transactions, the blocking calls wait for the queue
+		// to drain first and must not be used from a callback
+		bool submit(WireTransaction *);
+		uint8_t asyncPending(void);
+		void asyncFlush(void);
+
+		// Blocking transfers of any length straight from/to the
+		// caller's buffers, a write and a read are joined by a
+		// repeated start. Returns the endTransmission() error code.
+		uint8_t transfer(uint8_t, const uint8_t *, size_t, uint8_t *, size_t);
 
 
 		inline size_t write(unsigned long n) { return write((uint8_t)n); }
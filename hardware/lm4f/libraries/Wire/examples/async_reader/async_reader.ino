@@ -0,0 +1,50 @@
+// Wire Async Reader
+//
+// Demonstrates queued Wire transactions
+// Reads a register block from two I2C devices while loop() keeps
+// running, each transaction writes the register number and then reads
+// the data after a repeated start
+
+// This example code is in the public domain.
+
+
+#include <Wire.h>
+
+uint8_t reg = 0x00;
+uint8_t dataA[6];
+uint8_t dataB[6];
+
+WireTransaction readA = { 0x1D, &reg, 1, dataA, sizeof(dataA) };
+WireTransaction readB = { 0x68, &reg, 1, dataB, sizeof(dataB) };
+
+volatile unsigned long completed = 0;
+
+void countDone(WireTransaction *t)
+{
+  completed++;              // runs in the I2C interrupt
+}
+
+void setup()
+{
+  Wire.begin();             // join i2c bus as master
+  Wire.setClock(400000);    // 400kHz, up to 1MHz on the TM4C129
+  Serial.begin(9600);
+
+  readB.callback = countDone;
+}
+
+void loop()
+{
+  Wire.submit(&readA);      // both return at once
+  Wire.submit(&readB);
+
+  // ... other work while the bus runs ...
+
+  while(readA.status == WIRE_PENDING || readB.status == WIRE_PENDING)
+    ;
+
+  if(readA.status == 0) Serial.println(dataA[0]);
+  if(readB.status == 0) Serial.println(dataB[0]);
+
+  delay(500);
+}
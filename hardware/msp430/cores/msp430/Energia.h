@@ -242,7 +242,16 @@ void loop(void);
 
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, uint16_t len);
+void shiftInBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, uint16_t len);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
+uint8_t pulseInStart(uint8_t pin, uint8_t state);
+uint8_t pulseInAvailable(uint8_t pin);
+unsigned long pulseInResult(uint8_t pin);
+uint8_t pulseMeasureBegin(uint8_t pin, void (*callback)(uint8_t pin, unsigned long high, unsigned long period));
+unsigned long pulseMeasureHigh(uint8_t pin);
+unsigned long pulseMeasurePeriod(uint8_t pin);
+void pulseCaptureEnd(uint8_t pin);
 void pinMode(uint8_t, uint8_t);
 void pinMode_int(uint8_t, uint16_t);
 void digitalWrite(uint8_t, uint8_t);
@@ -254,6 +263,19 @@ void analogReference(uint16_t);
 void analogFrequency(uint32_t);
 void analogResolution(uint16_t);
 
+/*
+ * Multi-channel scan: the channels of a group are converted in one
+ * sequence-of-channels run from a single trigger.
+ */
+#define ANALOG_SCAN_MAX 8
+typedef struct {
+	uint8_t count;
+	uint8_t channel[ANALOG_SCAN_MAX];
+} analogScan_t;
+
+uint8_t analogScanBegin(analogScan_t *scan, const uint8_t pins[], uint8_t count);
+void analogScanRead(analogScan_t *scan, uint16_t values[]);
+uint8_t analogReadMulti(const uint8_t pins[], uint8_t count, uint16_t values[]);
 
 
 void delay(uint32_t milliseconds);
@@ -35,6 +35,7 @@ Version Modified By Date     Comments
 0007    M Sproul    10/08/29 Changed #ifdefs from cpu to register
 0008    P Brier     12/05/28 Modified for TI MSP430 processor
 0009    P Brier     12/05/29 Fixed problem with re-init of expired tone
+0010    agent       26/10/19 Pins on Timer1_A/Timer2_A outputs play from the timer
 *************************************************/
 
 #include "wiring_private.h"
@@ -71,6 +72,158 @@ static uint16_t tone_interval[AVAILABLE_TONE_PINS] = { SETARRAY(-1)  };
 static int16_t tone_periods[AVAILABLE_TONE_PINS] = { SETARRAY(0)  };
 
 
+/*
+ * Pins on a Timer1_A/Timer2_A CCR1/CCR2 output are played by the timer in
+ * up mode, one voice per timer and no interrupt per period. Their duration
+ * is a deadline checked by the WDT interrupt that already keeps millis().
+ * All other pins are toggled from the Timer0_A compare interrupts.
+ */
+#if defined(__MSP430_HAS_T1A3__) || defined(__MSP430_HAS_T2A3__)
+#define HW_TONE_VOICES 2
+
+static uint8_t hw_pins[HW_TONE_VOICES];
+static uint8_t hw_timed[HW_TONE_VOICES];
+static unsigned long hw_end[HW_TONE_VOICES];
+
+static void hwToneExpire(void);
+
+// returns the hardware voice (Timer1_A = 0, Timer2_A = 1) or -1
+static int8_t hwToneVoice(uint8_t _pin, uint8_t *ccr, uint16_t *sel)
+{
+  uint8_t timer = digitalPinToTimer(_pin);
+
+  *sel = PORT_SELECTION0;
+  if (timer >= T0A0_SEL01) {
+    timer -= (T0A0_SEL01 - T0A0);
+    *sel = PORT_SELECTION0 | PORT_SELECTION1;
+  } else if (timer >= T0A0_SEL1) {
+    timer -= (T0A0_SEL1 - T0A0);
+    *sel = PORT_SELECTION1;
+  }
+
+  switch (timer) {
+#if defined(__MSP430_HAS_T1A3__)
+    case T1A1: *ccr = 1; return 0;
+    case T1A2: *ccr = 2; return 0;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+    case T2A1: *ccr = 1; return 1;
+    case T2A2: *ccr = 2; return 1;
+#endif
+  }
+  return -1;
+}
+
+static void hwToneStop(uint8_t n)
+{
+  switch (n) {
+#if defined(__MSP430_HAS_T1A3__)
+    case 0: TA1CTL = TACLR; TA1CCTL1 = 0; TA1CCTL2 = 0; break;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+    case 1: TA2CTL = TACLR; TA2CCTL1 = 0; TA2CCTL2 = 0; break;
+#endif
+  }
+  pinMode(hw_pins[n], OUTPUT);
+  digitalWrite(hw_pins[n], LOW);
+  hw_pins[n] = 0;
+  hw_timed[n] = 0;
+}
+
+// arm the WDT deadline for the earliest timed hardware voice
+static void hwToneArm(void)
+{
+  uint8_t i, armed = 0;
+  unsigned long next = 0;
+
+  for (i = 0; i < HW_TONE_VOICES; i++) {
+    if (hw_pins[i] && hw_timed[i] && (!armed || (long)(hw_end[i] - next) < 0)) {
+      next = hw_end[i];
+      armed = 1;
+    }
+  }
+  wdt_deadline_fn = 0;
+  if (armed) {
+    wdt_deadline = next;
+    wdt_deadline_fn = hwToneExpire;
+  }
+}
+
+static void hwToneExpire(void)
+{
+  unsigned long now = wdt_millis;
+  uint8_t i;
+
+  for (i = 0; i < HW_TONE_VOICES; i++) {
+    if (hw_pins[i] && hw_timed[i] && (long)(now - hw_end[i]) >= 0)
+      hwToneStop(i);
+  }
+  hwToneArm();
+}
+
+static uint8_t hwTone(uint8_t _pin, unsigned int frequency, unsigned long duration)
+{
+  uint8_t ccr;
+  uint16_t sel, ctl;
+  int8_t n = hwToneVoice(_pin, &ccr, &sel);
+  unsigned long period;
+
+  if (n < 0 || frequency == 0) return 0;
+  period = F_TIMER / frequency;
+  if (period == 0 || period > 0xFFFF) return 0;
+
+  // the timer must be idle or already play this pin
+  ctl = (n == 0) ? TA1CTL : TA2CTL;
+  if (hw_pins[n] != _pin && (hw_pins[n] != 0 || (ctl & MC_3) != MC_0)) return 0;
+
+  hw_pins[n] = _pin;
+  pinMode_int(_pin, OUTPUT | sel);
+
+  switch (n) {
+#if defined(__MSP430_HAS_T1A3__)
+    case 0:
+      TA1CCR0 = period - 1;
+      if (ccr == 1) { TA1CCTL1 = OUTMOD_7; TA1CCR1 = period / 2; }
+      else          { TA1CCTL2 = OUTMOD_7; TA1CCR2 = period / 2; }
+      if ((TA1CTL & MC_3) != MC_1) TA1CTL = TACLR + TASSEL_2 + ID_3 + MC_1;
+      break;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+    case 1:
+      TA2CCR0 = period - 1;
+      if (ccr == 1) { TA2CCTL1 = OUTMOD_7; TA2CCR1 = period / 2; }
+      else          { TA2CCTL2 = OUTMOD_7; TA2CCR2 = period / 2; }
+      if ((TA2CTL & MC_3) != MC_1) TA2CTL = TACLR + TASSEL_2 + ID_3 + MC_1;
+      break;
+#endif
+  }
+
+  wdt_deadline_fn = 0;
+  hw_timed[n] = (duration > 0);
+  hw_end[n] = millis() + duration;
+  hwToneArm();
+  return 1;
+}
+
+static uint8_t hwNoTone(uint8_t _pin)
+{
+  uint8_t i;
+
+  for (i = 0; i < HW_TONE_VOICES; i++) {
+    if (hw_pins[i] != 0 && hw_pins[i] == _pin) {
+      wdt_deadline_fn = 0;
+      hwToneStop(i);
+      hwToneArm();
+      return 1;
+    }
+  }
+  return 0;
+}
+#else
+static uint8_t hwTone(uint8_t _pin, unsigned int frequency, unsigned long duration) { return 0; }
+static uint8_t hwNoTone(uint8_t _pin) { return 0; }
+#endif
+
 /**
 *** tone() -- Output a tone (50% Dutycycle PWM signal) on a pin
 ***  pin: This pin is selected as output
@@ -82,6 +235,9 @@ void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
   uint8_t port = digitalPinToPort(_pin);
   if (port == NOT_A_PORT) return;
 
+  if (hwTone(_pin, frequency, duration)) return;
+  hwNoTone(_pin);
+
   // find if we are using it at the moment, if so: update it
   for (int i = 0; i < AVAILABLE_TONE_PINS; i++)
   {
@@ -117,6 +273,7 @@ void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
 void noTone(uint8_t _pin)
 {
   if ( _pin == 255 ) return; // Should not happen!
+  if (hwNoTone(_pin)) return;
   for (int i = 0; i < AVAILABLE_TONE_PINS; i++)
   {
     if (tone_pins[i] == _pin) 
@@ -168,6 +168,28 @@ uint8_t TwoWire::endTransmission(void)
   return endTransmission(true);
 }
 
+//	Writes txLength bytes and then reads rxLength bytes in a single
+//	bus transaction without going through the BUFFER_LENGTH buffers.
+//	Returns 0 or the endTransmission() error code.
+//
+uint8_t TwoWire::transfer(uint8_t address, const uint8_t *txBuffer, size_t txLength,
+                          uint8_t *rxBuffer, size_t rxLength)
+{
+  uint16_t read;
+
+  if(txLength || !rxLength){
+    uint8_t ret = twi_writeBuffer(address, txBuffer, txLength, rxLength == 0);
+    if(ret || !rxLength){
+      return ret;
+    }
+  }
+  read = twi_readBuffer(address, rxBuffer, rxLength, 1);
+  if(read == 0){
+    return TWI_ERROR_ADDR_NACK;
+  }
+  return (read < rxLength) ? TWI_ERROR_OTHER : 0;
+}
+
 // must be called in:
 // slave tx event callback
 // or after beginTransmission(address)
@@ -73,6 +73,9 @@ class TwoWire : public Stream
     virtual int read(void);
     virtual int peek(void);
     virtual void flush(void);
+    // Transfers of any length straight from/to the caller's buffers,
+    // a write followed by a read is joined by a repeated start
+    uint8_t transfer(uint8_t, const uint8_t *, size_t, uint8_t *, size_t);
 #define USCI_ERROR "\n*********\nI2C Slave is not implemented for this MSP430. \nConsider using using a MSP430 with USCI peripheral e.g. MSP430G2553.\n*********\n"
 #if defined(__MSP430_HAS_USCI__) || defined(__MSP430_HAS_EUSCI_A0__) || defined(__MSP430_HAS_USCI_B0__) || defined(__MSP430_HAS_USCI_B1__)
     void onReceive( void (*)(int) );
@@ -53,9 +53,10 @@ static volatile uint8_t twi_inRepStart;         // in the middle of a repeated s
 static void (*twi_onSlaveTransmit)(void);
 static void (*twi_onSlaveReceive)(uint8_t*, int);
 
-static uint8_t twi_masterBuffer[TWI_BUFFER_LENGTH];
-static volatile uint8_t twi_masterBufferIndex;
-static uint8_t twi_masterBufferLength;
+/* Master transfers run straight from/to the caller's buffer */
+static uint8_t *twi_masterBuffer;
+static volatile uint16_t twi_masterBufferIndex;
+static uint16_t twi_masterBufferLength;
 
 static uint8_t twi_txBuffer[TWI_BUFFER_LENGTH];
 static volatile uint8_t twi_txBufferIndex;
@@ -73,6 +74,14 @@ static uint8_t twi_slarw;
 static uint8_t twi_my_addr;
 #endif
 
+#if TWI_USE_DMA
+/* DMA triggers of eUSCI_B0 */
+#define TWI_DMA_RX_TRIGGER 18
+#define TWI_DMA_TX_TRIGGER 19
+
+static uint8_t twi_dma;
+#endif
+
 
 
 
@@ -378,6 +387,71 @@ void twi_init(void)
 #endif
 }
 
+#if defined(__MSP430_HAS_EUSCI_B0__) || defined(__MSP430_HAS_EUSCI_B1__)
+/*
+ * UCASTPx can only be changed under UCSWRST. Puts back the automatic
+ * STOP setting a read found once its own STOP has gone out, so that
+ * later transfers do not run with the one the read needed.
+ */
+static void twi_restoreAutoStop(uint16_t astp)
+{
+	if ((UCBxCTLW1 & UCASTP_3) == astp)
+		return;
+	while (UCBxCTLW0 & UCTXSTP);
+	UCBxCTLW0 |= UCSWRST;
+	UCBxCTLW1 = (UCBxCTLW1 & ~UCASTP_3) | astp;
+	UCBxCTLW0 &= ~UCSWRST;
+}
+#endif
+
+#if TWI_USE_DMA
+/*
+ * The DMA moves the data on the UCRXIFG0/UCTXIFG0 triggers while the
+ * byte counter ends the transfer with an automatic STOP, so the CPU
+ * only wakes up for the STOP or a NACK. Transfers that end in a
+ * repeated start or do not fit the byte counter stay with the isr.
+ */
+static uint8_t twi_dmaUsable(uint16_t length, uint8_t sendStop)
+{
+	return (I2C_baseAddress == UCB0_BASE) && sendStop
+		&& (length > 1) && (length <= 255);
+}
+
+static void twi_dmaStart(uint8_t trigger, uint16_t src, uint16_t dst,
+			 uint16_t length, uint16_t increment)
+{
+	DMA2CTL = 0;
+	DMACTL1 = (DMACTL1 & 0xFFE0) | trigger;	/* DMA2TSEL */
+	__data16_write_addr((unsigned short)&DMA2SA, (unsigned long)src);
+	__data16_write_addr((unsigned short)&DMA2DA, (unsigned long)dst);
+	DMA2SZ = length;
+	/* the RX/TX interrupts would race the DMA for the flags */
+	UCBxIE &= ~(UCRXIE0|UCTXIE0);
+	DMA2CTL = DMADT_0 | increment | DMASBDB | DMAEN;
+}
+
+/* Returns the number of bytes moved */
+static uint16_t twi_dmaStop(uint16_t length)
+{
+	if (!(DMA2CTL & DMAIFG))
+		length -= DMA2SZ;
+	DMA2CTL = 0;
+
+	/* The first byte is loaded while the address goes out, a NACK
+	 * after the second one was loaded is a data NACK */
+	if (twi_error == TWI_ERROR_ADDR_NACK && length > 1)
+		twi_error = TWI_ERROR_DATA_NACK;
+
+	/* A NACK leaves the bus to us */
+	if (twi_error != TWI_ERRROR_NO_ERROR) {
+		UCBxCTLW0 |= UCTXSTP;
+		while (UCBxCTLW0 & UCTXSTP);
+	}
+	UCBxIE |= (UCRXIE0|UCTXIE0);
+	return length;
+}
+#endif
+
 /*
  * Function twi_setAddress
  * Desc     sets slave address and enables interrupt
@@ -410,7 +484,32 @@ void twi_setAddress(uint8_t address)
  */
 uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
 {
-	uint8_t i;
+	// ensure data will fit into buffer
+	if(TWI_BUFFER_LENGTH < length){
+		return 0;
+	}
+	return twi_readBuffer(address, data, length, sendStop);
+}
+
+/*
+ * Function twi_readBuffer
+ * Desc     reads any number of bytes from a device on the bus
+ *          in one transaction, straight into the caller's array
+ * Input    address: 7bit i2c device address
+ *          data: pointer to byte array
+ *          length: number of bytes to read into array
+ * Output   number of bytes read
+ */
+uint16_t twi_readBuffer(uint8_t address, uint8_t* data, uint16_t length, uint8_t sendStop)
+{
+#if defined(__MSP430_HAS_EUSCI_B0__) || defined(__MSP430_HAS_EUSCI_B1__)
+	uint16_t astp;
+#endif
+
+	if(length == 0){
+		return 0;
+	}
+	twi_error = TWI_ERRROR_NO_ERROR;
 
 #if (DEFAULT_I2C == -1)
 	if (I2C_baseAddress == -1)
@@ -444,16 +543,29 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
     UCBxCTLW0 |= (UCMST);                     // I2C Master, synchronous mode
     UCBxCTLW0 &= ~(UCTR);                     // Configure in receive mode
     UCBxI2CSA = address;                      // Set Slave Address
-    UCBxTBCNT = length;                       // set number of bytes to transmit
+	astp = UCBxCTLW1 & UCASTP_3;              // restored when the read is done
+	if(length > 255) {
+		UCBxTBCNT = 0;                        // beyond the byte counter, STOP is sent by the isr
+		UCBxCTLW1 &= ~UCASTP_2;
+	} else {
+		UCBxTBCNT = length;                   // set number of bytes to transmit
+	}
+#if TWI_USE_DMA
+	twi_dma = twi_dmaUsable(length, sendStop);
+	if (twi_dma)
+		UCBxCTLW1 |= UCASTP_2;                // NACK and Stop after the last byte
+#endif
     UCBxCTLW0 &= ~UCSWRST;                    // Clear SW reset, resume operation
     UCBxIE |= (UCRXIE0|UCALIE|UCNACKIE|UCSTTIE|UCSTPIE); // Enable I2C interrupts
+#if TWI_USE_DMA
+	if (twi_dma)
+		twi_dmaStart(TWI_DMA_RX_TRIGGER, (uint16_t)&UCBxRXBUF, (uint16_t)data,
+			length, DMADSTINCR_3);
+#endif
 #endif
-	// ensure data will fit into buffer
-	if(TWI_BUFFER_LENGTH < length){
-		return 0;
-	}
 
 	// initialize buffer iteration vars
+	twi_masterBuffer = data;
 	twi_masterBufferIndex = 0;
 	twi_masterBufferLength = length-1;  // This is not intuitive, read on...
 	// On receive, the previously configured ACK/NACK setting is transmitted in
@@ -492,16 +604,19 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
 		__bis_SR_register(LPM0_bits);
 	}
 
+#if TWI_USE_DMA
+	if (twi_dma)
+		twi_masterBufferIndex = twi_dmaStop(length);
+#endif
 	if (twi_masterBufferIndex < length)
 		length = twi_masterBufferIndex;
 
-	for(i = 0; i < length; ++i){
-		data[i] = twi_masterBuffer[i];
-	}
-
 #if defined(__MSP430_HAS_USCI__) || defined(__MSP430_HAS_USCI_B0__) || defined(__MSP430_HAS_USCI_B1__)
 	/* Ensure stop condition got sent before we exit. */
 	while (UCBxCTL1 & UCTXSTP);
+#endif
+#if defined(__MSP430_HAS_EUSCI_B0__) || defined(__MSP430_HAS_EUSCI_B1__)
+	twi_restoreAutoStop(astp);
 #endif
 	return length;
 }
@@ -522,14 +637,31 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
  */
 uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait, uint8_t sendStop)
 {
-	uint8_t i;
+	/* Ensure data will fit into buffer */
+	if(length > TWI_BUFFER_LENGTH){
+		return TWI_ERROR_BUF_TO_LONG;
+	}
+	return twi_writeBuffer(address, data, length, sendStop);
+}
+
+/*
+ * Function twi_writeBuffer
+ * Desc     writes any number of bytes to a device on the bus in
+ *          one transaction, straight from the caller's array
+ * Input    address: 7bit i2c device address
+ *          data: pointer to byte array
+ *          length: number of bytes in array
+ * Output   as twi_writeTo()
+ */
+uint8_t twi_writeBuffer(uint8_t address, const uint8_t* data, uint16_t length, uint8_t sendStop)
+{
 	twi_error = TWI_ERRROR_NO_ERROR;
 	twi_sendStop = sendStop;
 
 #if (DEFAULT_I2C == -1)	
 	if (I2C_baseAddress == -1)
 	{
-		return (i2c_sw_write(address, length, data, sendStop));
+		return (i2c_sw_write(address, length, (uint8_t *)data, sendStop));
 	}
 #endif
 #if defined(__MSP430_HAS_USI__)
@@ -556,30 +688,27 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
     UCBxCTLW0 |= UCSWRST;                     // Enable SW reset
     UCBxCTLW0 |= (UCMST | UCTR);              //  I2C Master, transmit mode
     UCBxI2CSA = address;                      // Set Slave Address
-    UCBxTBCNT = length;                       // set number of bytes to transmit
-	if((sendStop) && (length > 0)) {
+    UCBxTBCNT = (length > 255) ? 0 : length;  // set number of bytes to transmit
+	if((sendStop) && (length > 0) && (length <= 255)) {
 		UCBxCTLW1 |= UCASTP_2;                // do generate Stop after last Byte to send
 	} else {
 		UCBxCTLW1 &= ~UCASTP_2;               // do not generate Stop
 	}
     UCBxCTLW0 &= ~UCSWRST;                    // Clear SW reset, resume operation
     UCBxIE |= (UCRXIE|UCTXIE0|UCALIE|UCNACKIE|UCSTPIE); // Enable I2C interrupts
+#if TWI_USE_DMA
+	twi_dma = twi_dmaUsable(length, sendStop);
+	if (twi_dma)
+		twi_dmaStart(TWI_DMA_TX_TRIGGER, (uint16_t)data, (uint16_t)&UCBxTXBUF,
+			length, DMASRCINCR_3);
+#endif
 #endif
-
-	/* Ensure data will fit into buffer */
-	if(length > TWI_BUFFER_LENGTH){
-		return TWI_ERROR_BUF_TO_LONG;
-	}
-
 
 	/* initialize buffer iteration vars */
+	twi_masterBuffer = (uint8_t *)data;
 	twi_masterBufferIndex = 0;
 	twi_masterBufferLength = length;
 
-	for(i = 0; i < length; ++i){
-		twi_masterBuffer[i] = data[i];
-	}
-
 #if defined(__MSP430_HAS_USI__)
 	/* build sla+w, slave device address + w bit */
 	twi_slarw = 0;
@@ -604,6 +733,11 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
 		__bis_SR_register(LPM0_bits);
 	}
 
+#if TWI_USE_DMA
+	if (twi_dma)
+		twi_dmaStop(length);
+#endif
+
 #if defined(__MSP430_HAS_USCI__) || defined(__MSP430_HAS_USCI_B0__) || defined(__MSP430_HAS_USCI_B1__)
 	/* Ensure stop/start condition got sent before we exit. */
 	if(sendStop)
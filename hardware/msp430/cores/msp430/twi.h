@@ -52,6 +52,16 @@
 #define TWI_BUFFER_LENGTH 16
 #endif
 
+/* Multi-byte master transfers on eUSCI_B0 are moved by DMA channel 2,
+ * define TWI_USE_DMA 0 to leave the channel to the sketch */
+#ifndef TWI_USE_DMA
+#if defined(__MSP430_HAS_DMAX_3__) && defined(__MSP430_HAS_EUSCI_B0__)
+#define TWI_USE_DMA 1
+#else
+#define TWI_USE_DMA 0
+#endif
+#endif
+
 
 #define TWI_READY 0
 #define TWI_MRX   1
@@ -94,6 +104,8 @@ void twi_init(void);
 void twi_setAddress(uint8_t);
 uint8_t twi_readFrom(uint8_t, uint8_t*, uint8_t, uint8_t);
 uint8_t twi_writeTo(uint8_t, uint8_t*, uint8_t, uint8_t, uint8_t);
+uint16_t twi_readBuffer(uint8_t, uint8_t*, uint16_t, uint8_t);
+uint8_t twi_writeBuffer(uint8_t, const uint8_t*, uint16_t, uint8_t);
 uint8_t twi_transmit(const uint8_t*, uint8_t);
 void twi_attachSlaveRxEvent( void (*)(uint8_t*, int) );
 void twi_attachSlaveTxEvent( void (*)(void) );
@@ -60,6 +60,11 @@ volatile uint8_t sleeping = false;
 volatile boolean stay_asleep = false;
 volatile uint16_t vlo_freq = 0;
 
+// Deadline on the millis() clock checked from the WDT interrupt, so that
+// core code can time events without a timer interrupt of its own
+volatile unsigned long wdt_deadline = 0;
+void (*volatile wdt_deadline_fn)(void) = 0;
+
 void initClocks(void);
 void enableWatchDogIntervalMode(void);
 
@@ -709,6 +714,9 @@ void watchdog_isr (void)
 	wdt_millis = m;
 	wdt_overflow_count++;
 
+	if (wdt_deadline_fn && (long)(m - wdt_deadline) >= 0)
+		wdt_deadline_fn();
+
         /* Exit from LMP3 on reti (this includes LMP0) */
 	_bic_SR_register_on_exit(LPM3_bits);
 }
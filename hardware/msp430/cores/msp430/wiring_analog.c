@@ -483,6 +483,141 @@ uint16_t analogRead(uint8_t pin)
 #endif
 }
 
+uint8_t analogScanBegin(analogScan_t *scan, const uint8_t pins[], uint8_t count)
+{
+	uint8_t i;
+	uint8_t channel;
+
+	if (count == 0 || count > ANALOG_SCAN_MAX)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		if (pins[i] >= 128)
+			channel = pins[i] - 128;
+		else
+			channel = digitalPinToADCIn(pins[i]);
+		if (channel == NOT_ON_ADC)
+			return 0;
+#if defined(__MSP430_HAS_ADC10__)
+		// DTC block holds every channel from the highest one down to A0
+		if (channel > 15)
+			return 0;
+#endif
+		scan->channel[i] = channel;
+	}
+	scan->count = count;
+	return count;
+}
+
+void analogScanRead(analogScan_t *scan, uint16_t values[])
+{
+	uint8_t i;
+#if defined(__MSP430_HAS_ADC10__)
+    // CONSEQ_1 converts from INCH down to A0, the DTC stores the results
+    // highest channel first.
+    uint16_t block[16];
+    uint8_t top = 0;
+    uint8_t ae = 0;
+
+    for (i = 0; i < scan->count; i++) {
+        if (scan->channel[i] > top) top = scan->channel[i];
+        if (scan->channel[i] < 8) ae |= (1 << scan->channel[i]);
+    }
+    while (ADC10CTL1 & ADC10BUSY);          // wait for any active conversion
+    ADC10CTL0 &= ~ADC10ENC;                 // disable ADC
+    ADC10CTL1 = ADC10SSEL_0 | ADC10DIV_4 |  // ADC10OSC as ADC10CLK (~5MHz) / 5
+            CONSEQ_1 | (top << 12);         // sequence of channels from top to A0
+    ADC10CTL0 = REFV_MAP(analog_reference) | // set analog reference
+            ADC10ON | ADC10SHT_3 | MSC | ADC10IE; // ADC ON; S&H 64 x ADC10CLKs; multiple sample
+    ADC10AE0 = ae;                          // Disable input/output buffer on pins
+    ADC10DTC0 = 0;                          // one block mode
+    ADC10DTC1 = top + 1;                    // one transfer per converted channel
+    ADC10SA = (uint16_t) block;             // DTC start address
+    __delay_cycles(128);                    // Delay to allow Ref to settle
+    ADC10CTL0 |= ADC10ENC | ADC10SC;        // enable ADC and start sequence
+    while (ADC10CTL1 & ADC10BUSY) {         // sleep and wait for completion
+        __bis_SR_register(CPUOFF + GIE);    // LPM0 with interrupts enabled
+    }
+    /* POWER: Turn ADC and reference voltage off to conserve power */
+    ADC10CTL0 &= ~(ADC10ENC);
+    ADC10CTL0 &= ~(ADC10ON | REFON);
+    ADC10DTC1 = 0;                          // disable DTC for analogRead()
+    for (i = 0; i < scan->count; i++)
+        values[i] = mapResolution(block[top - scan->channel[i]], DEFAULT_READ_RESOLUTION, _readResolution);
+#elif defined(__MSP430_HAS_ADC12_PLUS__)
+    uint8_t last = scan->count - 1;
+    ADC12CTL0 &= ~ADC12ENC;                 // disable ADC
+    ADC12CTL1 = ADC12SSEL_0 | ADC12DIV_4 |  // ADC12OSC as ADC12CLK (~5MHz) / 5
+            ADC12SHP | ADC12CONSEQ_1;       // sampling timer; sequence from MEM0
+    while(REFCTL0 & REFGENBUSY);            // If ref generator busy, WAIT
+    REFCTL0 = REF_MAP(analog_reference);    // Set reference using masking off the SREF bits. See Energia.h.
+    for (i = 0; i < scan->count; i++)
+        (&ADC12MCTL0)[i] = scan->channel[i] | REFV_MAP(analog_reference) | (i == last ? ADC12EOS : 0);
+    ADC12CTL0 = ADC12ON | ADC12SHT0_4 | ADC12MSC; // ADC ON; S&H 64 x ADC12CLKs; multiple sample
+    ADC12CTL2 |= ADC12RES1;                 // 12-bit resolution
+    ADC12IFG = 0;                           // Clear Flags
+    ADC12IE = (1 << last);                  // Interrupt at end of sequence only
+    __delay_cycles(128);                    // Delay to allow Ref to settle
+    ADC12CTL0 |= ADC12ENC | ADC12SC;        // enable ADC and start sequence
+    while (ADC12CTL1 & ADC12BUSY) {         // sleep and wait for completion
+        __bis_SR_register(CPUOFF + GIE);    // LPM0 with interrupts enabled
+    }
+    ADC12IE = 0;                            // Leave MEM0 to analogRead()
+    /* POWER: Turn ADC and reference voltage off to conserve power */
+    ADC12CTL0 &= ~(ADC12ENC);
+    ADC12CTL0 &= ~(ADC12ON);
+    REFCTL0 &= ~REFON;
+    for (i = 0; i < scan->count; i++)
+        values[i] = mapResolution((&ADC12MEM0)[i], DEFAULT_READ_RESOLUTION, _readResolution);
+#elif defined(__MSP430_HAS_ADC12_B__)
+    uint8_t last = scan->count - 1;
+    ADC12CTL0 &= ~ADC12ENC;                 // disable ADC
+    ADC12CTL0 = ADC12ON | ADC12SHT0_4 | ADC12MSC; // ADC ON; S&H 64 x ADC12CLKs; multiple sample
+    ADC12CTL1 = ADC12SSEL_0 | ADC12DIV_4 |  // ADC12OSC as ADC12CLK (~5MHz) / 5
+            ADC12SHP | ADC12CONSEQ_1;       // sampling timer; sequence of channels
+    ADC12CTL3 = ADC12TCMAP | ADC12BATMAP;   // Map Temp and BAT, sequence starts at MEM0
+    ADC12CTL2 |= ADC12RES_2;                // 12-bit resolution
+    ADC12IFGR0 = 0;                         // Clear Flags
+    ADC12IER0 = (1 << last);                // Interrupt at end of sequence only
+    while(REFCTL0 & REFGENBUSY);            // If ref generator busy, WAIT
+    REFCTL0 = REF_MAP(analog_reference);    // Set reference using masking off the SREF bits. See Energia.h.
+    for (i = 0; i < scan->count; i++)
+        (&ADC12MCTL0)[i] = scan->channel[i] | REFV_MAP(analog_reference) | (i == last ? ADC12EOS : 0);
+    if (REFCTL0 & REFON)
+        while(!(REFCTL0 & REFGENRDY));      // wait till ref generator ready
+    ADC12CTL0 |= ADC12ENC | ADC12SC;        // enable ADC and start sequence
+    while (ADC12CTL1 & ADC12BUSY) {         // sleep and wait for completion
+        __bis_SR_register(CPUOFF + GIE);    // LPM0 with interrupts enabled
+    }
+    ADC12IER0 = 0;                          // Leave MEM0 to analogRead()
+    /* POWER: Turn ADC and reference voltage off to conserve power */
+    ADC12CTL0 &= ~(ADC12ENC);
+    ADC12CTL0 &= ~(ADC12ON);
+    REFCTL0 &= ~(REFON);
+    for (i = 0; i < scan->count; i++)
+        values[i] = mapResolution((&ADC12MEM0)[i], DEFAULT_READ_RESOLUTION, _readResolution);
+#elif defined(__MSP430_HAS_ADC10_B__) || defined(__MSP430_HAS_ADC__)
+    // ADC10_B and ADC only have a single conversion memory; without DMA
+    // the sequence has to be collected one channel at a time.
+    for (i = 0; i < scan->count; i++)
+        values[i] = analogRead(128 + scan->channel[i]);
+#else
+    // no ADC
+    for (i = 0; i < scan->count; i++)
+        values[i] = 0;
+#endif
+}
+
+uint8_t analogReadMulti(const uint8_t pins[], uint8_t count, uint16_t values[])
+{
+	analogScan_t scan;
+
+	if (!analogScanBegin(&scan, pins, count))
+		return 0;
+	analogScanRead(&scan, values);
+	return count;
+}
+
 #if defined(__MSP430_HAS_ADC10__)
 __attribute__((interrupt(ADC10_VECTOR)))
 void ADC10_ISR(void)
@@ -537,18 +672,16 @@ void ADC10_ISR(void)
 __attribute__((interrupt(ADC12_VECTOR)))
 void ADC12_ISR(void)
 {
-    switch(ADC12IV,12) {
+    // Only the MEMx that ends the conversion has its interrupt enabled:
+    // MEM0 for analogRead(), the last one of the sequence for analogScanRead()
+    switch(ADC12IV) {
         case  0: break;                          // No interrupt
         case  2: break;                          // conversion result overflow
         case  4: break;                          // conversion time overflow
-        case  6: break;                          // ADC12HI
-        case  8: break;                          // ADC12LO
-        case 10: break;                          // ADC12IN
-        case 12:
+        default:                                 // ADC12IFG0 .. ADC12IFG15
 				 ADC12IFG = 0;                   // Clear Flags
                  __bic_SR_register_on_exit(CPUOFF);        // return to active mode
-                 break;                          // Clear CPUOFF bit from 0(SR)                         
-        default: break;
+                 break;                          // Clear CPUOFF bit from 0(SR)
     }
 
 }
@@ -558,18 +691,20 @@ void ADC12_ISR(void)
 __attribute__((interrupt(ADC12_VECTOR)))
 void ADC12_ISR(void)
 {
-    switch(ADC12IV,12) {
+    // Only the MEMx that ends the conversion has its interrupt enabled:
+    // MEM0 for analogRead(), the last one of the sequence for analogScanRead()
+    switch(ADC12IV) {
         case  0: break;                          // No interrupt
         case  2: break;                          // conversion result overflow
         case  4: break;                          // conversion time overflow
         case  6: break;                          // ADC12HI
         case  8: break;                          // ADC12LO
         case 10: break;                          // ADC12IN
-        case 12:
+        case 76: break;                          // ADC12RDY
+        default:                                 // ADC12IFG0 .. ADC12IFG31
 				 ADC12IFGR0 = 0;                 // Clear Flags
                  __bic_SR_register_on_exit(CPUOFF);        // return to active mode
-                 break;                          // Clear CPUOFF bit from 0(SR)                         
-        default: break;
+                 break;                          // Clear CPUOFF bit from 0(SR)
     }
 
 }
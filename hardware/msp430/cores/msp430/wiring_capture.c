@@ -0,0 +1,314 @@
+/*
+  ************************************************************************
+  *	wiring_capture.c
+  *
+  *	Energia core files for MSP430
+  *		Timer_A input capture for pulseIn() and pulse measurement
+  *
+  ***********************************************************************
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "pins_energia.h"
+
+/*
+ * Pins on CCR1/CCR2 of Timer1_A and Timer2_A are captured in hardware.
+ * Timer0_A is left alone since Tone and TimerSerial own it. The timer
+ * runs continuous from SMCLK and its overflows extend the 16 bit capture
+ * registers to 32 bits. A timer already running in up mode for
+ * analogWrite() or a library is left alone and the pin is not captured.
+ */
+#if defined(__MSP430_HAS_T1A3__) || defined(__MSP430_HAS_T2A3__)
+
+#define CAPTURE_CHANNELS 4
+
+typedef struct {
+	uint8_t pin;		// 0 when the channel is not capturing
+	uint8_t state;
+	uint8_t continuous;
+	uint8_t started;
+	uint8_t fell;
+	volatile uint8_t ready;
+	uint32_t lead;		// leading edge timestamp
+	uint32_t high;
+	volatile uint32_t width;	// in SMCLK ticks
+	volatile uint32_t period;	// in SMCLK ticks
+	void (*callback)(uint8_t pin, unsigned long high, unsigned long period);
+} pulseCapture_t;
+
+static pulseCapture_t capture[CAPTURE_CHANNELS];
+static volatile uint16_t overflows[2];
+
+static void captureEvent(uint8_t ch, uint16_t ccr, uint16_t cctl, uint8_t overflowPending)
+{
+	pulseCapture_t *c = &capture[ch];
+	uint16_t hi = overflows[ch >> 1];
+	uint32_t now;
+	uint8_t level = (cctl & CCI) ? HIGH : LOW;
+
+	/* TAIFG is serviced after the CCRs, a small capture value
+	 * with an overflow pending was latched after the wrap */
+	if (overflowPending && ccr < 0x8000)
+		hi++;
+	now = ((uint32_t)hi << 16) | ccr;
+
+	if (c->continuous) {
+		if (level == HIGH) {
+			if (c->started && c->fell) {
+				c->period = now - c->lead;
+				c->width = c->high;
+				c->ready = 1;
+				if (c->callback)
+					c->callback(c->pin, clockCyclesToMicroseconds(c->width),
+						clockCyclesToMicroseconds(c->period));
+			}
+			c->lead = now;
+			c->started = 1;
+			c->fell = 0;
+		} else if (c->started) {
+			c->high = now - c->lead;
+			c->fell = 1;
+		}
+	} else if (level == c->state && !c->ready) {
+		c->lead = now;
+		c->started = 1;
+	} else if (c->started && !c->ready) {
+		c->width = now - c->lead;
+		c->ready = 1;
+	}
+}
+
+static volatile unsigned int *captureControl(uint8_t ch)
+{
+	switch (ch) {
+#if defined(__MSP430_HAS_T1A3__)
+	case 0: return &TA1CCTL1;
+	case 1: return &TA1CCTL2;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+	case 2: return &TA2CCTL1;
+	case 3: return &TA2CCTL2;
+#endif
+	}
+	return 0;
+}
+
+static int8_t captureChannel(uint8_t pin, uint16_t *sel)
+{
+	uint8_t timer = digitalPinToTimer(pin);
+
+	*sel = PORT_SELECTION0;
+	if (timer >= T0A0_SEL01) {
+		timer -= (T0A0_SEL01 - T0A0);
+		*sel = PORT_SELECTION0 | PORT_SELECTION1;
+	} else if (timer >= T0A0_SEL1) {
+		timer -= (T0A0_SEL1 - T0A0);
+		*sel = PORT_SELECTION1;
+	}
+
+	switch (timer) {
+#if defined(__MSP430_HAS_T1A3__)
+	case T1A1: return 0;
+	case T1A2: return 1;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+	case T2A1: return 2;
+	case T2A2: return 3;
+#endif
+	}
+	return -1;
+}
+
+/* A timer that runs in any other than continuous mode belongs to
+ * analogWrite() or a library */
+static uint8_t captureTimerBusy(uint8_t ch)
+{
+#if defined(__MSP430_HAS_T1A3__)
+	if (ch < 2)
+		return (TA1CTL & MC_3) != MC_0 && (TA1CTL & MC_3) != MC_2;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+	if (ch >= 2)
+		return (TA2CTL & MC_3) != MC_0 && (TA2CTL & MC_3) != MC_2;
+#endif
+	return 1;
+}
+
+static pulseCapture_t *captureFind(uint8_t pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < CAPTURE_CHANNELS; i++) {
+		if (capture[i].pin == pin)
+			return &capture[i];
+	}
+	return 0;
+}
+
+static pulseCapture_t *captureStart(uint8_t pin, uint8_t continuous, uint8_t state)
+{
+	int8_t ch;
+	uint16_t sel;
+	pulseCapture_t *c;
+	volatile unsigned int *cctl;
+
+	if (pin == 0 || digitalPinToPort(pin) == NOT_A_PORT)
+		return 0;
+
+	if ((ch = captureChannel(pin, &sel)) < 0 || captureTimerBusy(ch))
+		return 0;
+
+	c = &capture[ch];
+	cctl = captureControl(ch);
+	pinMode_int(pin, INPUT | sel);
+
+	*cctl = 0;
+	c->pin = pin;
+	c->state = state;
+	c->continuous = continuous;
+	c->started = 0;
+	c->fell = 0;
+	c->ready = 0;
+	c->callback = 0;
+
+	/* Start the timer in continuous mode unless a capture already runs on it */
+#if defined(__MSP430_HAS_T1A3__)
+	if (ch < 2 && (TA1CTL & MC_3) != MC_2) {
+		overflows[0] = 0;
+		TA1CTL = TASSEL_2 + MC_2 + TACLR + TAIE;
+	}
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+	if (ch >= 2 && (TA2CTL & MC_3) != MC_2) {
+		overflows[1] = 0;
+		TA2CTL = TASSEL_2 + MC_2 + TACLR + TAIE;
+	}
+#endif
+	*cctl = CM_3 + CCIS_0 + SCS + CAP + CCIE;
+
+	return c;
+}
+
+uint8_t pulseInStart(uint8_t pin, uint8_t state)
+{
+	return captureStart(pin, 0, state) != 0;
+}
+
+uint8_t pulseInAvailable(uint8_t pin)
+{
+	pulseCapture_t *c = captureFind(pin);
+	return c ? c->ready : 0;
+}
+
+unsigned long pulseInResult(uint8_t pin)
+{
+	pulseCapture_t *c = captureFind(pin);
+	if (c == 0 || !c->ready) return 0;
+	return clockCyclesToMicroseconds(c->width);
+}
+
+uint8_t pulseMeasureBegin(uint8_t pin,
+	void (*callback)(uint8_t pin, unsigned long high, unsigned long period))
+{
+	pulseCapture_t *c = captureStart(pin, 1, HIGH);
+	if (c == 0) return 0;
+	c->callback = callback;
+	return 1;
+}
+
+unsigned long pulseMeasureHigh(uint8_t pin)
+{
+	pulseCapture_t *c = captureFind(pin);
+	if (c == 0 || !c->ready) return 0;
+	return clockCyclesToMicroseconds(c->width);
+}
+
+unsigned long pulseMeasurePeriod(uint8_t pin)
+{
+	pulseCapture_t *c = captureFind(pin);
+	if (c == 0 || !c->ready) return 0;
+	return clockCyclesToMicroseconds(c->period);
+}
+
+void pulseCaptureEnd(uint8_t pin)
+{
+	pulseCapture_t *c = captureFind(pin);
+	uint8_t ch;
+
+	if (pin == 0 || c == 0) return;
+
+	ch = c - capture;
+	*captureControl(ch) = 0;
+	c->pin = 0;
+
+	/* Stop the timer once neither of its channels captures */
+#if defined(__MSP430_HAS_T1A3__)
+	if (ch < 2 && capture[0].pin == 0 && capture[1].pin == 0)
+		TA1CTL = TACLR;
+#endif
+#if defined(__MSP430_HAS_T2A3__)
+	if (ch >= 2 && capture[2].pin == 0 && capture[3].pin == 0)
+		TA2CTL = TACLR;
+#endif
+}
+
+#if defined(__MSP430_HAS_T1A3__)
+__attribute__((interrupt(TIMER1_A1_VECTOR)))
+void TIMER1_A1_ISR(void)
+{
+	uint16_t iv;
+
+	while ((iv = TA1IV) != 0) {
+		switch (iv) {
+		case 0x2: captureEvent(0, TA1CCR1, TA1CCTL1, TA1CTL & TAIFG); break; // CCR1
+		case 0x4: captureEvent(1, TA1CCR2, TA1CCTL2, TA1CTL & TAIFG); break; // CCR2
+		default: overflows[0]++; break;                                   // TAIFG
+		}
+	}
+}
+#endif
+
+#if defined(__MSP430_HAS_T2A3__)
+__attribute__((interrupt(TIMER2_A1_VECTOR)))
+void TIMER2_A1_ISR(void)
+{
+	uint16_t iv;
+
+	while ((iv = TA2IV) != 0) {
+		switch (iv) {
+		case 0x2: captureEvent(2, TA2CCR1, TA2CCTL1, TA2CTL & TAIFG); break; // CCR1
+		case 0x4: captureEvent(3, TA2CCR2, TA2CCTL2, TA2CTL & TAIFG); break; // CCR2
+		default: overflows[1]++; break;                                   // TAIFG
+		}
+	}
+}
+#endif
+
+#else
+
+/* No Timer1_A/Timer2_A with capture inputs, pulseIn() stays in software */
+uint8_t pulseInStart(uint8_t pin, uint8_t state) { return 0; }
+uint8_t pulseInAvailable(uint8_t pin) { return 0; }
+unsigned long pulseInResult(uint8_t pin) { return 0; }
+uint8_t pulseMeasureBegin(uint8_t pin,
+	void (*callback)(uint8_t pin, unsigned long high, unsigned long period)) { return 0; }
+unsigned long pulseMeasureHigh(uint8_t pin) { return 0; }
+unsigned long pulseMeasurePeriod(uint8_t pin) { return 0; }
+void pulseCaptureEnd(uint8_t pin) { }
+
+#endif
@@ -53,6 +53,9 @@ extern "C"{
 
 typedef void (*voidFuncPtr)(void);
 
+extern volatile unsigned long wdt_deadline;
+extern void (*volatile wdt_deadline_fn)(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -35,9 +35,25 @@
 /* Measures the length (in microseconds) of a pulse on the pin; state is HIGH
  * or LOW, the type of pulse to measure.  Works on pulses from 2-3 microseconds
  * to 3 minutes in length, but must be called at least a few dozen microseconds
- * before the start of the pulse. */
+ * before the start of the pulse. Pins on a Timer1_A/Timer2_A capture input
+ * are timed in hardware, see pulseInStart(). */
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
 {
+	if (pulseInStart(pin, state)) {
+		unsigned long start = micros();
+		unsigned long result;
+
+		while (!pulseInAvailable(pin)) {
+			if (micros() - start >= timeout) {
+				pulseCaptureEnd(pin);
+				return 0;
+			}
+		}
+		result = pulseInResult(pin);
+		pulseCaptureEnd(pin);
+		return result;
+	}
+
 	// cache the port and bit of the pin in order to speed up the
 	// pulse width measuring loop and achieve finer resolution.  calling
 	// digitalRead() instead yields much coarser resolution.
@@ -32,32 +32,98 @@
 
 #include "wiring_private.h"
 
-uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+/*
+ * Port registers and masks of a data/clock pin pair, looked up once so the
+ * bit loops below do not go through digitalWrite()/digitalRead() per bit.
+ */
+typedef struct {
+	volatile uint8_t *data;
+	volatile uint8_t *clock;
+	uint8_t dataBit;
+	uint8_t clockBit;
+} shiftPins_t;
+
+static uint8_t shiftPinsGet(shiftPins_t *p, uint8_t dataPin, uint8_t clockPin, uint8_t input)
+{
+	uint8_t dataPort = digitalPinToPort(dataPin);
+	uint8_t clockPort = digitalPinToPort(clockPin);
+
+	if (dataPort == NOT_A_PORT || clockPort == NOT_A_PORT)
+		return 0;
+
+	p->data = input ? portInputRegister(dataPort) : portOutputRegister(dataPort);
+	p->clock = portOutputRegister(clockPort);
+	p->dataBit = digitalPinToBitMask(dataPin);
+	p->clockBit = digitalPinToBitMask(clockPin);
+	return 1;
+}
+
+static uint8_t shiftInBits(const shiftPins_t *p, uint8_t bitOrder)
+{
 	uint8_t value = 0;
+	uint8_t mask = (bitOrder == LSBFIRST) ? 0x01 : 0x80;
 	uint8_t i;
 
 	for (i = 0; i < 8; ++i) {
-		digitalWrite(clockPin, HIGH);
-		if (bitOrder == LSBFIRST)
-			value |= digitalRead(dataPin) << i;
-		else
-			value |= digitalRead(dataPin) << (7 - i);
-		digitalWrite(clockPin, LOW);
+		*p->clock |= p->clockBit;
+		if (*p->data & p->dataBit)
+			value |= mask;
+		*p->clock &= ~p->clockBit;
+		mask = (bitOrder == LSBFIRST) ? mask << 1 : mask >> 1;
 	}
 	return value;
 }
 
-void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+static void shiftOutBits(const shiftPins_t *p, uint8_t bitOrder, uint8_t val)
 {
+	uint8_t mask = (bitOrder == LSBFIRST) ? 0x01 : 0x80;
 	uint8_t i;
 
 	for (i = 0; i < 8; i++)  {
-		if (bitOrder == LSBFIRST)
-			digitalWrite(dataPin, !!(val & (1 << i)));
-		else	
-			digitalWrite(dataPin, !!(val & (1 << (7 - i))));
-			
-		digitalWrite(clockPin, HIGH);
-		digitalWrite(clockPin, LOW);		
+		if (val & mask)
+			*p->data |= p->dataBit;
+		else
+			*p->data &= ~p->dataBit;
+
+		*p->clock |= p->clockBit;
+		*p->clock &= ~p->clockBit;
+		mask = (bitOrder == LSBFIRST) ? mask << 1 : mask >> 1;
 	}
 }
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+	shiftPins_t p;
+
+	if (!shiftPinsGet(&p, dataPin, clockPin, 1))
+		return 0;
+	return shiftInBits(&p, bitOrder);
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+	shiftPins_t p;
+
+	if (!shiftPinsGet(&p, dataPin, clockPin, 0))
+		return;
+	shiftOutBits(&p, bitOrder, val);
+}
+
+void shiftInBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, uint16_t len)
+{
+	shiftPins_t p;
+
+	if (!shiftPinsGet(&p, dataPin, clockPin, 1))
+		return;
+	while (len--)
+		*buf++ = shiftInBits(&p, bitOrder);
+}
+
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, uint16_t len)
+{
+	shiftPins_t p;
+
+	if (!shiftPinsGet(&p, dataPin, clockPin, 0))
+		return;
+	while (len--)
+		shiftOutBits(&p, bitOrder, *buf++);
+}
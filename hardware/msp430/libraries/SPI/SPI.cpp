@@ -17,3 +17,56 @@
 
 SPIClass SPI;
 
+uint8_t SPIClass::interruptMode = 0;
+uint8_t SPIClass::interruptMask[2] = { 0, 0 };
+uint8_t SPIClass::interruptSave[2];
+uint16_t SPIClass::interruptState;
+
+/*
+ * Pins on P1 and P2 only have their own interrupt enable masked during a
+ * transaction, any other interrupt source holds off all interrupts.
+ */
+void SPIClass::usingInterrupt(uint8_t pin)
+{
+    uint8_t port = digitalPinToPort(pin);
+
+    if (port == P1) {
+        interruptMask[0] |= digitalPinToBitMask(pin);
+#if defined(PORT2_VECTOR)
+    } else if (port == P2) {
+        interruptMask[1] |= digitalPinToBitMask(pin);
+#endif
+    } else {
+        interruptMode = 2;
+    }
+    if (interruptMode == 0)
+        interruptMode = 1;
+}
+
+void SPIClass::maskInterrupts(void)
+{
+    if (interruptMode == 2) {
+        interruptState = __get_interrupt_state();
+        __dint();
+        return;
+    }
+    interruptSave[0] = P1IE & interruptMask[0];
+    P1IE &= ~interruptMask[0];
+#if defined(PORT2_VECTOR)
+    interruptSave[1] = P2IE & interruptMask[1];
+    P2IE &= ~interruptMask[1];
+#endif
+}
+
+void SPIClass::endTransaction(void)
+{
+    if (interruptMode == 2) {
+        __set_interrupt_state(interruptState);
+    } else if (interruptMode == 1) {
+        P1IE |= interruptSave[0];
+#if defined(PORT2_VECTOR)
+        P2IE |= interruptSave[1];
+#endif
+    }
+}
+
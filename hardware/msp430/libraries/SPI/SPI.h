@@ -26,7 +26,26 @@
 #define SPI_MODE2 2
 #define SPI_MODE3 4
 
+#define SPI_HAS_TRANSACTION 1
+
+class SPISettings {
+public:
+  SPISettings() { spi_settings_init(&image, 4000000, MSBFIRST, SPI_MODE0); }
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    spi_settings_init(&image, clock, bitOrder, dataMode);
+  }
+private:
+  spi_settings_t image;
+  friend class SPIClass;
+};
+
 class SPIClass {
+private:
+  static uint8_t interruptMode;     // 0 none, 1 port masks, 2 all interrupts
+  static uint8_t interruptMask[2];  // P1IE and P2IE bits used by SPI drivers
+  static uint8_t interruptSave[2];
+  static uint16_t interruptState;
+
 public:
   inline static uint8_t transfer(uint8_t _data);
 
@@ -41,6 +60,15 @@ public:
 
   inline static void attachInterrupt();
   inline static void detachInterrupt();
+
+  // Transactions, interrupts registered with usingInterrupt() are held
+  // off until endTransaction()
+  static void usingInterrupt(uint8_t pin);
+  inline static void beginTransaction(const SPISettings &settings);
+  static void endTransaction(void);
+
+private:
+  static void maskInterrupts(void);
 };
 
 extern SPIClass SPI;
@@ -74,6 +102,13 @@ void SPIClass::setClockDivider(uint8_t rate)
     spi_set_divisor(rate);
 }
 
+void SPIClass::beginTransaction(const SPISettings &settings)
+{
+    if (interruptMode)
+        maskInterrupts();
+    spi_apply_settings(&settings.image);
+}
+
 void SPIClass::attachInterrupt() {
     /* undocumented in Arduino 1.0 */
 }
@@ -153,4 +153,35 @@ void spi_set_datamode(const uint8_t mode)
 	/* Release for operation. */
 	UCB0CTL1 &= ~UCSWRST;
 }
+
+/**
+ * spi_settings_init() - precompute UCB0CTLW0 and the bit rate divider.
+ */
+void spi_settings_init(spi_settings_t *settings, const uint32_t clock, const uint8_t order, const uint8_t mode)
+{
+	/* Never run faster than asked. */
+	uint32_t div = (F_CPU + clock - 1) / clock;
+
+	settings->ctl = UCSSEL_2 | UCSYNC | UCMST | ((order == 1 /*MSBFIRST*/) ? UCMSB : 0);
+	switch(mode) {
+	case 1: settings->ctl |= SPI_MODE_1; break;
+	case 2: settings->ctl |= SPI_MODE_2; break;
+	case 4: settings->ctl |= SPI_MODE_3; break;
+	default: settings->ctl |= SPI_MODE_0; break;
+	}
+	settings->div = (div == 0) ? 1 : (div > 0xFFFF) ? 0xFFFF : div;
+}
+
+/**
+ * spi_apply_settings() - reprogram UCB0 if it is set up differently.
+ */
+void spi_apply_settings(const spi_settings_t *settings)
+{
+	if ((UCB0CTLW0 & ~UCSWRST) == settings->ctl && UCB0BRW == settings->div)
+		return;
+
+	UCB0CTLW0 = settings->ctl | UCSWRST;
+	UCB0BRW = settings->div;
+	UCB0CTLW0 = settings->ctl;
+}
 #endif
@@ -140,6 +140,39 @@ void spi_set_datamode(const uint8_t mode)
     }
     UCB0CTL1 &= ~UCSWRST;       // release for operation
 }
+
+/**
+ * spi_settings_init() - precompute UCB0CTL0 and the bit rate divider
+ */
+void spi_settings_init(spi_settings_t *settings, const uint32_t clock, const uint8_t order, const uint8_t mode)
+{
+    uint32_t div = (F_CPU + clock - 1) / clock;     // never faster than asked
+
+    settings->ctl = UCSYNC | UCMST | ((order == 1 /*MSBFIRST*/) ? UCMSB : 0);
+    switch(mode) {
+    case 1: settings->ctl |= SPI_MODE_1; break;
+    case 2: settings->ctl |= SPI_MODE_2; break;
+    case 4: settings->ctl |= SPI_MODE_3; break;
+    default: settings->ctl |= SPI_MODE_0; break;
+    }
+    settings->div = (div == 0) ? 1 : (div > 0xFFFF) ? 0xFFFF : div;
+}
+
+/**
+ * spi_apply_settings() - reprogram UCB0 if it is set up differently
+ */
+void spi_apply_settings(const spi_settings_t *settings)
+{
+    if (UCB0CTL0 == settings->ctl && UCB0BR0 == (settings->div & 0xFF)
+            && UCB0BR1 == (settings->div >> 8))
+        return;
+
+    UCB0CTL1 |= UCSWRST;        // go into reset state
+    UCB0CTL0 = settings->ctl;
+    UCB0BR0 = settings->div & 0xFF;
+    UCB0BR1 = settings->div >> 8;
+    UCB0CTL1 &= ~UCSWRST;       // release for operation
+}
 #else
     //#error "Error! This device doesn't have a USCI peripheral"
 #endif
@@ -159,6 +159,52 @@ void spi_set_datamode(const uint8_t mode)
         bResetAdjust = USI5_NO_ADJUST;
     }
 }
+
+/**
+ * spi_settings_init() - precompute USICTL0, USICTL1 and USICKCTL
+ *
+ * The USI divides SMCLK by a power of two, the smallest divider that
+ * does not exceed the requested clock is used.
+ */
+void spi_settings_init(spi_settings_t *settings, const uint32_t clock, const uint8_t order, const uint8_t mode)
+{
+    uint8_t div = 0;
+
+    while (div < 7 && (F_CPU >> div) > clock)
+        div++;
+
+    settings->ctl = USIPE5 | USIPE6 | USIPE7 | USIMST | USIOE
+        | ((order == 1 /*MSBFIRST*/) ? 0 : USILSB);
+    settings->div = (div << 5) | USISSEL_2;
+
+    if (mode == 0 || mode == 2)         /* CPHA=0 */
+        settings->ctl |= USICKPH << 8;
+    if (mode == 2 || mode == 4)         /* CPOL=1 */
+        settings->div |= USICKPL;
+}
+
+/**
+ * spi_apply_settings() - reprogram the USI if it is set up differently
+ */
+void spi_apply_settings(const spi_settings_t *settings)
+{
+    if ((USICTL0 & ~USISWRST) == (settings->ctl & 0xFF)
+            && (USICTL1 & USICKPH) == (settings->ctl >> 8)
+            && USICKCTL == settings->div)
+        return;
+
+    USICTL0 = (settings->ctl & 0xFF) | USISWRST;
+    USICTL1 = settings->ctl >> 8;
+    USICKCTL = settings->div;
+    USICTL0 &= ~USISWRST;
+
+    if (USICTL1 & USICKPH) {
+        if (bResetAdjust != USI5_SENT)
+            bResetAdjust = USI5_ADJUST;
+    } else {
+        bResetAdjust = USI5_NO_ADJUST;
+    }
+}
 #else
     //#warning "Error! This device doesn't have a USI peripheral"
 #endif
@@ -0,0 +1,121 @@
+/*
+ AnalogScan.cpp - Multi-channel simultaneous ADC14 scan for the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Energia.h"
+#include "AnalogScan.h"
+
+#include <driverlib/adc14.h>
+#include <driverlib/gpio.h>
+
+// Port and pin of each external ADC14 input (MSP432P401R datasheet)
+static const struct {
+	uint8_t port;
+	uint16_t pin;
+} adc14_input_to_pin[ANALOG_SCAN_MAX] = {
+	{GPIO_PORT_P5, GPIO_PIN5}, {GPIO_PORT_P5, GPIO_PIN4},	// A0, A1
+	{GPIO_PORT_P5, GPIO_PIN3}, {GPIO_PORT_P5, GPIO_PIN2},	// A2, A3
+	{GPIO_PORT_P5, GPIO_PIN1}, {GPIO_PORT_P5, GPIO_PIN0},	// A4, A5
+	{GPIO_PORT_P4, GPIO_PIN7}, {GPIO_PORT_P4, GPIO_PIN6},	// A6, A7
+	{GPIO_PORT_P4, GPIO_PIN5}, {GPIO_PORT_P4, GPIO_PIN4},	// A8, A9
+	{GPIO_PORT_P4, GPIO_PIN3}, {GPIO_PORT_P4, GPIO_PIN2},	// A10, A11
+	{GPIO_PORT_P4, GPIO_PIN1}, {GPIO_PORT_P4, GPIO_PIN0},	// A12, A13
+	{GPIO_PORT_P6, GPIO_PIN1}, {GPIO_PORT_P6, GPIO_PIN0},	// A14, A15
+	{GPIO_PORT_P9, GPIO_PIN1}, {GPIO_PORT_P9, GPIO_PIN0},	// A16, A17
+	{GPIO_PORT_P8, GPIO_PIN7}, {GPIO_PORT_P8, GPIO_PIN6},	// A18, A19
+	{GPIO_PORT_P8, GPIO_PIN5}, {GPIO_PORT_P8, GPIO_PIN4},	// A20, A21
+	{GPIO_PORT_P8, GPIO_PIN3}, {GPIO_PORT_P8, GPIO_PIN2},	// A22, A23
+};
+
+AnalogScan::AnalogScan()
+{
+	_count = 0;
+	_resolution = 10;
+}
+
+uint8_t AnalogScan::begin(const uint8_t channels[], uint8_t count)
+{
+	if (count == 0 || count > ANALOG_SCAN_MAX)
+		return 0;
+
+	for (uint8_t i = 0; i < count; i++) {
+		if (channels[i] >= ANALOG_SCAN_MAX)
+			return 0;
+		GPIO_setAsPeripheralModuleFunctionInputPin(
+				adc14_input_to_pin[channels[i]].port,
+				adc14_input_to_pin[channels[i]].pin,
+				GPIO_TERTIARY_MODULE_FUNCTION);
+		_channel[i] = channels[i];
+	}
+	_count = count;
+
+	return count;
+}
+
+void AnalogScan::resolution(uint8_t bits)
+{
+	_resolution = bits;
+}
+
+void AnalogScan::read(uint16_t values[])
+{
+	if (_count == 0)
+		return;
+
+	uint32_t last = 1UL << (_count - 1);
+
+	// analogRead() shares ADC14, so the sequence memory is reloaded on
+	// every scan. It is only register stores next to the conversions.
+	ADC14_disableConversion();
+	ADC14_enableModule();
+	ADC14_initModule(ADC_CLOCKSOURCE_MCLK, ADC_PREDIVIDER_1, ADC_DIVIDER_4, ADC_NOROUTE);
+	ADC14_setResolution(ADC_14BIT);
+	ADC14_setSampleHoldTrigger(ADC_TRIGGER_ADCSC, false);
+	ADC14_configureMultiSequenceMode(ADC_MEM0, last, false);
+	for (uint8_t i = 0; i < _count; i++) {
+		ADC14_configureConversionMemory(1UL << i, ADC_VREFPOS_AVCC_VREFNEG_VSS,
+				_channel[i], false);
+	}
+	ADC14_enableSampleTimer(ADC_AUTOMATIC_ITERATION);
+
+	// One trigger converts the whole group, the last memory flags completion
+	ADC14_clearInterruptFlag(last);
+	ADC14_enableConversion();
+	ADC14_toggleConversionTrigger();
+	while (!(ADC14_getInterruptStatus() & last));
+	ADC14_clearInterruptFlag(last);
+	ADC14_disableConversion();
+
+	for (uint8_t i = 0; i < _count; i++) {
+		uint16_t value = ADC14_getResult(1UL << i);
+		if (_resolution < 14)
+			value >>= (14 - _resolution);
+		else
+			value <<= (_resolution - 14);
+		values[i] = value;
+	}
+}
+
+uint8_t analogReadMulti(const uint8_t channels[], uint8_t count, uint16_t values[])
+{
+	AnalogScan scan;
+
+	if (!scan.begin(channels, count))
+		return 0;
+	scan.read(values);
+	return count;
+}
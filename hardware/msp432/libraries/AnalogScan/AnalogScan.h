@@ -0,0 +1,65 @@
+/*
+ AnalogScan.h - Multi-channel simultaneous ADC14 scan for the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+How to use:
+ A scan group converts a list of ADC14 inputs back to back from one
+ trigger using the ADC14 sequence memory (MEM0..MEMn), so the samples
+ are only a conversion time apart instead of a full analogRead() each.
+
+ Channels are ADC14 input numbers (0 for A0 ... 23 for A23), the pins
+ are switched to their analog function by begin().
+
+   uint8_t phases[] = {0, 1, 2};
+   uint16_t current[3];
+   AnalogScan scan;
+
+   scan.begin(phases, 3);
+   scan.read(current);
+
+ or for a one off conversion:
+   analogReadMulti(phases, 3, current);
+
+ Results are scaled to 10 bits by default, see resolution().
+*/
+
+#ifndef AnalogScan_h
+#define AnalogScan_h
+
+#include <stdint.h>
+
+#define ANALOG_SCAN_MAX 24
+
+class AnalogScan
+{
+public:
+	AnalogScan();
+	uint8_t begin(const uint8_t channels[], uint8_t count);
+	void read(uint16_t values[]);
+	void resolution(uint8_t bits);
+	uint8_t count() { return _count; }
+
+private:
+	uint8_t _count;
+	uint8_t _resolution;
+	uint8_t _channel[ANALOG_SCAN_MAX];
+};
+
+uint8_t analogReadMulti(const uint8_t channels[], uint8_t count, uint16_t values[]);
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ Sample program that samples three current sense inputs with one
+ ADC14 sequence so the phase currents are taken at the same instant.
+
+ The circuit:
+ * Current sense amplifier outputs on A0, A1 and A2.
+
+ This example code is in the public domain.
+
+*/
+
+#include "AnalogScan.h"
+
+uint8_t phases[] = {0, 1, 2};
+uint16_t current[3];
+AnalogScan scan;
+
+void setup() {
+  Serial.begin(115200);
+  scan.begin(phases, 3);
+}
+
+void loop() {
+  scan.read(current);
+  Serial.print(current[0]);
+  Serial.print("\t");
+  Serial.print(current[1]);
+  Serial.print("\t");
+  Serial.println(current[2]);
+  delay(100);
+}
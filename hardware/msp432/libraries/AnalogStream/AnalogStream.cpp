@@ -0,0 +1,230 @@
+/*
+ AnalogStream.cpp - Timer paced ADC14 streaming with DMA ping-pong buffers
+ for the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Energia.h"
+#include "AnalogStream.h"
+
+#include <driverlib/adc14.h>
+#include <driverlib/cs.h>
+#include <driverlib/dma.h>
+#include <driverlib/gpio.h>
+#include <driverlib/interrupt.h>
+#include <driverlib/timer_a.h>
+
+#define STREAM_DMA_MAPPING DMA_CH7_ADC14
+#define STREAM_DMA_CHANNEL DMA_CHANNEL_7
+#define STREAM_DMA_INT DMA_INT1
+
+// Timer_A module and the ADC14 SHS source wired to its CCR1 output
+static const struct {
+	uint32_t timer;
+	uint32_t trigger;
+} stream_timer[] = {
+	{TIMER_A0_MODULE, ADC_TRIGGER_SOURCE1},
+	{TIMER_A1_MODULE, ADC_TRIGGER_SOURCE3},
+	{TIMER_A2_MODULE, ADC_TRIGGER_SOURCE5},
+	{TIMER_A3_MODULE, ADC_TRIGGER_SOURCE7},
+};
+
+// Only used when nothing else has installed a DMA control table yet
+static uint8_t stream_control_table[1024] __attribute__((aligned(1024)));
+
+static void AnalogStream_dma_int(void)
+{
+	AnalogStream._dmaHandler();
+}
+
+AnalogStreamClass::AnalogStreamClass()
+{
+	_buffer = 0;
+	_blockSize = 0;
+	_callback = 0;
+	_ready = 0;
+	_next = 0;
+	_overruns = 0;
+	_sampleRate = 0;
+}
+
+bool AnalogStreamClass::begin(uint8_t channel, uint32_t sampleRate, uint16_t *buffer,
+		uint16_t blockSize, uint8_t timerIndex)
+{
+	uint32_t divider = TIMER_A_CLOCKSOURCE_DIVIDER_1;
+	uint32_t period;
+
+	if (channel > 23 || sampleRate == 0 || buffer == 0 || timerIndex > 3
+			|| blockSize == 0 || blockSize > ANALOG_STREAM_MAX_BLOCK)
+		return false;
+
+	end();
+
+	_buffer = buffer;
+	_blockSize = blockSize;
+	_timer = stream_timer[timerIndex].timer;
+	_ready = 0;
+	_next = 0;
+	_overruns = 0;
+
+	// Smallest divider that fits the period in the 16-bit counter
+	period = CS_getSMCLK() / sampleRate;
+	while (period > 0xFFFF && divider < TIMER_A_CLOCKSOURCE_DIVIDER_64) {
+		divider <<= 1;
+		period >>= 1;
+	}
+	if (period < 2 || period > 0xFFFF)
+		return false;
+	_sampleRate = CS_getSMCLK() / divider / period;
+
+	// ADC14: single channel, repeated, one conversion per timer edge.
+	// MCLK / 2 keeps ADC14CLK within spec for 1 MS/s at 14 bits.
+	ADC14_disableConversion();
+	ADC14_enableModule();
+	ADC14_initModule(ADC_CLOCKSOURCE_MCLK, ADC_PREDIVIDER_1, ADC_DIVIDER_2, ADC_NOROUTE);
+	ADC14_setResolution(ADC_14BIT);
+	ADC14_setSampleHoldTime(ADC_PULSE_WIDTH_4, ADC_PULSE_WIDTH_4);
+	ADC14_configureSingleSampleMode(ADC_MEM0, true);
+	ADC14_configureConversionMemory(ADC_MEM0, ADC_VREFPOS_AVCC_VREFNEG_VSS, channel, false);
+	ADC14_setSampleHoldTrigger(stream_timer[timerIndex].trigger, false);
+	ADC14_disableSampleTimer();
+	ADC14_clearInterruptFlag(ADC_OV_INT | ADC_INT0);
+
+	// DMA ping-pong: primary fills the first half, alternate the second
+	DMA_enableModule();
+	if (DMA_getControlBase() == 0)
+		DMA_setControlBase(stream_control_table);
+	DMA_assignChannel(STREAM_DMA_MAPPING);
+	DMA_disableChannelAttribute(STREAM_DMA_CHANNEL,
+			UDMA_ATTR_ALTSELECT | UDMA_ATTR_USEBURST |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+	DMA_enableChannelAttribute(STREAM_DMA_CHANNEL, UDMA_ATTR_HIGH_PRIORITY);
+	DMA_setChannelControl(STREAM_DMA_CHANNEL | UDMA_PRI_SELECT,
+			UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 | UDMA_ARB_1);
+	DMA_setChannelControl(STREAM_DMA_CHANNEL | UDMA_ALT_SELECT,
+			UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 | UDMA_ARB_1);
+	DMA_setChannelTransfer(STREAM_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_PINGPONG,
+			(void *) &ADC14->MEM[0], _buffer, _blockSize);
+	DMA_setChannelTransfer(STREAM_DMA_CHANNEL | UDMA_ALT_SELECT, UDMA_MODE_PINGPONG,
+			(void *) &ADC14->MEM[0], _buffer + _blockSize, _blockSize);
+	DMA_assignInterrupt(STREAM_DMA_INT, STREAM_DMA_CHANNEL);
+	DMA_registerInterrupt(STREAM_DMA_INT, AnalogStream_dma_int);
+	DMA_clearInterruptFlag(STREAM_DMA_CHANNEL);
+	DMA_enableInterrupt(STREAM_DMA_INT);
+	DMA_enableChannel(STREAM_DMA_CHANNEL);
+
+	ADC14_enableConversion();
+
+	// Timer_A up mode, CCR1 set/reset gives one rising edge per period
+	const Timer_A_UpModeConfig upConfig = {
+		TIMER_A_CLOCKSOURCE_SMCLK,
+		divider,
+		period - 1,
+		TIMER_A_TAIE_INTERRUPT_DISABLE,
+		TIMER_A_CCIE_CCR0_INTERRUPT_DISABLE,
+		TIMER_A_DO_CLEAR
+	};
+	const Timer_A_CompareModeConfig compareConfig = {
+		TIMER_A_CAPTURECOMPARE_REGISTER_1,
+		TIMER_A_CAPTURECOMPARE_INTERRUPT_DISABLE,
+		TIMER_A_OUTPUTMODE_SET_RESET,
+		period / 2
+	};
+	Timer_A_configureUpMode(_timer, &upConfig);
+	Timer_A_initCompare(_timer, &compareConfig);
+	Timer_A_startCounter(_timer, TIMER_A_UP_MODE);
+
+	return true;
+}
+
+void AnalogStreamClass::end()
+{
+	if (_buffer == 0)
+		return;
+
+	Timer_A_stopTimer(_timer);
+	ADC14_disableConversion();
+	DMA_disableChannel(STREAM_DMA_CHANNEL);
+	DMA_disableInterrupt(STREAM_DMA_INT);
+	_buffer = 0;
+}
+
+void AnalogStreamClass::onBlock(void (*callback)(uint16_t *block, uint16_t length))
+{
+	_callback = callback;
+}
+
+bool AnalogStreamClass::blockReady()
+{
+	return (_ready & (1 << _next)) != 0;
+}
+
+uint16_t *AnalogStreamClass::getBlock()
+{
+	uint16_t *block;
+
+	if (_buffer == 0)
+		return 0;
+
+	while (!blockReady());
+
+	block = _buffer + _next * _blockSize;
+	Interrupt_disableMaster();
+	_ready &= ~(1 << _next);
+	Interrupt_enableMaster();
+	_next ^= 1;
+
+	return block;
+}
+
+void AnalogStreamClass::_dmaHandler()
+{
+	uint8_t half;
+
+	DMA_clearInterruptFlag(STREAM_DMA_CHANNEL);
+
+	// The half whose descriptor has stopped is the one that just filled;
+	// re-arm it straight away so the stream never has a gap.
+	if (DMA_getChannelMode(STREAM_DMA_CHANNEL | UDMA_PRI_SELECT) == UDMA_MODE_STOP) {
+		half = 0;
+		DMA_setChannelTransfer(STREAM_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_PINGPONG,
+				(void *) &ADC14->MEM[0], _buffer, _blockSize);
+	} else if (DMA_getChannelMode(STREAM_DMA_CHANNEL | UDMA_ALT_SELECT) == UDMA_MODE_STOP) {
+		half = 1;
+		DMA_setChannelTransfer(STREAM_DMA_CHANNEL | UDMA_ALT_SELECT, UDMA_MODE_PINGPONG,
+				(void *) &ADC14->MEM[0], _buffer + _blockSize, _blockSize);
+	} else {
+		return;
+	}
+
+	// A conversion result overwritten before the DMA read it is an overrun
+	// as well as a block that was never picked up.
+	if (ADC14_getInterruptStatus() & ADC_OV_INT) {
+		ADC14_clearInterruptFlag(ADC_OV_INT);
+		_overruns++;
+	}
+
+	if (_callback) {
+		_callback(_buffer + half * _blockSize, _blockSize);
+		return;
+	}
+
+	if (_ready & (1 << half))
+		_overruns++;
+	_ready |= (1 << half);
+}
+
+AnalogStreamClass AnalogStream;
@@ -0,0 +1,83 @@
+/*
+ AnalogStream.h - Timer paced ADC14 streaming with DMA ping-pong buffers
+ for the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+How to use:
+ A Timer_A compare output triggers ADC14 at a fixed sample rate and
+ DMA channel 7 moves every result into one half of a caller supplied
+ buffer while the other half is processed. The CPU is not involved
+ per sample.
+
+   #define BLOCK 256
+   uint16_t samples[2 * BLOCK];
+
+   AnalogStream.begin(0, 44100, samples, BLOCK);   // A0 at 44.1 kHz
+
+ Then either poll for blocks:
+   uint16_t *block = AnalogStream.getBlock();     // waits for a half
+
+ or get called from the DMA interrupt for each completed half:
+   AnalogStream.onBlock(process);
+   void process(uint16_t *block, uint16_t length) { ... }
+
+ A block has to be consumed before the DMA comes around to the same
+ half again, otherwise it is counted by overruns(). Results are the raw
+ 14-bit conversions.
+
+ The timer index selects the trigger: Timer_A0..A3 CCR1 (default 2).
+ Do not use a timer that OneMsTaskTimer, Servo or analogWrite() use.
+ Blocks are limited to 1024 samples by the DMA transfer size.
+*/
+
+#ifndef AnalogStream_h
+#define AnalogStream_h
+
+#include <stdint.h>
+
+#define ANALOG_STREAM_MAX_BLOCK 1024
+
+class AnalogStreamClass
+{
+public:
+	AnalogStreamClass();
+	bool begin(uint8_t channel, uint32_t sampleRate, uint16_t *buffer,
+			uint16_t blockSize, uint8_t timerIndex = 2);
+	void end();
+	void onBlock(void (*callback)(uint16_t *block, uint16_t length));
+	bool blockReady();
+	uint16_t *getBlock();
+	uint32_t sampleRate() { return _sampleRate; }
+	uint32_t overruns() { return _overruns; }
+
+	void _dmaHandler();
+
+private:
+	uint16_t *_buffer;
+	uint16_t _blockSize;
+	uint32_t _timer;
+	uint32_t _sampleRate;
+	uint8_t _next;
+	volatile uint8_t _ready;
+	volatile uint32_t _overruns;
+	void (*_callback)(uint16_t *block, uint16_t length);
+};
+
+extern AnalogStreamClass AnalogStream;
+
+#endif
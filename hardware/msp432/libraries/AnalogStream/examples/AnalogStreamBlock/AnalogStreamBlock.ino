@@ -0,0 +1,33 @@
+/*
+ Sample program that streams A0 at 100 kHz into two 512 sample blocks
+ and prints the mean of every block while the DMA fills the other one.
+
+ The circuit:
+ * Signal source on A0.
+
+ This example code is in the public domain.
+
+*/
+
+#include "AnalogStream.h"
+
+#define BLOCK 512
+uint16_t samples[2 * BLOCK];
+
+void setup() {
+  Serial.begin(115200);
+  AnalogStream.begin(0, 100000, samples, BLOCK);
+}
+
+void loop() {
+  uint16_t *block = AnalogStream.getBlock();
+  uint32_t sum = 0;
+
+  for (int i = 0; i < BLOCK; i++) {
+    sum += block[i];
+  }
+
+  Serial.print(sum / BLOCK);
+  Serial.print("\toverruns: ");
+  Serial.println(AnalogStream.overruns());
+}
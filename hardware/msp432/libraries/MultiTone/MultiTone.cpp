@@ -0,0 +1,244 @@
+/*
+ MultiTone.cpp - Several simultaneous tones from the Timer_A outputs of
+ the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Energia.h"
+#include "MultiTone.h"
+
+#include <driverlib/cs.h>
+#include <driverlib/gpio.h>
+#include <driverlib/interrupt.h>
+#include <driverlib/timer_a.h>
+#include <driverlib/timer32.h>
+
+static const uint32_t tone_timer[MULTITONE_VOICES] = {
+	TIMER_A0_MODULE, TIMER_A1_MODULE, TIMER_A2_MODULE, TIMER_A3_MODULE
+};
+
+static const uint_fast16_t tone_ccr[] = {
+	TIMER_A_CAPTURECOMPARE_REGISTER_1, TIMER_A_CAPTURECOMPARE_REGISTER_2,
+	TIMER_A_CAPTURECOMPARE_REGISTER_3, TIMER_A_CAPTURECOMPARE_REGISTER_4
+};
+
+// CCR1..CCR4 output pins of every Timer_A
+static const struct {
+	uint8_t port;
+	uint16_t pin;
+} tone_output[MULTITONE_VOICES][4] = {
+	{{GPIO_PORT_P2, GPIO_PIN4}, {GPIO_PORT_P2, GPIO_PIN5}, {GPIO_PORT_P2, GPIO_PIN6}, {GPIO_PORT_P2, GPIO_PIN7}},
+	{{GPIO_PORT_P7, GPIO_PIN7}, {GPIO_PORT_P7, GPIO_PIN6}, {GPIO_PORT_P7, GPIO_PIN5}, {GPIO_PORT_P7, GPIO_PIN4}},
+	{{GPIO_PORT_P5, GPIO_PIN6}, {GPIO_PORT_P5, GPIO_PIN7}, {GPIO_PORT_P6, GPIO_PIN6}, {GPIO_PORT_P6, GPIO_PIN7}},
+	{{GPIO_PORT_P10, GPIO_PIN5}, {GPIO_PORT_P8, GPIO_PIN2}, {GPIO_PORT_P9, GPIO_PIN2}, {GPIO_PORT_P9, GPIO_PIN3}},
+};
+
+static void MultiTone_timer_int(void)
+{
+	MultiTone._timerHandler();
+}
+
+MultiToneClass::MultiToneClass()
+{
+	for (uint8_t i = 0; i < MULTITONE_VOICES; i++) {
+		_voice[i].port = 0;
+		_voice[i].timed = 0;
+		_voice[i].notes = 0;
+	}
+	_timer32 = 0;
+}
+
+void MultiToneClass::begin(uint8_t timer32Index)
+{
+	_timer32 = (timer32Index == 0) ? TIMER32_0_MODULE : TIMER32_1_MODULE;
+
+	Timer32_initModule(_timer32, TIMER32_PRESCALER_1, TIMER32_32BIT,
+			TIMER32_PERIODIC_MODE);
+	Timer32_registerInterrupt((timer32Index == 0) ?
+			TIMER32_0_INTERRUPT : TIMER32_1_INTERRUPT, MultiTone_timer_int);
+	Timer32_enableInterrupt(_timer32);
+}
+
+int8_t MultiToneClass::findOutput(uint8_t port, uint16_t pin, uint8_t *ccr)
+{
+	for (uint8_t t = 0; t < MULTITONE_VOICES; t++) {
+		for (uint8_t c = 0; c < 4; c++) {
+			if (tone_output[t][c].port == port && tone_output[t][c].pin == pin) {
+				*ccr = c;
+				return t;
+			}
+		}
+	}
+	return -1;
+}
+
+void MultiToneClass::output(uint8_t n, uint16_t frequency)
+{
+	uint32_t divider = TIMER_A_CLOCKSOURCE_DIVIDER_1;
+	uint32_t period = 0;
+
+	if (frequency != 0) {
+		// Smallest divider that fits the period in the 16-bit counter
+		period = CS_getSMCLK() / frequency;
+		while (period > 0xFFFF && divider < TIMER_A_CLOCKSOURCE_DIVIDER_64) {
+			divider <<= 1;
+			period >>= 1;
+		}
+	}
+
+	if (period < 2 || period > 0xFFFF) {
+		Timer_A_stopTimer(tone_timer[n]);
+		GPIO_setAsOutputPin(_voice[n].port, _voice[n].pin);
+		GPIO_setOutputLowOnPin(_voice[n].port, _voice[n].pin);
+		return;
+	}
+
+	const Timer_A_UpModeConfig upConfig = {
+		TIMER_A_CLOCKSOURCE_SMCLK,
+		divider,
+		(uint_fast16_t) (period - 1),
+		TIMER_A_TAIE_INTERRUPT_DISABLE,
+		TIMER_A_CCIE_CCR0_INTERRUPT_DISABLE,
+		TIMER_A_DO_CLEAR
+	};
+	const Timer_A_CompareModeConfig compareConfig = {
+		tone_ccr[_voice[n].ccr],
+		TIMER_A_CAPTURECOMPARE_INTERRUPT_DISABLE,
+		TIMER_A_OUTPUTMODE_RESET_SET,
+		(uint_fast16_t) (period / 2)
+	};
+
+	Timer_A_configureUpMode(tone_timer[n], &upConfig);
+	Timer_A_initCompare(tone_timer[n], &compareConfig);
+	GPIO_setAsPeripheralModuleFunctionOutputPin(_voice[n].port, _voice[n].pin,
+			GPIO_PRIMARY_MODULE_FUNCTION);
+	Timer_A_startCounter(tone_timer[n], TIMER_A_UP_MODE);
+}
+
+void MultiToneClass::release(uint8_t n)
+{
+	output(n, 0);
+	_voice[n].port = 0;
+	_voice[n].timed = 0;
+	_voice[n].notes = 0;
+}
+
+// Stop or advance every voice that is due and arm the one-shot for the
+// next one. Runs with the Timer32 interrupt masked or from its handler.
+void MultiToneClass::schedule()
+{
+	uint32_t now = millis();
+	uint32_t wait = 0xFFFFFFFF / (CS_getMCLK() / 1000);
+	bool pending = false;
+
+	for (uint8_t i = 0; i < MULTITONE_VOICES; i++) {
+		struct voice *v = &_voice[i];
+
+		while (v->port != 0 && v->timed && (int32_t) (now - v->end) >= 0) {
+			if (v->notes && ++v->index < v->count) {
+				output(i, v->notes[v->index].frequency);
+				v->end += v->notes[v->index].duration;
+			} else {
+				release(i);
+			}
+		}
+
+		if (v->port != 0 && v->timed) {
+			pending = true;
+			if (v->end - now < wait)
+				wait = v->end - now;
+		}
+	}
+
+	Timer32_haltTimer(_timer32);
+	Timer32_clearInterruptFlag(_timer32);
+	if (pending) {
+		Timer32_setCount(_timer32, wait * (CS_getMCLK() / 1000));
+		Timer32_startTimer(_timer32, true);
+	}
+}
+
+void MultiToneClass::_timerHandler()
+{
+	Timer32_clearInterruptFlag(_timer32);
+	schedule();
+}
+
+void MultiToneClass::start(uint8_t n, uint16_t frequency, uint32_t duration)
+{
+	Timer32_disableInterrupt(_timer32);
+	output(n, frequency);
+	_voice[n].timed = (duration > 0);
+	_voice[n].end = millis() + duration;
+	schedule();
+	Timer32_enableInterrupt(_timer32);
+}
+
+bool MultiToneClass::play(uint8_t port, uint16_t pin, uint16_t frequency, uint32_t duration)
+{
+	uint8_t ccr;
+	int8_t n = findOutput(port, pin, &ccr);
+
+	if (_timer32 == 0 || n < 0) return false;
+	// A Timer_A produces one frequency, only one of its pins at a time
+	if (_voice[n].port != 0 && (_voice[n].port != port || _voice[n].pin != pin))
+		return false;
+
+	_voice[n].port = port;
+	_voice[n].pin = pin;
+	_voice[n].ccr = ccr;
+	_voice[n].notes = 0;
+	start(n, frequency, duration);
+	return true;
+}
+
+bool MultiToneClass::playSequence(uint8_t port, uint16_t pin, const toneNote_t *notes, uint16_t count)
+{
+	uint8_t n, ccr;
+
+	if (count == 0 || notes == 0 || !play(port, pin, 0, 0))
+		return false;
+
+	n = findOutput(port, pin, &ccr);
+	_voice[n].notes = notes;
+	_voice[n].count = count;
+	_voice[n].index = 0;
+	start(n, notes[0].frequency, notes[0].duration ? notes[0].duration : 1);
+	return true;
+}
+
+void MultiToneClass::stop(uint8_t port, uint16_t pin)
+{
+	for (uint8_t i = 0; i < MULTITONE_VOICES; i++) {
+		if (_voice[i].port != 0 && _voice[i].port == port && _voice[i].pin == pin) {
+			Timer32_disableInterrupt(_timer32);
+			release(i);
+			schedule();
+			Timer32_enableInterrupt(_timer32);
+		}
+	}
+}
+
+bool MultiToneClass::isPlaying(uint8_t port, uint16_t pin)
+{
+	for (uint8_t i = 0; i < MULTITONE_VOICES; i++) {
+		if (_voice[i].port != 0 && _voice[i].port == port && _voice[i].pin == pin)
+			return true;
+	}
+	return false;
+}
+
+MultiToneClass MultiTone;
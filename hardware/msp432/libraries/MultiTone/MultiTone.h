@@ -0,0 +1,96 @@
+/*
+ MultiTone.h - Several simultaneous tones from the Timer_A outputs of
+ the MSP432
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+How to use:
+ Every voice is a Timer_A running in up mode with a 50% duty cycle on
+ one of its CCR1..CCR4 outputs, so the square wave needs no interrupt.
+ Durations and the steps of a note sequence are timed by a Timer32
+ module in one-shot mode that is reloaded for the next voice due, so
+ the CPU is only interrupted when a note ends.
+
+ Pins are given as driverlib port and pin, e.g. P2.5 (TA0.2):
+
+   MultiTone.begin();
+   MultiTone.play(GPIO_PORT_P2, GPIO_PIN5, 880, 250);
+   MultiTone.play(GPIO_PORT_P5, GPIO_PIN6, 660);        // until stop()
+
+   const toneNote_t siren[] = {{960, 300}, {0, 50}, {770, 300}};
+   MultiTone.playSequence(GPIO_PORT_P5, GPIO_PIN6, siren, 3);
+
+ Timer_A outputs:
+   TA0.1-4  P2.4 P2.5 P2.6 P2.7
+   TA1.1-4  P7.7 P7.6 P7.5 P7.4
+   TA2.1-4  P5.6 P5.7 P6.6 P6.7
+   TA3.1-4  P10.5 P8.2 P9.2 P9.3
+
+ One Timer_A produces one frequency, so at most four voices play at once
+ and two pins on the same Timer_A cannot sound together. Do not use a
+ Timer_A that analogWrite(), Servo or AnalogStream use, nor the Timer32
+ used by OneMsTaskTimer (the default timer32Index here is 1).
+*/
+
+#ifndef MultiTone_h
+#define MultiTone_h
+
+#include <stdint.h>
+
+#define MULTITONE_VOICES 4
+
+typedef struct {
+	uint16_t frequency;	// Hz, 0 for a rest
+	uint16_t duration;	// milliseconds
+} toneNote_t;
+
+class MultiToneClass
+{
+public:
+	MultiToneClass();
+	void begin(uint8_t timer32Index = 1);
+	bool play(uint8_t port, uint16_t pin, uint16_t frequency, uint32_t duration = 0);
+	bool playSequence(uint8_t port, uint16_t pin, const toneNote_t *notes, uint16_t count);
+	void stop(uint8_t port, uint16_t pin);
+	bool isPlaying(uint8_t port, uint16_t pin);
+
+	void _timerHandler();
+
+private:
+	struct voice {
+		uint8_t port;		// 0 when the voice is free
+		uint16_t pin;
+		uint8_t ccr;
+		uint8_t timed;
+		uint32_t end;		// millis() at which the current note ends
+		const toneNote_t *notes;
+		uint16_t count;
+		uint16_t index;
+	};
+	struct voice _voice[MULTITONE_VOICES];	// indexed by Timer_A
+	uint32_t _timer32;
+
+	int8_t findOutput(uint8_t port, uint16_t pin, uint8_t *ccr);
+	void output(uint8_t n, uint16_t frequency);
+	void release(uint8_t n);
+	void start(uint8_t n, uint16_t frequency, uint32_t duration);
+	void schedule();
+};
+
+extern MultiToneClass MultiTone;
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ Sample program that plays a two tone alarm pattern on P2.5 while a
+ steady pilot tone sounds on P5.6, with loop() left free for other work.
+
+ The circuit:
+ * Piezo buzzer on P2.5 (TA0.2).
+ * Piezo buzzer on P5.6 (TA2.1).
+
+ This example code is in the public domain.
+
+*/
+
+#include "MultiTone.h"
+
+const toneNote_t alarm[] = {
+  {1200, 150}, {0, 50}, {1200, 150}, {0, 50}, {800, 400}, {0, 200}
+};
+
+void setup() {
+  MultiTone.begin();
+  MultiTone.play(GPIO_PORT_P5, GPIO_PIN6, 440);
+}
+
+void loop() {
+  if (!MultiTone.isPlaying(GPIO_PORT_P2, GPIO_PIN5)) {
+    MultiTone.playSequence(GPIO_PORT_P2, GPIO_PIN5, alarm, sizeof(alarm) / sizeof(alarm[0]));
+  }
+}
@@ -13,6 +13,25 @@
 
 SPIClass SPI;
 
+uint8_t SPIClass::interruptMode = 0;
+uint8_t SPIClass::interruptMask = 0;
+uint8_t SPIClass::interruptSave = 0;
+
+// External interrupts INT0..INT7 are masked in EIMSK during a
+// transaction, anything else holds off all interrupts
+void SPIClass::usingInterrupt(uint8_t interruptNumber) {
+  uint8_t sreg = SREG;
+  noInterrupts();
+#ifdef EIMSK
+  if (interruptNumber < 8 && interruptMode < 2) {
+    interruptMask |= _BV(interruptNumber);
+    interruptMode = 1;
+  } else
+#endif
+    interruptMode = 2;
+  SREG = sreg;
+}
+
 void SPIClass::begin() {
   // Set direction register for SCK and MOSI pin.
   // MISO pin automatically overrides to INPUT.
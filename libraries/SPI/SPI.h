@@ -33,6 +33,40 @@
 #define SPI_CLOCK_MASK 0x03  // SPR1 = bit 1, SPR0 = bit 0 on SPCR
 #define SPI_2XCLOCK_MASK 0x01  // SPI2X = bit 0 on SPSR
 
+#define SPI_HAS_TRANSACTION 1
+
+// SPCR and SPSR images of one SPI device, the clock is rounded down to
+// the next rate the prescaler can make
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    init(clock, bitOrder, dataMode);
+  }
+  SPISettings() {
+    init(4000000, MSBFIRST, SPI_MODE0);
+  }
+private:
+  void init(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+    // index into F_CPU / 2, 4, 8, 16, 32, 64, 128
+    uint8_t rate;
+
+    if (clock >= F_CPU / 2) rate = SPI_CLOCK_DIV2;
+    else if (clock >= F_CPU / 4) rate = SPI_CLOCK_DIV4;
+    else if (clock >= F_CPU / 8) rate = SPI_CLOCK_DIV8;
+    else if (clock >= F_CPU / 16) rate = SPI_CLOCK_DIV16;
+    else if (clock >= F_CPU / 32) rate = SPI_CLOCK_DIV32;
+    else if (clock >= F_CPU / 64) rate = SPI_CLOCK_DIV64;
+    else rate = SPI_CLOCK_DIV128;
+
+    spcr = _BV(SPE) | _BV(MSTR) | ((bitOrder == LSBFIRST) ? _BV(DORD) : 0) |
+      (dataMode & SPI_MODE_MASK) | (rate & SPI_CLOCK_MASK);
+    spsr = (rate >> 2) & SPI_2XCLOCK_MASK;
+  }
+  uint8_t spcr;
+  uint8_t spsr;
+  friend class SPIClass;
+};
+
 class SPIClass {
 public:
   inline static byte transfer(byte _data);
@@ -48,6 +82,17 @@ public:
   static void setBitOrder(uint8_t);
   static void setDataMode(uint8_t);
   static void setClockDivider(uint8_t);
+
+  // Transactions, interrupts registered with usingInterrupt() are held
+  // off until endTransaction()
+  static void usingInterrupt(uint8_t interruptNumber);
+  inline static void beginTransaction(SPISettings settings);
+  inline static void endTransaction(void);
+
+private:
+  static uint8_t interruptMode;  // 0 none, 1 EIMSK bits, 2 all interrupts
+  static uint8_t interruptMask;
+  static uint8_t interruptSave;
 };
 
 extern SPIClass SPI;
@@ -59,6 +104,39 @@ byte SPIClass::transfer(byte _data) {
   return SPDR;
 }
 
+void SPIClass::beginTransaction(SPISettings settings) {
+  if (interruptMode > 0) {
+    uint8_t sreg = SREG;
+    noInterrupts();
+#ifdef EIMSK
+    if (interruptMode == 1) {
+      interruptSave = EIMSK;
+      EIMSK &= ~interruptMask;
+      SREG = sreg;
+    } else
+#endif
+      interruptSave = sreg;
+  }
+  if (SPCR != settings.spcr)
+    SPCR = settings.spcr;
+  if ((SPSR & SPI_2XCLOCK_MASK) != settings.spsr)
+    SPSR = settings.spsr;
+}
+
+void SPIClass::endTransaction(void) {
+  if (interruptMode > 0) {
+#ifdef EIMSK
+    if (interruptMode == 1) {
+      uint8_t sreg = SREG;
+      noInterrupts();
+      EIMSK = interruptSave;
+      SREG = sreg;
+    } else
+#endif
+      SREG = interruptSave;
+  }
+}
+
 void SPIClass::attachInterrupt() {
   SPCR |= _BV(SPIE);
 }